@@ -0,0 +1,452 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Binary Arrays
+//
+// A versioned binary container for large arrays of scalars, vectors,
+// matrices and quaternions: a fixed size header describing the element
+// type followed by the raw, aligned element data. Files are written with
+// a streaming writer and read back by memory mapping, without copying.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "cgra_math.hpp"
+
+namespace cgra {
+
+	class binary_format_error : public std::runtime_error {
+	public:
+		explicit binary_format_error(const std::string &what_) : std::runtime_error("binary format: " + what_) {}
+	};
+
+	enum class binary_scalar : uint8_t {
+		unknown = 0, i8, u8, i16, u16, i32, u32, i64, u64, f32, f64
+	};
+
+	enum class binary_kind : uint8_t {
+		scalar = 0, vec, mat, quat
+	};
+
+	// file header, always 64 bytes
+	// all fields are in the byte order of the writer; endian reads back as
+	// binary_header::endian_tag on a machine of the same byte order
+	struct binary_header {
+		static constexpr uint32_t current_version = 1;
+		static constexpr uint32_t endian_tag = 0x01020304;
+		static constexpr size_t data_alignment = 64;
+
+		char magic[8];
+		uint32_t version;
+		uint32_t endian;
+		binary_scalar scalar;
+		binary_kind kind;
+		uint8_t scalar_size;
+		uint8_t reserved0;
+		uint16_t cols;
+		uint16_t rows;
+		uint32_t element_size;
+		uint32_t alignment;
+		uint64_t count;
+		uint64_t data_offset;
+		uint8_t reserved1[16];
+
+		bool native_endian() const { return endian == endian_tag; }
+
+		// size of the element data in bytes
+		uint64_t data_size() const { return count * element_size; }
+	};
+
+	static_assert(sizeof(binary_header) == 64, "binary_header should be exactly 64 bytes");
+	static_assert(std::is_trivially_copyable<binary_header>::value, "binary_header should be trivially copyable");
+
+	namespace detail {
+
+		constexpr char binary_magic[8] = {'C', 'G', 'R', 'A', 'B', 'I', 'N', '\0'};
+
+		template <typename T, typename = void>
+		struct binary_scalar_code : std::integral_constant<binary_scalar, binary_scalar::unknown> {};
+
+		template <typename T>
+		struct binary_scalar_code<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>> :
+			std::integral_constant<binary_scalar,
+				sizeof(T) == 1 ? (std::is_signed<T>::value ? binary_scalar::i8 : binary_scalar::u8) :
+				sizeof(T) == 2 ? (std::is_signed<T>::value ? binary_scalar::i16 : binary_scalar::u16) :
+				sizeof(T) == 4 ? (std::is_signed<T>::value ? binary_scalar::i32 : binary_scalar::u32) :
+				sizeof(T) == 8 ? (std::is_signed<T>::value ? binary_scalar::i64 : binary_scalar::u64) :
+				binary_scalar::unknown
+			>
+		{};
+
+		template <typename T>
+		struct binary_scalar_code<T, std::enable_if_t<std::is_floating_point<T>::value>> :
+			std::integral_constant<binary_scalar,
+				std::numeric_limits<T>::is_iec559 && sizeof(T) == 4 ? binary_scalar::f32 :
+				std::numeric_limits<T>::is_iec559 && sizeof(T) == 8 ? binary_scalar::f64 :
+				binary_scalar::unknown
+			>
+		{};
+
+		// how an element type is described in the header
+		template <typename T>
+		struct binary_element_traits {
+			using scalar_t = T;
+			static constexpr binary_kind kind = binary_kind::scalar;
+			static constexpr size_t cols = 1;
+			static constexpr size_t rows = 1;
+		};
+
+		template <typename T, size_t N>
+		struct binary_element_traits<basic_vec<T, N>> {
+			using scalar_t = T;
+			static constexpr binary_kind kind = binary_kind::vec;
+			static constexpr size_t cols = 1;
+			static constexpr size_t rows = N;
+		};
+
+		template <typename T, size_t Cols, size_t Rows>
+		struct binary_element_traits<basic_mat<T, Cols, Rows>> {
+			using scalar_t = T;
+			static constexpr binary_kind kind = binary_kind::mat;
+			static constexpr size_t cols = Cols;
+			static constexpr size_t rows = Rows;
+		};
+
+		template <typename T>
+		struct binary_element_traits<basic_quat<T>> {
+			using scalar_t = T;
+			static constexpr binary_kind kind = binary_kind::quat;
+			static constexpr size_t cols = 1;
+			static constexpr size_t rows = 4;
+		};
+
+		template <typename ElemT>
+		struct is_binary_element : bool_constant<
+			binary_scalar_code<typename binary_element_traits<ElemT>::scalar_t>::value != binary_scalar::unknown
+			&& sizeof(ElemT) == sizeof(typename binary_element_traits<ElemT>::scalar_t)
+				* binary_element_traits<ElemT>::cols * binary_element_traits<ElemT>::rows
+		> {};
+
+		template <typename ElemT>
+		inline binary_header make_binary_header(uint64_t count) {
+			static_assert(is_binary_element<ElemT>::value, "element type is not a tightly packed arithmetic scalar, vec, mat or quat");
+			using traits = binary_element_traits<ElemT>;
+			binary_header h;
+			std::memset(&h, 0, sizeof(h));
+			std::memcpy(h.magic, binary_magic, sizeof(h.magic));
+			h.version = binary_header::current_version;
+			h.endian = binary_header::endian_tag;
+			h.scalar = binary_scalar_code<typename traits::scalar_t>::value;
+			h.kind = traits::kind;
+			h.scalar_size = uint8_t(sizeof(typename traits::scalar_t));
+			h.cols = uint16_t(traits::cols);
+			h.rows = uint16_t(traits::rows);
+			h.element_size = uint32_t(sizeof(ElemT));
+			h.alignment = uint32_t(binary_header::data_alignment);
+			h.count = count;
+			h.data_offset = binary_header::data_alignment;
+			return h;
+		}
+
+		template <typename T>
+		inline T byteswap(T t) {
+			unsigned char b[sizeof(T)];
+			std::memcpy(b, &t, sizeof(T));
+			for (size_t i = 0; i < sizeof(T) / 2; i++) {
+				std::swap(b[i], b[sizeof(T) - 1 - i]);
+			}
+			std::memcpy(&t, b, sizeof(T));
+			return t;
+		}
+
+		inline void byteswap_header(binary_header &h) {
+			h.version = byteswap(h.version);
+			h.endian = byteswap(h.endian);
+			h.cols = byteswap(h.cols);
+			h.rows = byteswap(h.rows);
+			h.element_size = byteswap(h.element_size);
+			h.alignment = byteswap(h.alignment);
+			h.count = byteswap(h.count);
+			h.data_offset = byteswap(h.data_offset);
+		}
+
+		// check the header of a file of file_size bytes (or any size if 0),
+		// converting it to native byte order
+		inline void validate_binary_header(binary_header &h, uint64_t file_size) {
+			if (std::memcmp(h.magic, binary_magic, sizeof(h.magic)) != 0) throw binary_format_error("bad magic");
+			if (!h.native_endian()) {
+				byteswap_header(h);
+				if (!h.native_endian()) throw binary_format_error("bad endianness tag");
+				// leave the tag swapped so the header still records the file's byte order
+				h.endian = byteswap(h.endian);
+			}
+			if (h.version == 0 || h.version > binary_header::current_version) throw binary_format_error("unsupported version");
+			if (h.element_size != uint64_t(h.scalar_size) * h.cols * h.rows) throw binary_format_error("inconsistent element size");
+			if (h.data_offset < sizeof(binary_header)) throw binary_format_error("bad data offset");
+			if (h.alignment == 0 || (h.alignment & (h.alignment - 1)) || h.data_offset % h.alignment) throw binary_format_error("bad alignment");
+			if (h.element_size && h.count > (UINT64_MAX - h.data_offset) / h.element_size) throw binary_format_error("bad element count");
+			if (file_size && h.data_offset + h.data_size() > file_size) throw binary_format_error("file is truncated");
+		}
+
+		template <typename ElemT>
+		inline void check_binary_element(const binary_header &h) {
+			const binary_header e = make_binary_header<ElemT>(0);
+			if (h.scalar != e.scalar || h.kind != e.kind || h.cols != e.cols || h.rows != e.rows) {
+				throw binary_format_error("element type mismatch");
+			}
+		}
+
+	}
+
+	// streaming writer for a binary array of ElemT
+	// writes a header immediately, then elements as they are given;
+	// finish() (or the destructor) seeks back to record the final count
+	template <typename ElemT>
+	class binary_writer {
+	private:
+		std::ofstream m_file;
+		std::ostream *m_out;
+		std::ostream::pos_type m_start;
+		uint64_t m_count = 0;
+		bool m_finished = false;
+
+		void write_header() {
+			const binary_header h = detail::make_binary_header<ElemT>(m_count);
+			m_out->write(reinterpret_cast<const char *>(&h), sizeof(h));
+		}
+
+	public:
+		// write to a seekable binary stream, starting at its current position
+		explicit binary_writer(std::ostream &out_) : m_out(&out_), m_start(out_.tellp()) {
+			if (m_start == std::ostream::pos_type(-1)) throw binary_format_error("stream is not seekable");
+			write_header();
+		}
+
+		// write to a new file
+		explicit binary_writer(const std::string &path) :
+			m_file(path, std::ios::binary | std::ios::trunc), m_out(&m_file), m_start(0)
+		{
+			if (!m_file) throw binary_format_error("could not open '" + path + "' for writing");
+			write_header();
+		}
+
+		binary_writer(const binary_writer &) = delete;
+		binary_writer & operator=(const binary_writer &) = delete;
+
+		~binary_writer() {
+			try {
+				finish();
+			} catch (...) {
+				// call finish() to see errors
+			}
+		}
+
+		uint64_t count() const { return m_count; }
+
+		void write(const ElemT &e) {
+			write(span<const ElemT>(&e, 1));
+		}
+
+		void write(span<const ElemT> es) {
+			assert(!m_finished);
+			m_out->write(reinterpret_cast<const char *>(es.data()), std::streamsize(es.size() * sizeof(ElemT)));
+			m_count += es.size();
+		}
+
+		// patch the header with the element count; throws if any write failed
+		void finish() {
+			if (m_finished) return;
+			m_finished = true;
+			const auto end = m_out->tellp();
+			m_out->seekp(m_start);
+			write_header();
+			m_out->seekp(end);
+			m_out->flush();
+			if (!*m_out) throw binary_format_error("write failed");
+		}
+	};
+
+	// write a whole array to a file
+	template <typename ElemT>
+	inline void write_binary(const std::string &path, span<const ElemT> es) {
+		binary_writer<ElemT> w(path);
+		w.write(es);
+		w.finish();
+	}
+
+	// read a binary array of ElemT from a stream into memory
+	// unlike binary_file, this converts files of the other byte order
+	template <typename ElemT>
+	inline std::vector<ElemT> read_binary(std::istream &in) {
+		const auto start = in.tellg();
+		binary_header h;
+		if (!in.read(reinterpret_cast<char *>(&h), sizeof(h))) throw binary_format_error("file is truncated");
+		detail::validate_binary_header(h, 0);
+		detail::check_binary_element<ElemT>(h);
+		in.seekg(start + std::istream::off_type(h.data_offset));
+		std::vector<ElemT> r(size_t(h.count));
+		if (!in.read(reinterpret_cast<char *>(r.data()), std::streamsize(h.data_size()))) throw binary_format_error("file is truncated");
+		if (!h.native_endian()) {
+			using scalar_t = typename detail::binary_element_traits<ElemT>::scalar_t;
+			auto *p = reinterpret_cast<scalar_t *>(r.data());
+			for (size_t i = 0; i < r.size() * sizeof(ElemT) / sizeof(scalar_t); i++) {
+				p[i] = detail::byteswap(p[i]);
+			}
+		}
+		return r;
+	}
+
+	template <typename ElemT>
+	inline std::vector<ElemT> read_binary(const std::string &path) {
+		std::ifstream in(path, std::ios::binary);
+		if (!in) throw binary_format_error("could not open '" + path + "'");
+		return read_binary<ElemT>(in);
+	}
+
+	// read-only memory mapping of a binary array file
+	// elements are viewed in place, so they are only valid while this is alive
+	class binary_file {
+	private:
+		const unsigned char *m_data = nullptr;
+		uint64_t m_size = 0;
+		binary_header m_header;
+#ifdef _WIN32
+		HANDLE m_file = INVALID_HANDLE_VALUE;
+		HANDLE m_mapping = nullptr;
+#endif
+
+		void unmap() {
+#ifdef _WIN32
+			if (m_data) UnmapViewOfFile(m_data);
+			if (m_mapping) CloseHandle(m_mapping);
+			if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+			m_file = INVALID_HANDLE_VALUE;
+			m_mapping = nullptr;
+#else
+			if (m_data) munmap(const_cast<unsigned char *>(m_data), size_t(m_size));
+#endif
+			m_data = nullptr;
+			m_size = 0;
+		}
+
+		void map(const std::string &path) {
+#ifdef _WIN32
+			m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE) throw binary_format_error("could not open '" + path + "'");
+			LARGE_INTEGER size;
+			if (!GetFileSizeEx(m_file, &size)) throw binary_format_error("could not stat '" + path + "'");
+			m_size = uint64_t(size.QuadPart);
+			if (m_size < sizeof(binary_header)) throw binary_format_error("file is truncated");
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!m_mapping) throw binary_format_error("could not map '" + path + "'");
+			m_data = static_cast<const unsigned char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+			if (!m_data) throw binary_format_error("could not map '" + path + "'");
+#else
+			const int fd = ::open(path.c_str(), O_RDONLY);
+			if (fd < 0) throw binary_format_error("could not open '" + path + "'");
+			struct stat st;
+			if (::fstat(fd, &st) != 0) {
+				::close(fd);
+				throw binary_format_error("could not stat '" + path + "'");
+			}
+			m_size = uint64_t(st.st_size);
+			if (m_size < sizeof(binary_header)) {
+				::close(fd);
+				throw binary_format_error("file is truncated");
+			}
+			void *p = ::mmap(nullptr, size_t(m_size), PROT_READ, MAP_SHARED, fd, 0);
+			// the mapping stays valid after the descriptor is closed
+			::close(fd);
+			if (p == MAP_FAILED) throw binary_format_error("could not map '" + path + "'");
+			m_data = static_cast<const unsigned char *>(p);
+#endif
+		}
+
+	public:
+		binary_file() { std::memset(&m_header, 0, sizeof(m_header)); }
+
+		// map a file and check its header
+		// throws binary_format_error if the file is invalid or of the other byte order (see read_binary)
+		explicit binary_file(const std::string &path) {
+			try {
+				map(path);
+				std::memcpy(&m_header, m_data, sizeof(m_header));
+				detail::validate_binary_header(m_header, m_size);
+				if (!m_header.native_endian()) throw binary_format_error("file byte order does not match, use read_binary");
+			} catch (...) {
+				unmap();
+				throw;
+			}
+		}
+
+		binary_file(binary_file &&other) noexcept : binary_file() {
+			swap(other);
+		}
+
+		binary_file & operator=(binary_file &&other) noexcept {
+			binary_file(std::move(other)).swap(*this);
+			return *this;
+		}
+
+		binary_file(const binary_file &) = delete;
+		binary_file & operator=(const binary_file &) = delete;
+
+		~binary_file() { unmap(); }
+
+		void swap(binary_file &other) noexcept {
+			using std::swap;
+			swap(m_data, other.m_data);
+			swap(m_size, other.m_size);
+			swap(m_header, other.m_header);
+#ifdef _WIN32
+			swap(m_file, other.m_file);
+			swap(m_mapping, other.m_mapping);
+#endif
+		}
+
+		bool is_open() const { return m_data != nullptr; }
+
+		const binary_header & header() const { return m_header; }
+
+		size_t size() const { return size_t(m_header.count); }
+
+		// the mapped element data, eg elements<vec3>()
+		// throws binary_format_error if ElemT does not match the header
+		template <typename ElemT>
+		span<const ElemT> elements() const {
+			if (!m_data) return {};
+			detail::check_binary_element<ElemT>(m_header);
+			if (reinterpret_cast<uintptr_t>(m_data + m_header.data_offset) % alignof(ElemT)) throw binary_format_error("data is misaligned");
+			return span<const ElemT>(reinterpret_cast<const ElemT *>(m_data + m_header.data_offset), size_t(m_header.count));
+		}
+	};
+
+}
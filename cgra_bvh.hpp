@@ -0,0 +1,661 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Bounding Volume Hierarchy
+//
+// Binned SAH builder, compact binary tree and 4/8-wide trees for
+// ray casts, nearest point and overlap queries over basic_vec<float, 3>.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "cgra_math.hpp"
+#include "cgra_geometry.hpp"
+#include "cgra_parallel.hpp"
+
+namespace cgra {
+
+	namespace bvh {
+
+		using index_t = std::uint32_t;
+		using vec3_t = basic_vec<float, 3>;
+		using aabb_t = basic_aabb<float, 3>;
+		using ray_t = basic_ray<float, 3>;
+
+		constexpr index_t npos = std::numeric_limits<index_t>::max();
+
+		// maximum depth the traversal stacks can handle; the builder keeps every tree within it
+		constexpr int max_depth = 64;
+
+		struct triangle {
+			vec3_t a;
+			vec3_t b;
+			vec3_t c;
+
+			aabb_t bounds() const {
+				return aabb_t{min(min(a, b), c), max(max(a, b), c)};
+			}
+		};
+
+		// result of a ray cast
+		// u and v are the barycentric coordinates of b and c for triangles
+		struct hit {
+			float t = std::numeric_limits<float>::infinity();
+			index_t prim = npos;
+			float u = 0;
+			float v = 0;
+
+			explicit operator bool() const { return prim != npos; }
+		};
+
+		// 32 byte binary tree node
+		// interior nodes (count == 0) have children at left_first and left_first + 1
+		// leaves have count primitives starting at indices[left_first]
+		struct node {
+			aabb_t bounds;
+			index_t left_first;
+			index_t count;
+
+			bool is_leaf() const { return count != 0; }
+		};
+
+		static_assert(sizeof(node) == 32, "bvh node should be 32 bytes");
+
+		struct build_options {
+			// primitives per leaf; nodes at or under this size are not split
+			unsigned max_leaf_size = 4;
+			// number of SAH bins per axis
+			unsigned bins = 16;
+			// number of threads to use (0 for one per hardware thread)
+			unsigned threads = 0;
+		};
+
+		// binary tree: nodes[0] is the root (if not empty)
+		class tree {
+		public:
+			std::vector<node> nodes;
+			std::vector<index_t> indices;
+
+			bool empty() const { return nodes.empty(); }
+
+			aabb_t bounds() const { return nodes.empty() ? aabb_t{} : nodes[0].bounds; }
+		};
+
+		// W-wide node, with child bounds stored as a packet
+		// lanes with child == npos are unused, lanes with count != 0 are leaves
+		template <size_t W>
+		struct wide_node {
+			basic_aabb_packet<float, 3, W> bounds;
+			index_t child[W];
+			index_t count[W];
+		};
+
+		// W-wide tree: nodes[0] is the root (if not empty)
+		template <size_t W>
+		class wide_tree {
+		public:
+			static constexpr size_t width = W;
+
+			std::vector<wide_node<W>> nodes;
+			std::vector<index_t> indices;
+
+			bool empty() const { return nodes.empty(); }
+		};
+
+		using tree4 = wide_tree<4>;
+		using tree8 = wide_tree<8>;
+
+
+
+		namespace detail {
+
+			struct bin {
+				aabb_t bounds;
+				index_t count = 0;
+			};
+
+			class builder {
+			private:
+				const aabb_t *m_bounds;
+				std::vector<vec3_t> m_centroids;
+				std::vector<index_t> &m_indices;
+				build_options m_opts;
+				unsigned m_threads;
+
+				// nodes larger than this are binned in parallel
+				static constexpr index_t parallel_bin_size = 1 << 16;
+				// subtrees larger than this are built on their own thread
+				static constexpr index_t parallel_task_size = 1 << 12;
+				// nodes this deep are split at the median, which halves the count at every level
+				// so fewer than 2^32 primitives end in a leaf at most 32 levels further down,
+				// leaving a level spare for the traversal stacks
+				static constexpr unsigned median_split_depth = max_depth - 33;
+
+				// bin every primitive in [begin, end) on all three axes
+				void bin_range(index_t begin, index_t end, const vec3_t &cmin, const vec3_t &scale, bin *bins) const {
+					const index_t nbins = m_opts.bins;
+					for (index_t i = begin; i < end; ++i) {
+						const index_t p = m_indices[i];
+						for (int a = 0; a < 3; ++a) {
+							const index_t b = std::min(nbins - 1, index_t((m_centroids[p][a] - cmin[a]) * scale[a]));
+							bin &x = bins[a * nbins + b];
+							x.bounds = merge(x.bounds, m_bounds[p]);
+							x.count++;
+						}
+					}
+				}
+
+				// returns the node bounds and the centroid bounds of a range
+				std::pair<aabb_t, aabb_t> range_bounds(index_t begin, index_t end) const {
+					aabb_t nb, cb;
+					for (index_t i = begin; i < end; ++i) {
+						const index_t p = m_indices[i];
+						nb = merge(nb, m_bounds[p]);
+						cb = expand(cb, m_centroids[p]);
+					}
+					return {nb, cb};
+				}
+
+				void build_node(std::vector<node> &nodes, index_t ni, index_t begin, index_t end, unsigned depth, unsigned spawn) {
+					const index_t count = end - begin;
+					const unsigned nthreads = (count >= parallel_bin_size) ? m_threads : 1;
+					const index_t nbins = m_opts.bins;
+
+					// bounds
+					std::vector<std::pair<aabb_t, aabb_t>> partial(nthreads);
+					cgra::detail::parallel_for(count, nthreads, [&](size_t b, size_t e, unsigned t) {
+						partial[t] = range_bounds(begin + index_t(b), begin + index_t(e));
+					});
+					aabb_t nb = partial[0].first, cb = partial[0].second;
+					for (unsigned t = 1; t < nthreads; ++t) {
+						nb = merge(nb, partial[t].first);
+						cb = merge(cb, partial[t].second);
+					}
+					nodes[ni].bounds = nb;
+
+					const vec3_t cext = cb.extent();
+					if (count <= m_opts.max_leaf_size || max(cext.x, max(cext.y, cext.z)) <= 0.f) {
+						// small enough, or all centroids coincide
+						if (count <= m_opts.max_leaf_size) {
+							nodes[ni].left_first = begin;
+							nodes[ni].count = count;
+							return;
+						}
+						split(nodes, ni, begin, begin + count / 2, end, depth, spawn);
+						return;
+					}
+
+					if (depth >= median_split_depth) {
+						// skewed input (eg exponentially spaced primitives) can make SAH splits peel off
+						// a few primitives at a time; stop the tree growing past max_depth
+						const int axis = cext.x >= cext.y && cext.x >= cext.z ? 0 : (cext.y >= cext.z ? 1 : 2);
+						const index_t mid = begin + count / 2;
+						std::nth_element(m_indices.begin() + begin, m_indices.begin() + mid, m_indices.begin() + end, [&](index_t p, index_t q) {
+							return m_centroids[p][axis] < m_centroids[q][axis];
+						});
+						split(nodes, ni, begin, mid, end, depth, spawn);
+						return;
+					}
+
+					// bin all axes at once
+					vec3_t scale;
+					for (int a = 0; a < 3; ++a) {
+						scale[a] = cext[a] > 0.f ? float(nbins) / cext[a] : 0.f;
+					}
+					std::vector<bin> bins(size_t(nthreads) * 3 * nbins);
+					cgra::detail::parallel_for(count, nthreads, [&](size_t b, size_t e, unsigned t) {
+						bin_range(begin + index_t(b), begin + index_t(e), cb.lower, scale, bins.data() + size_t(t) * 3 * nbins);
+					});
+					for (unsigned t = 1; t < nthreads; ++t) {
+						for (size_t k = 0; k < 3 * size_t(nbins); ++k) {
+							bin &x = bins[k];
+							const bin &y = bins[size_t(t) * 3 * nbins + k];
+							x.bounds = merge(x.bounds, y.bounds);
+							x.count += y.count;
+						}
+					}
+
+					// sweep each axis for the cheapest split plane
+					float best_cost = std::numeric_limits<float>::infinity();
+					int best_axis = -1;
+					index_t best_split = 0;
+					std::vector<float> right_cost(nbins);
+					for (int a = 0; a < 3; ++a) {
+						if (cext[a] <= 0.f) continue;
+						const bin *ab = bins.data() + a * nbins;
+						aabb_t rb;
+						index_t rc = 0;
+						for (index_t b = nbins - 1; b > 0; --b) {
+							rb = merge(rb, ab[b].bounds);
+							rc += ab[b].count;
+							right_cost[b] = rc * surface_area(rb);
+						}
+						aabb_t lb;
+						index_t lc = 0;
+						for (index_t b = 0; b + 1 < nbins; ++b) {
+							lb = merge(lb, ab[b].bounds);
+							lc += ab[b].count;
+							const float cost = lc * surface_area(lb) + right_cost[b + 1];
+							if (lc > 0 && lc < count && cost < best_cost) {
+								best_cost = cost;
+								best_axis = a;
+								best_split = b + 1;
+							}
+						}
+					}
+
+					index_t mid = begin + count / 2;
+					if (best_axis >= 0) {
+						const float cmin = cb.lower[best_axis];
+						const float s = scale[best_axis];
+						const auto it = std::partition(m_indices.begin() + begin, m_indices.begin() + end, [&](index_t p) {
+							return std::min(nbins - 1, index_t((m_centroids[p][best_axis] - cmin) * s)) < best_split;
+						});
+						mid = index_t(it - m_indices.begin());
+					}
+					split(nodes, ni, begin, mid, end, depth, spawn);
+				}
+
+				void split(std::vector<node> &nodes, index_t ni, index_t begin, index_t mid, index_t end, unsigned depth, unsigned spawn) {
+					const index_t left = index_t(nodes.size());
+					nodes[ni].left_first = left;
+					nodes[ni].count = 0;
+					nodes.resize(nodes.size() + 2);
+
+					if (spawn > 0 && end - mid >= parallel_task_size && mid - begin >= parallel_task_size) {
+						// build the right subtree on another thread into its own array
+						// then splice it onto the end of this one
+						std::vector<node> sub(1);
+						std::thread worker([&]() { build_node(sub, 0, mid, end, depth + 1, spawn - 1); });
+						build_node(nodes, left, begin, mid, depth + 1, spawn - 1);
+						worker.join();
+						const index_t offset = index_t(nodes.size()) - 1;
+						nodes[left + 1] = sub[0];
+						for (size_t i = 1; i < sub.size(); ++i) nodes.push_back(sub[i]);
+						if (!nodes[left + 1].is_leaf()) nodes[left + 1].left_first += offset;
+						for (size_t i = offset + 1; i < nodes.size(); ++i) {
+							if (!nodes[i].is_leaf()) nodes[i].left_first += offset;
+						}
+					} else {
+						build_node(nodes, left, begin, mid, depth + 1, spawn);
+						build_node(nodes, left + 1, mid, end, depth + 1, spawn);
+					}
+				}
+
+			public:
+				builder(const aabb_t *bounds, size_t count, std::vector<index_t> &indices, const build_options &opts)
+					: m_bounds(bounds), m_centroids(count), m_indices(indices), m_opts(opts) {
+					m_opts.bins = std::max(m_opts.bins, 2u);
+					m_opts.max_leaf_size = std::max(m_opts.max_leaf_size, 1u);
+					m_threads = cgra::detail::resolve_thread_count(opts.threads);
+					for (size_t i = 0; i < count; ++i) {
+						m_centroids[i] = bounds[i].center();
+					}
+				}
+
+				void build(std::vector<node> &nodes) {
+					nodes.clear();
+					nodes.reserve(2 * m_indices.size());
+					nodes.resize(1);
+					unsigned spawn = 0;
+					while ((1u << spawn) < m_threads) spawn++;
+					build_node(nodes, 0, 0, index_t(m_indices.size()), 0, spawn);
+				}
+			};
+
+			// squared distance from a point to a box (0 inside)
+			inline float distance2(const aabb_t &b, const vec3_t &p) {
+				const vec3_t d = max(max(b.lower - p, p - b.upper), 0.f);
+				return dot(d, d);
+			}
+
+			// Moller-Trumbore ray triangle test, updates h if closer than h.t
+			inline bool intersect_triangle(const ray_t &r, const triangle &tri, index_t prim, hit &h) {
+				const vec3_t e1 = tri.b - tri.a;
+				const vec3_t e2 = tri.c - tri.a;
+				const vec3_t p = cross(r.direction, e2);
+				const float det = dot(e1, p);
+				if (std::abs(det) < 1e-12f) return false;
+				const float inv_det = 1.f / det;
+				const vec3_t s = r.origin - tri.a;
+				const float u = dot(s, p) * inv_det;
+				if (u < 0.f || u > 1.f) return false;
+				const vec3_t q = cross(s, e1);
+				const float v = dot(r.direction, q) * inv_det;
+				if (v < 0.f || u + v > 1.f) return false;
+				const float t = dot(e2, q) * inv_det;
+				if (t < 0.f || t >= h.t) return false;
+				h.t = t;
+				h.prim = prim;
+				h.u = u;
+				h.v = v;
+				return true;
+			}
+
+			template <size_t W>
+			class collapser {
+			private:
+				const tree &m_src;
+				std::vector<wide_node<W>> &m_dst;
+
+			public:
+				collapser(const tree &src, std::vector<wide_node<W>> &dst) : m_src(src), m_dst(dst) { }
+
+				// convert binary node bi into wide node wi
+				void collapse(index_t wi, index_t bi) {
+					// open the largest interior child until there are W children
+					index_t children[W];
+					size_t n = 0;
+					const node &root = m_src.nodes[bi];
+					if (root.is_leaf()) {
+						children[n++] = bi;
+					} else {
+						children[n++] = root.left_first;
+						children[n++] = root.left_first + 1;
+					}
+					while (n < W) {
+						int best = -1;
+						float best_area = -1.f;
+						for (size_t i = 0; i < n; ++i) {
+							const node &c = m_src.nodes[children[i]];
+							if (!c.is_leaf() && surface_area(c.bounds) > best_area) {
+								best = int(i);
+								best_area = surface_area(c.bounds);
+							}
+						}
+						if (best < 0) break;
+						const index_t opened = children[best];
+						children[best] = m_src.nodes[opened].left_first;
+						children[n++] = m_src.nodes[opened].left_first + 1;
+					}
+
+					for (size_t l = 0; l < W; ++l) {
+						m_dst[wi].child[l] = npos;
+						m_dst[wi].count[l] = 0;
+					}
+					for (size_t l = 0; l < n; ++l) {
+						const node &c = m_src.nodes[children[l]];
+						m_dst[wi].bounds.set(l, c.bounds);
+						if (c.is_leaf()) {
+							m_dst[wi].child[l] = c.left_first;
+							m_dst[wi].count[l] = c.count;
+						} else {
+							const index_t ci = index_t(m_dst.size());
+							m_dst.emplace_back();
+							m_dst[wi].child[l] = ci;
+							collapse(ci, children[l]);
+						}
+					}
+				}
+			};
+		}
+
+
+
+		//
+		// building
+		//
+
+		// build a tree over primitives given by their bounds
+		inline tree build(const aabb_t *prim_bounds, size_t count, const build_options &opts = build_options{}) {
+			assert(count < size_t(npos));
+			tree t;
+			if (count == 0) return t;
+			t.indices.resize(count);
+			for (size_t i = 0; i < count; ++i) t.indices[i] = index_t(i);
+			detail::builder b{prim_bounds, count, t.indices, opts};
+			b.build(t.nodes);
+			return t;
+		}
+
+		inline tree build(const std::vector<aabb_t> &prim_bounds, const build_options &opts = build_options{}) {
+			return build(prim_bounds.data(), prim_bounds.size(), opts);
+		}
+
+		inline tree build(const std::vector<triangle> &tris, const build_options &opts = build_options{}) {
+			std::vector<aabb_t> bounds(tris.size());
+			for (size_t i = 0; i < tris.size(); ++i) bounds[i] = tris[i].bounds();
+			return build(bounds, opts);
+		}
+
+		inline tree build(const std::vector<vec3_t> &points, const build_options &opts = build_options{}) {
+			std::vector<aabb_t> bounds(points.size());
+			for (size_t i = 0; i < points.size(); ++i) bounds[i] = aabb_t{points[i]};
+			return build(bounds, opts);
+		}
+
+		// convert a binary tree to a W-wide tree, sharing the primitive order
+		template <size_t W>
+		inline wide_tree<W> collapse(const tree &t) {
+			static_assert(W >= 2, "wide trees need at least 2 children per node");
+			wide_tree<W> w;
+			w.indices = t.indices;
+			if (t.empty()) return w;
+			w.nodes.reserve(t.nodes.size() / (W - 1) + 1);
+			w.nodes.emplace_back();
+			detail::collapser<W>{t, w.nodes}.collapse(0, 0);
+			return w;
+		}
+
+
+
+		//
+		// traversal
+		//
+
+		// visit the primitives of leaves hit by a ray, nearest node first
+		// f(prim, tmax) tests a primitive and may shorten tmax
+		template <typename F>
+		inline void traverse(const tree &t, const ray_t &r, float &tmax, F &&f) {
+			if (t.empty()) return;
+			float t0 = 0.f, t1 = tmax;
+			if (!intersect(r, t.nodes[0].bounds, t0, t1)) return;
+			index_t stack[max_depth];
+			int sp = 0;
+			index_t ni = 0;
+			while (true) {
+				const node &n = t.nodes[ni];
+				if (n.is_leaf()) {
+					for (index_t i = n.left_first; i < n.left_first + n.count; ++i) {
+						f(t.indices[i], tmax);
+					}
+				} else {
+					float n0 = 0.f, n1 = tmax;
+					float f0 = 0.f, f1 = tmax;
+					index_t near = n.left_first, far = n.left_first + 1;
+					bool hit_near = intersect(r, t.nodes[near].bounds, n0, n1);
+					bool hit_far = intersect(r, t.nodes[far].bounds, f0, f1);
+					if (hit_near && hit_far) {
+						if (f0 < n0) std::swap(near, far);
+						assert(sp < max_depth);
+						stack[sp++] = far;
+						ni = near;
+						continue;
+					}
+					if (hit_near || hit_far) {
+						ni = hit_near ? near : far;
+						continue;
+					}
+				}
+				if (sp == 0) break;
+				ni = stack[--sp];
+			}
+		}
+
+		template <size_t W, typename F>
+		inline void traverse(const wide_tree<W> &t, const ray_t &r, float &tmax, F &&f) {
+			if (t.empty()) return;
+			struct entry {
+				index_t node;
+				float tnear;
+			};
+			entry stack[max_depth * W];
+			int sp = 0;
+			stack[sp++] = entry{0, 0.f};
+			while (sp > 0) {
+				const entry e = stack[--sp];
+				if (e.tnear > tmax) continue;
+				const wide_node<W> &n = t.nodes[e.node];
+				float tnear[W];
+				unsigned mask = intersect(r, n.bounds, 0.f, tmax, tnear);
+				// gather hit interior children, test leaves straight away
+				entry hits[W];
+				int nhits = 0;
+				for (size_t l = 0; mask; ++l, mask >>= 1) {
+					if (!(mask & 1u)) continue;
+					if (n.count[l]) {
+						for (index_t i = n.child[l]; i < n.child[l] + n.count[l]; ++i) {
+							f(t.indices[i], tmax);
+						}
+					} else {
+						// insertion sort by descending distance
+						int j = nhits++;
+						for (; j > 0 && hits[j - 1].tnear < tnear[l]; --j) hits[j] = hits[j - 1];
+						hits[j] = entry{n.child[l], tnear[l]};
+					}
+				}
+				// push farthest first so the nearest is popped next
+				for (int i = 0; i < nhits; ++i) {
+					assert(sp < int(max_depth * W));
+					stack[sp++] = hits[i];
+				}
+			}
+		}
+
+		// visit the primitives of leaves whose bounds overlap a box
+		template <typename F>
+		inline void traverse(const tree &t, const aabb_t &box, F &&f) {
+			if (t.empty() || !overlaps(t.nodes[0].bounds, box)) return;
+			index_t stack[max_depth];
+			int sp = 0;
+			stack[sp++] = 0;
+			while (sp > 0) {
+				const node &n = t.nodes[stack[--sp]];
+				if (n.is_leaf()) {
+					for (index_t i = n.left_first; i < n.left_first + n.count; ++i) {
+						f(t.indices[i]);
+					}
+					continue;
+				}
+				for (index_t c = n.left_first; c < n.left_first + 2; ++c) {
+					if (overlaps(t.nodes[c].bounds, box)) {
+						assert(sp < max_depth);
+						stack[sp++] = c;
+					}
+				}
+			}
+		}
+
+		template <size_t W, typename F>
+		inline void traverse(const wide_tree<W> &t, const aabb_t &box, F &&f) {
+			if (t.empty()) return;
+			index_t stack[max_depth * W];
+			int sp = 0;
+			stack[sp++] = 0;
+			while (sp > 0) {
+				const wide_node<W> &n = t.nodes[stack[--sp]];
+				unsigned mask = overlaps(box, n.bounds);
+				for (size_t l = 0; mask; ++l, mask >>= 1) {
+					if (!(mask & 1u)) continue;
+					if (n.count[l]) {
+						for (index_t i = n.child[l]; i < n.child[l] + n.count[l]; ++i) {
+							f(t.indices[i]);
+						}
+					} else {
+						assert(sp < int(max_depth * W));
+						stack[sp++] = n.child[l];
+					}
+				}
+			}
+		}
+
+
+
+		//
+		// queries
+		//
+
+		// nearest triangle hit by a ray within [0, tmax)
+		template <typename TreeT>
+		inline hit intersect(const TreeT &t, const triangle *tris, const ray_t &r, float tmax = std::numeric_limits<float>::infinity()) {
+			hit h;
+			h.t = tmax;
+			traverse(t, r, tmax, [&](index_t prim, float &tm) {
+				if (detail::intersect_triangle(r, tris[prim], prim, h)) tm = h.t;
+			});
+			return h;
+		}
+
+		template <typename TreeT>
+		inline hit intersect(const TreeT &t, const std::vector<triangle> &tris, const ray_t &r, float tmax = std::numeric_limits<float>::infinity()) {
+			return intersect(t, tris.data(), r, tmax);
+		}
+
+		// true if any triangle is hit within [0, tmax), stops at the first hit
+		template <typename TreeT>
+		inline bool occluded(const TreeT &t, const triangle *tris, const ray_t &r, float tmax = std::numeric_limits<float>::infinity()) {
+			hit h;
+			h.t = tmax;
+			traverse(t, r, tmax, [&](index_t prim, float &tm) {
+				if (detail::intersect_triangle(r, tris[prim], prim, h)) tm = -1.f;
+			});
+			return bool(h);
+		}
+
+		// appends every primitive whose bounds overlap box to out
+		template <typename TreeT>
+		inline void overlap(const TreeT &t, const aabb_t *prim_bounds, const aabb_t &box, std::vector<index_t> &out) {
+			traverse(t, box, [&](index_t prim) {
+				if (overlaps(prim_bounds[prim], box)) out.push_back(prim);
+			});
+		}
+
+		// index of the point nearest to q within sqrt(max_dist2), or npos
+		inline index_t nearest_point(const tree &t, const vec3_t *points, const vec3_t &q, float max_dist2 = std::numeric_limits<float>::infinity()) {
+			index_t best = npos;
+			if (t.empty()) return best;
+			struct entry {
+				index_t node;
+				float dist2;
+			};
+			entry stack[max_depth];
+			int sp = 0;
+			stack[sp++] = entry{0, detail::distance2(t.nodes[0].bounds, q)};
+			while (sp > 0) {
+				const entry e = stack[--sp];
+				if (e.dist2 > max_dist2) continue;
+				const node &n = t.nodes[e.node];
+				if (n.is_leaf()) {
+					for (index_t i = n.left_first; i < n.left_first + n.count; ++i) {
+						const vec3_t d = points[t.indices[i]] - q;
+						const float d2 = dot(d, d);
+						if (d2 <= max_dist2) {
+							max_dist2 = d2;
+							best = t.indices[i];
+						}
+					}
+					continue;
+				}
+				entry a{n.left_first, detail::distance2(t.nodes[n.left_first].bounds, q)};
+				entry b{n.left_first + 1, detail::distance2(t.nodes[n.left_first + 1].bounds, q)};
+				if (a.dist2 < b.dist2) std::swap(a, b);
+				assert(sp + 2 <= max_depth);
+				stack[sp++] = a;
+				stack[sp++] = b;
+			}
+			return best;
+		}
+
+		inline index_t nearest_point(const tree &t, const std::vector<vec3_t> &points, const vec3_t &q, float max_dist2 = std::numeric_limits<float>::infinity()) {
+			return nearest_point(t, points.data(), q, max_dist2);
+		}
+
+	}
+
+}
@@ -0,0 +1,139 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Camera
+//
+// Span-based builders for view and projection matrices: batches of look-at
+// views and perspective projections, cube map face views, cascaded shadow
+// map split distances and combined view-projection matrices.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+
+#include "cgra_math.hpp"
+
+namespace cgra {
+
+	namespace detail {
+
+		// spans of one element are repeated for every output
+		template <typename T>
+		inline const T & broadcast_get(span<const T> s, size_t i) {
+			return s[s.size() == 1 ? 0 : i];
+		}
+
+		template <typename T>
+		inline bool broadcast_size(span<const T> s, size_t count) {
+			return s.size() == 1 || s.size() == count;
+		}
+	}
+
+
+	// out[i] = lookat(eye[i], focus[i], up[i])
+	// focus and up may have one element, which is used for every view
+	template <typename T>
+	inline void lookat_batch(span<const basic_vec<T, 3>> eye, span<const basic_vec<T, 3>> focus, span<const basic_vec<T, 3>> up, span<basic_mat<T, 4, 4>> out) {
+		const size_t count = eye.size();
+		assert(detail::broadcast_size(focus, count) && detail::broadcast_size(up, count));
+		assert(out.size() == count);
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = lookat(eye[i], detail::broadcast_get(focus, i), detail::broadcast_get(up, i));
+		}
+	}
+
+	// out[i] = perspective(fovy[i], aspect[i], znear[i], zfar[i], depth)
+	// any parameter may have one element, which is used for every projection
+	template <typename T>
+	inline void perspective_batch(span<const T> fovy, span<const T> aspect, span<const T> znear, span<const T> zfar, span<basic_mat<T, 4, 4>> out, clip_depth depth = clip_depth::negative_one_to_one) {
+		const size_t count = out.size();
+		assert(detail::broadcast_size(fovy, count) && detail::broadcast_size(aspect, count));
+		assert(detail::broadcast_size(znear, count) && detail::broadcast_size(zfar, count));
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = perspective(detail::broadcast_get(fovy, i), detail::broadcast_get(aspect, i), detail::broadcast_get(znear, i), detail::broadcast_get(zfar, i), depth);
+		}
+	}
+
+	// out[i] = proj[i] * view[i], for uploading combined matrices
+	// proj or view may have one element, which is used for every output
+	template <typename T>
+	inline void view_projection_batch(span<const basic_mat<T, 4, 4>> view, span<const basic_mat<T, 4, 4>> proj, span<basic_mat<T, 4, 4>> out) {
+		const size_t count = out.size();
+		assert(detail::broadcast_size(view, count) && detail::broadcast_size(proj, count));
+		for (size_t i = 0; i < count; ++i) {
+			out[i] = detail::broadcast_get(proj, i) * detail::broadcast_get(view, i);
+		}
+	}
+
+
+	// cube map faces in the order +x, -x, +y, -y, +z, -z, with the OpenGL face orientations
+	// (also the Direct3D and Vulkan layer order)
+	enum class cube_face { positive_x, negative_x, positive_y, negative_y, positive_z, negative_z };
+
+	// view matrix looking down the given cube map face from eye
+	// the face frames are fixed, so only the translation is computed
+	template <typename T>
+	inline basic_mat<T, 4, 4> cube_face_view(const basic_vec<T, 3> &eye, cube_face face) {
+		using vec_t = basic_vec<T, 3>;
+		// {vx, vy, vz} of lookat(eye, eye + dir, up) for each face
+		static const vec_t frames[6][3] {
+			{{0, 0, -1}, {0, -1, 0}, {-1, 0, 0}},
+			{{0, 0, 1}, {0, -1, 0}, {1, 0, 0}},
+			{{1, 0, 0}, {0, 0, 1}, {0, -1, 0}},
+			{{1, 0, 0}, {0, 0, -1}, {0, 1, 0}},
+			{{1, 0, 0}, {0, -1, 0}, {0, 0, -1}},
+			{{-1, 0, 0}, {0, -1, 0}, {0, 0, 1}}
+		};
+		const vec_t *f = frames[size_t(face)];
+		return detail::view_from_frame(f[0], f[1], f[2], eye);
+	}
+
+	// the six cube map face views from eye, in cube_face order
+	template <typename T>
+	inline std::array<basic_mat<T, 4, 4>, 6> cube_face_views(const basic_vec<T, 3> &eye) {
+		std::array<basic_mat<T, 4, 4>, 6> r;
+		for (size_t f = 0; f < 6; ++f) r[f] = cube_face_view(eye, cube_face(f));
+		return r;
+	}
+
+	// the six face views for each eye, out[6 * i + f] is face f of eye[i]
+	template <typename T>
+	inline void cube_face_views_batch(span<const basic_vec<T, 3>> eye, span<basic_mat<T, 4, 4>> out) {
+		assert(out.size() == 6 * eye.size());
+		for (size_t i = 0; i < eye.size(); ++i) {
+			for (size_t f = 0; f < 6; ++f) out[6 * i + f] = cube_face_view(eye[i], cube_face(f));
+		}
+	}
+
+	// square 90 degree projection shared by every cube map face
+	template <typename T>
+	inline basic_mat<T, 4, 4> cube_face_projection(const T &znear, const T &zfar, clip_depth depth = clip_depth::negative_one_to_one) {
+		return perspective(T(pi / 2), T(1), znear, zfar, depth);
+	}
+
+
+	// cascaded shadow map split distances from znear to zfar (the practical split scheme)
+	// lambda blends uniform (0) and logarithmic (1) splits; out gets cascades + 1 distances,
+	// out[0] = znear and out[cascades] = zfar, cascade i covering [out[i], out[i + 1]]
+	template <typename T>
+	inline void cascade_splits(const T &znear, const T &zfar, const T &lambda, span<T> out) {
+		assert(out.size() >= 2);
+		assert(znear > T(0) && zfar > znear);
+		const size_t cascades = out.size() - 1;
+		const T ratio = zfar / znear;
+		for (size_t i = 0; i <= cascades; ++i) {
+			const T p = T(i) / T(cascades);
+			const T log_split = znear * std::pow(ratio, p);
+			const T uniform_split = znear + (zfar - znear) * p;
+			out[i] = lambda * log_split + (T(1) - lambda) * uniform_split;
+		}
+		// exact ends, whatever the rounding in between
+		out[0] = znear;
+		out[cascades] = zfar;
+	}
+
+}
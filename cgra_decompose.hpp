@@ -0,0 +1,689 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Decompositions
+//
+// Polar, QR, symmetric eigen and singular value decompositions of small
+// square matrices, with fixed-sweep 3x3 SVD and polar batches, and
+// translation-rotation-scale decomposition of affine transforms.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include "cgra_math.hpp"
+#include "cgra_parallel.hpp"
+
+namespace cgra {
+
+	// a = q * r, q orthogonal and r upper triangular
+	template <typename T, size_t N>
+	struct qr_result {
+		basic_mat<T, N, N> q;
+		basic_mat<T, N, N> r;
+	};
+
+	// a = vectors * diag(values) * transpose(vectors)
+	// values are in decreasing order, vectors[i] is the unit eigenvector for values[i]
+	template <typename T, size_t N>
+	struct eigen_result {
+		basic_vec<T, N> values;
+		basic_mat<T, N, N> vectors;
+	};
+
+	// a = u * diag(sigma) * transpose(v), u and v rotations (determinant +1)
+	// sigma is in decreasing order of magnitude; all but the last are non-negative,
+	// and the last carries the sign of determinant(a), which is what FEM codes want for inverted elements
+	template <typename T, size_t N>
+	struct svd_result {
+		basic_mat<T, N, N> u;
+		basic_vec<T, N> sigma;
+		basic_mat<T, N, N> v;
+	};
+
+	// a = r * s, r a rotation and s symmetric
+	// s has a negative eigenvalue when determinant(a) < 0
+	template <typename T, size_t N>
+	struct polar_result {
+		basic_mat<T, N, N> r;
+		basic_mat<T, N, N> s;
+	};
+
+
+	// m = translate3(translation) * rotate3(rotation) * scale3(scale)
+	// a reflection shows up as a negative scale.x
+	template <typename T>
+	struct trs_result {
+		basic_vec<T, 3> translation;
+		basic_quat<T> rotation;
+		basic_vec<T, 3> scale;
+	};
+
+
+	namespace detail {
+
+		template <typename T>
+		inline T decompose_epsilon() {
+			return std::numeric_limits<T>::epsilon() * T(8);
+		}
+
+		// replaces columns [first, N) of m with unit vectors orthogonal to all the columns before them
+		template <typename T, size_t N>
+		inline void complete_orthonormal(basic_mat<T, N, N> &m, size_t first) {
+			size_t e = 0;
+			for (size_t j = first; j < N; ++j) {
+				for (; e < N; ++e) {
+					basic_vec<T, N> c(0);
+					c[e] = T(1);
+					for (size_t k = 0; k < j; ++k) c -= m[k] * dot(m[k], c);
+					const T l = length(c);
+					if (l > T(0.5)) {
+						m[j] = c / l;
+						++e;
+						break;
+					}
+				}
+			}
+		}
+
+		// flips the last column if needed so that m is a rotation
+		// returns -1 if it flipped, otherwise 1
+		template <typename T, size_t N>
+		inline T make_rotation(basic_mat<T, N, N> &m) {
+			if (determinant(m) >= T(0)) return T(1);
+			m[N - 1] = -m[N - 1];
+			return T(-1);
+		}
+
+		// one-sided (Hestenes) Jacobi SVD: orthogonalizes the columns of b = a * v
+		// converges quadratically, so the sweep bound is only hit by pathological input
+		template <typename T, size_t N>
+		inline svd_result<T, N> svd_jacobi(const basic_mat<T, N, N> &a, int max_sweeps) {
+			basic_mat<T, N, N> b = a, v{T(1)};
+			const T eps = decompose_epsilon<T>();
+			for (int sweep = 0; sweep < max_sweeps; ++sweep) {
+				bool rotated = false;
+				for (size_t p = 0; p + 1 < N; ++p) {
+					for (size_t q = p + 1; q < N; ++q) {
+						const T alpha = dot(b[p], b[p]), beta = dot(b[q], b[q]), gamma = dot(b[p], b[q]);
+						if (!(std::abs(gamma) > eps * std::sqrt(alpha * beta))) continue;
+						rotated = true;
+						const T zeta = (beta - alpha) / (T(2) * gamma);
+						const T t = std::copysign(T(1), zeta) / (std::abs(zeta) + std::sqrt(T(1) + zeta * zeta));
+						const T c = T(1) / std::sqrt(T(1) + t * t), s = c * t;
+						const basic_vec<T, N> bp = b[p], vp = v[p];
+						b[p] = bp * c - b[q] * s;
+						b[q] = bp * s + b[q] * c;
+						v[p] = vp * c - v[q] * s;
+						v[q] = vp * s + v[q] * c;
+					}
+				}
+				if (!rotated) break;
+			}
+			svd_result<T, N> r;
+			// selection sort by column length, carrying v along
+			for (size_t i = 0; i < N; ++i) r.sigma[i] = length(b[i]);
+			for (size_t i = 0; i + 1 < N; ++i) {
+				size_t m = i;
+				for (size_t j = i + 1; j < N; ++j) {
+					if (r.sigma[j] > r.sigma[m]) m = j;
+				}
+				std::swap(r.sigma[i], r.sigma[m]);
+				std::swap(b[i], b[m]);
+				std::swap(v[i], v[m]);
+			}
+			size_t rank = 0;
+			const T tiny = r.sigma[0] * eps;
+			for (; rank < N && r.sigma[rank] > tiny && r.sigma[rank] > T(0); ++rank) r.u[rank] = b[rank] / r.sigma[rank];
+			for (size_t i = rank; i < N; ++i) r.sigma[i] = T(0);
+			complete_orthonormal(r.u, rank);
+			r.v = v;
+			r.sigma[N - 1] *= make_rotation(r.u);
+			r.sigma[N - 1] *= make_rotation(r.v);
+			return r;
+		}
+
+
+		// McAdams et al. 2011, "Computing the singular value decomposition of 3x3 matrices with minimal branching"
+		// a fixed number of Jacobi sweeps with approximate Givens rotations diagonalizes transpose(a) * a,
+		// then Givens QR of a * v gives u and sigma; every branch is a select, so lane loops over
+		// each stage vectorize
+		// the paper's 4 sweeps leave errors near 1e-2 on some random float input, 6 keep it near 1e-6
+		template <typename T>
+		inline int svd3_sweeps() {
+			return sizeof(T) > 4 ? 8 : 6;
+		}
+
+		// lower triangle of transpose(a) * a, a is [row][col]
+		template <typename T>
+		inline void svd3_normal_matrix(const T (&a)[3][3], T (&s)[6]) {
+			s[0] = a[0][0] * a[0][0] + a[1][0] * a[1][0] + a[2][0] * a[2][0];
+			s[1] = a[0][1] * a[0][0] + a[1][1] * a[1][0] + a[2][1] * a[2][0];
+			s[2] = a[0][1] * a[0][1] + a[1][1] * a[1][1] + a[2][1] * a[2][1];
+			s[3] = a[0][2] * a[0][0] + a[1][2] * a[1][0] + a[2][2] * a[2][0];
+			s[4] = a[0][2] * a[0][1] + a[1][2] * a[1][1] + a[2][2] * a[2][1];
+			s[5] = a[0][2] * a[0][2] + a[1][2] * a[1][2] + a[2][2] * a[2][2];
+		}
+
+		// half-angle (cos, sin) of a rotation that roughly zeroes s12, falling back to pi / 8
+		// where the exact angle would be too large for the approximation
+		template <typename T>
+		inline void svd3_approx_givens(T s11, T s12, T s22, T &ch, T &sh) {
+			const T gamma = T(5.828427124746190); // 3 + 2 sqrt(2)
+			const T cstar = T(0.9238795325112867); // cos(pi / 8)
+			const T sstar = T(0.3826834323650898); // sin(pi / 8)
+			ch = T(2) * (s11 - s22);
+			sh = s12;
+			const bool b = gamma * sh * sh < ch * ch;
+			const T w = T(1) / std::sqrt(ch * ch + sh * sh);
+			ch = b ? w * ch : cstar;
+			sh = b ? w * sh : sstar;
+		}
+
+		// conjugates the symmetric s = (s11, s21, s22, s31, s32, s33) by an approximate Givens rotation
+		// in its leading 2x2 block, accumulates the rotation about axis Z into qv = (x, y, z, w), then
+		// cycles s so the next pair is in the leading block
+		template <size_t X, size_t Y, size_t Z, typename T>
+		inline void svd3_jacobi_conjugation(T (&s)[6], T (&qv)[4]) {
+			T ch, sh;
+			svd3_approx_givens(s[0], s[1], s[2], ch, sh);
+			const T scale = ch * ch + sh * sh;
+			const T a = (ch * ch - sh * sh) / scale;
+			const T b = (T(2) * sh * ch) / scale;
+			const T t11 = s[0], t21 = s[1], t22 = s[2], t31 = s[3], t32 = s[4], t33 = s[5];
+			// the cycled order is (s22, s32, s33, s21, s31, s11)
+			s[5] = a * (a * t11 + b * t21) + b * (a * t21 + b * t22);
+			s[3] = a * (-b * t11 + a * t21) + b * (-b * t21 + a * t22);
+			s[0] = -b * (-b * t11 + a * t21) + a * (-b * t21 + a * t22);
+			s[4] = a * t31 + b * t32;
+			s[1] = -b * t31 + a * t32;
+			s[2] = t33;
+			const T tmp[3] = {qv[0] * sh, qv[1] * sh, qv[2] * sh};
+			sh *= qv[3];
+			for (size_t k = 0; k < 4; ++k) qv[k] *= ch;
+			qv[Z] += sh;
+			qv[3] -= tmp[Z];
+			qv[X] += tmp[Y];
+			qv[Y] -= tmp[X];
+		}
+
+		template <typename T>
+		inline void svd3_jacobi_sweep(T (&s)[6], T (&qv)[4]) {
+			svd3_jacobi_conjugation<0, 1, 2>(s, qv);
+			svd3_jacobi_conjugation<1, 2, 0>(s, qv);
+			svd3_jacobi_conjugation<2, 0, 1>(s, qv);
+		}
+
+		// half-angle (cos, sin) of the Givens rotation that zeroes a2 against a1
+		template <typename T>
+		inline void svd3_qr_givens(T a1, T a2, T &ch, T &sh) {
+			const T eps = decompose_epsilon<T>();
+			const T rho = std::sqrt(a1 * a1 + a2 * a2);
+			sh = rho > eps ? a2 : T(0);
+			ch = std::abs(a1) + (rho > eps ? rho : eps);
+			const bool b = a1 < T(0);
+			const T t = sh;
+			sh = b ? ch : sh;
+			ch = b ? t : ch;
+			const T w = T(1) / std::sqrt(ch * ch + sh * sh);
+			ch *= w;
+			sh *= w;
+		}
+
+		// swaps columns I and J of m and negates one of them when c, which keeps m a rotation
+		template <size_t I, size_t J, typename T>
+		inline void svd3_cond_neg_swap(bool c, T (&m)[3][3]) {
+			for (size_t r = 0; r < 3; ++r) {
+				const T x = m[r][I], y = m[r][J];
+				m[r][I] = c ? y : x;
+				m[r][J] = c ? -x : y;
+			}
+		}
+
+		template <size_t I, size_t J, typename T>
+		inline void svd3_sort_pair(T (&rho)[3], T (&b)[3][3], T (&v)[3][3]) {
+			const bool c = rho[I] < rho[J];
+			svd3_cond_neg_swap<I, J>(c, b);
+			svd3_cond_neg_swap<I, J>(c, v);
+			const T r0 = rho[I], r1 = rho[J];
+			rho[I] = c ? r1 : r0;
+			rho[J] = c ? r0 : r1;
+		}
+
+		// zeroes m[J][K] against m[I][K] by rotating rows I and J, applying the same rotation to q
+		template <size_t I, size_t J, size_t K, typename T>
+		inline void svd3_qr_step(T (&m)[3][3], T (&q)[3][3]) {
+			T ch, sh;
+			svd3_qr_givens(m[I][K], m[J][K], ch, sh);
+			const T a = T(1) - T(2) * sh * sh;
+			const T b = T(2) * ch * sh;
+			for (size_t c = 0; c < 3; ++c) {
+				const T mi = m[I][c], mj = m[J][c];
+				m[I][c] = a * mi + b * mj;
+				m[J][c] = -b * mi + a * mj;
+				const T qi = q[I][c], qj = q[J][c];
+				q[I][c] = a * qi + b * qj;
+				q[J][c] = -b * qi + a * qj;
+			}
+		}
+
+		// rotation matrix of the accumulated (not quite unit) quaternion qv, [row][col]
+		template <typename T>
+		inline void svd3_quat_matrix(const T (&qv)[4], T (&v)[3][3]) {
+			const T qn = T(1) / std::sqrt(qv[0] * qv[0] + qv[1] * qv[1] + qv[2] * qv[2] + qv[3] * qv[3]);
+			const T x = qv[0] * qn, y = qv[1] * qn, z = qv[2] * qn, w = qv[3] * qn;
+			v[0][0] = T(1) - T(2) * (y * y + z * z);
+			v[0][1] = T(2) * (x * y - w * z);
+			v[0][2] = T(2) * (x * z + w * y);
+			v[1][0] = T(2) * (x * y + w * z);
+			v[1][1] = T(1) - T(2) * (x * x + z * z);
+			v[1][2] = T(2) * (y * z - w * x);
+			v[2][0] = T(2) * (x * z - w * y);
+			v[2][1] = T(2) * (y * z + w * x);
+			v[2][2] = T(1) - T(2) * (x * x + y * y);
+		}
+
+		// b = a * v with the columns of b and v sorted by decreasing length of b's
+		template <typename T>
+		inline void svd3_sorted_product(const T (&a)[3][3], T (&v)[3][3], T (&b)[3][3]) {
+			for (size_t r = 0; r < 3; ++r) {
+				for (size_t c = 0; c < 3; ++c) {
+					b[r][c] = a[r][0] * v[0][c] + a[r][1] * v[1][c] + a[r][2] * v[2][c];
+				}
+			}
+			T rho[3];
+			for (size_t c = 0; c < 3; ++c) rho[c] = b[0][c] * b[0][c] + b[1][c] * b[1][c] + b[2][c] * b[2][c];
+			svd3_sort_pair<0, 1>(rho, b, v);
+			svd3_sort_pair<0, 2>(rho, b, v);
+			svd3_sort_pair<1, 2>(rho, b, v);
+		}
+
+		// v from the accumulated quaternion, then u and sigma from the Givens QR of a * v; all [row][col]
+		// the row rotations applied to the identity give transpose(u)
+		template <typename T>
+		inline void svd3_finish(const T (&a)[3][3], const T (&qv)[4], T (&u)[3][3], T (&sigma)[3], T (&v)[3][3]) {
+			T b[3][3];
+			svd3_quat_matrix(qv, v);
+			svd3_sorted_product(a, v, b);
+			T qt[3][3] = {{T(1), T(0), T(0)}, {T(0), T(1), T(0)}, {T(0), T(0), T(1)}};
+			svd3_qr_step<0, 1, 0>(b, qt);
+			svd3_qr_step<0, 2, 0>(b, qt);
+			svd3_qr_step<1, 2, 1>(b, qt);
+			for (size_t r = 0; r < 3; ++r) {
+				for (size_t c = 0; c < 3; ++c) u[r][c] = qt[c][r];
+			}
+			sigma[0] = b[0][0];
+			sigma[1] = b[1][1];
+			sigma[2] = b[2][2];
+		}
+
+		template <typename T>
+		inline void svd3_kernel(const T (&a)[3][3], T (&u)[3][3], T (&sigma)[3], T (&v)[3][3]) {
+			T s[6], qv[4] = {T(0), T(0), T(0), T(1)};
+			svd3_normal_matrix(a, s);
+			for (int i = 0; i < svd3_sweeps<T>(); ++i) svd3_jacobi_sweep(s, qv);
+			svd3_finish(a, qv, u, sigma, v);
+		}
+
+		template <typename T>
+		inline void svd3_load(const basic_mat<T, 3, 3> &m, T (&a)[3][3]) {
+			for (size_t r = 0; r < 3; ++r) {
+				for (size_t c = 0; c < 3; ++c) a[r][c] = m[c][r];
+			}
+		}
+
+		template <typename T>
+		inline basic_mat<T, 3, 3> svd3_store(const T (&a)[3][3]) {
+			basic_mat<T, 3, 3> m;
+			for (size_t r = 0; r < 3; ++r) {
+				for (size_t c = 0; c < 3; ++c) m[c][r] = a[r][c];
+			}
+			return m;
+		}
+
+		// s = v * diag(sigma) * transpose(v), r = u * transpose(v), all [row][col]
+		template <typename T>
+		inline void polar3_from_svd(const T (&u)[3][3], const T (&sigma)[3], const T (&v)[3][3], T (&r)[3][3], T (&s)[3][3]) {
+			for (size_t i = 0; i < 3; ++i) {
+				for (size_t j = 0; j < 3; ++j) {
+					r[i][j] = u[i][0] * v[j][0] + u[i][1] * v[j][1] + u[i][2] * v[j][2];
+					s[i][j] = v[i][0] * sigma[0] * v[j][0] + v[i][1] * sigma[1] * v[j][1] + v[i][2] * sigma[2] * v[j][2];
+				}
+			}
+		}
+
+		constexpr size_t decompose_lanes = 16;
+
+		// runs block(i, n) over lane blocks of [0, count), split across threads
+		template <typename BlockF>
+		inline void decompose_batch(size_t count, unsigned threads, BlockF block) {
+			const unsigned nthreads = std::min<unsigned>(resolve_thread_count(threads), unsigned(count / 1024 + 1));
+			parallel_for(count, nthreads, [&](size_t i0, size_t i1, unsigned) {
+				for (size_t i = i0; i < i1; i += decompose_lanes) block(i, std::min(decompose_lanes, i1 - i));
+			});
+		}
+
+	}
+
+
+	// Householder QR decomposition
+	template <typename T, size_t N>
+	inline qr_result<T, N> qr(const basic_mat<T, N, N> &a) {
+		static_assert(N >= 1 && N <= 4, "qr is for small matrices");
+		qr_result<T, N> res{basic_mat<T, N, N>{T(1)}, a};
+		for (size_t k = 0; k + 1 < N; ++k) {
+			// reflect column k below the diagonal onto the axis
+			basic_vec<T, N> h(0);
+			for (size_t i = k; i < N; ++i) h[i] = res.r[k][i];
+			const T norm = length(h);
+			if (!(norm > T(0))) continue;
+			h[k] += h[k] < T(0) ? -norm : norm;
+			const T hh = dot(h, h);
+			for (size_t j = k; j < N; ++j) res.r[j] -= h * (T(2) * dot(h, res.r[j]) / hh);
+			// q = q * (I - 2 h h^T / h^T h)
+			for (size_t i = 0; i < N; ++i) {
+				T d = 0;
+				for (size_t j = k; j < N; ++j) d += res.q[j][i] * h[j];
+				d *= T(2) / hh;
+				for (size_t j = k; j < N; ++j) res.q[j][i] -= d * h[j];
+			}
+			for (size_t i = k + 1; i < N; ++i) res.r[k][i] = T(0);
+		}
+		return res;
+	}
+
+	// cyclic Jacobi eigendecomposition of a symmetric matrix
+	// only the lower triangle of a is read
+	template <typename T, size_t N>
+	inline eigen_result<T, N> eigen_symmetric(const basic_mat<T, N, N> &a, int max_sweeps = 16) {
+		static_assert(N >= 1 && N <= 4, "eigen_symmetric is for small matrices");
+		basic_mat<T, N, N> s = a, v{T(1)};
+		for (size_t j = 0; j < N; ++j) {
+			for (size_t i = j + 1; i < N; ++i) s[i][j] = s[j][i];
+		}
+		const T eps = detail::decompose_epsilon<T>();
+		for (int sweep = 0; sweep < max_sweeps; ++sweep) {
+			T off = 0, diag = 0;
+			for (size_t j = 0; j < N; ++j) {
+				diag += s[j][j] * s[j][j];
+				for (size_t i = j + 1; i < N; ++i) off += s[j][i] * s[j][i];
+			}
+			if (!(off > eps * eps * diag)) break;
+			for (size_t p = 0; p + 1 < N; ++p) {
+				for (size_t q = p + 1; q < N; ++q) {
+					const T apq = s[q][p];
+					if (apq == T(0)) continue;
+					const T theta = (s[q][q] - s[p][p]) / (T(2) * apq);
+					const T t = std::copysign(T(1), theta) / (std::abs(theta) + std::sqrt(theta * theta + T(1)));
+					const T c = T(1) / std::sqrt(t * t + T(1)), sn = t * c;
+					// s = transpose(g) * s * g, g rotating columns p and q
+					for (size_t k = 0; k < N; ++k) {
+						const T sp = s[p][k], sq = s[q][k];
+						s[p][k] = c * sp - sn * sq;
+						s[q][k] = sn * sp + c * sq;
+					}
+					for (size_t k = 0; k < N; ++k) {
+						const T sp = s[k][p], sq = s[k][q];
+						s[k][p] = c * sp - sn * sq;
+						s[k][q] = sn * sp + c * sq;
+					}
+					const basic_vec<T, N> vp = v[p];
+					v[p] = vp * c - v[q] * sn;
+					v[q] = vp * sn + v[q] * c;
+				}
+			}
+		}
+		eigen_result<T, N> res;
+		for (size_t i = 0; i < N; ++i) res.values[i] = s[i][i];
+		for (size_t i = 0; i + 1 < N; ++i) {
+			size_t m = i;
+			for (size_t j = i + 1; j < N; ++j) {
+				if (res.values[j] > res.values[m]) m = j;
+			}
+			std::swap(res.values[i], res.values[m]);
+			std::swap(v[i], v[m]);
+		}
+		res.vectors = v;
+		return res;
+	}
+
+	// singular value decomposition, see svd_result for the sign convention
+	// max_sweeps bounds the one-sided Jacobi iteration; the 3x3 overload always does a fixed amount of work
+	template <typename T, size_t N>
+	inline svd_result<T, N> svd(const basic_mat<T, N, N> &a, int max_sweeps = 16) {
+		static_assert(N >= 1 && N <= 4, "svd is for small matrices");
+		return detail::svd_jacobi(a, max_sweeps);
+	}
+
+	template <typename T>
+	inline svd_result<T, 3> svd(const basic_mat<T, 3, 3> &a) {
+		T m[3][3], u[3][3], sigma[3], v[3][3];
+		detail::svd3_load(a, m);
+		detail::svd3_kernel(m, u, sigma, v);
+		return svd_result<T, 3>{detail::svd3_store(u), basic_vec<T, 3>(sigma[0], sigma[1], sigma[2]), detail::svd3_store(v)};
+	}
+
+	// polar decomposition through the svd, so r is always a rotation
+	template <typename T, size_t N>
+	inline polar_result<T, N> polar(const basic_mat<T, N, N> &a) {
+		const svd_result<T, N> d = svd(a);
+		basic_mat<T, N, N> sv = d.v;
+		for (size_t i = 0; i < N; ++i) sv[i] *= d.sigma[i];
+		return polar_result<T, N>{d.u * transpose(d.v), sv * transpose(d.v)};
+	}
+
+
+	namespace detail {
+
+		// block state is [component][lane]; each stage copies a lane through locals
+		// so its loop body is straight-line code that vectorizes
+		template <typename T, size_t L, size_t N>
+		inline void lane_get(const T (&p)[N][L], size_t l, T (&x)[N]) {
+			for (size_t k = 0; k < N; ++k) x[k] = p[k][l];
+		}
+
+		template <typename T, size_t L, size_t N>
+		inline void lane_set(T (&p)[N][L], size_t l, const T (&x)[N]) {
+			for (size_t k = 0; k < N; ++k) p[k][l] = x[k];
+		}
+
+		template <typename T, size_t L>
+		inline void lane_get(const T (&p)[9][L], size_t l, T (&x)[3][3]) {
+			for (size_t k = 0; k < 9; ++k) x[k / 3][k % 3] = p[k][l];
+		}
+
+		template <typename T, size_t L>
+		inline void lane_set(T (&p)[9][L], size_t l, const T (&x)[3][3]) {
+			for (size_t k = 0; k < 9; ++k) p[k][l] = x[k / 3][k % 3];
+		}
+
+		template <size_t X, size_t Y, size_t Z, typename T, size_t L>
+		inline void svd3_conjugate_lanes(T (&s)[6][L], T (&qv)[4][L]) {
+			for (size_t l = 0; l < L; ++l) {
+				T ls[6], lq[4];
+				lane_get(s, l, ls);
+				lane_get(qv, l, lq);
+				svd3_jacobi_conjugation<X, Y, Z>(ls, lq);
+				lane_set(s, l, ls);
+				lane_set(qv, l, lq);
+			}
+		}
+
+		template <size_t I, size_t J, size_t K, typename T, size_t L>
+		inline void svd3_qr_step_lanes(T (&b)[9][L], T (&qt)[9][L]) {
+			for (size_t l = 0; l < L; ++l) {
+				T lb[3][3], lq[3][3];
+				lane_get(b, l, lb);
+				lane_get(qt, l, lq);
+				svd3_qr_step<I, J, K>(lb, lq);
+				lane_set(b, l, lb);
+				lane_set(qt, l, lq);
+			}
+		}
+
+		// runs the svd kernel one stage at a time over a block of matrices, with the lane loop
+		// innermost, and calls out(l, u, sigma, v) for each lane; all [row][col]
+		template <typename T, typename OutF>
+		inline void svd3_block(const basic_mat<T, 3, 3> *m, size_t n, OutF out) {
+			constexpr size_t L = decompose_lanes;
+			T a[9][L], s[6][L], qv[4][L], v[9][L], b[9][L], qt[9][L];
+			for (size_t l = 0; l < L; ++l) {
+				// unused lanes run on the identity
+				T la[3][3], ls[6];
+				for (size_t r = 0; r < 3; ++r) {
+					for (size_t c = 0; c < 3; ++c) {
+						la[r][c] = l < n ? m[l][c][r] : T(r == c);
+						qt[r * 3 + c][l] = T(r == c);
+					}
+				}
+				svd3_normal_matrix(la, ls);
+				lane_set(a, l, la);
+				lane_set(s, l, ls);
+				qv[0][l] = qv[1][l] = qv[2][l] = T(0);
+				qv[3][l] = T(1);
+			}
+			for (int i = 0; i < svd3_sweeps<T>(); ++i) {
+				svd3_conjugate_lanes<0, 1, 2>(s, qv);
+				svd3_conjugate_lanes<1, 2, 0>(s, qv);
+				svd3_conjugate_lanes<2, 0, 1>(s, qv);
+			}
+			for (size_t l = 0; l < L; ++l) {
+				T la[3][3], lq[4], lv[3][3], lb[3][3];
+				lane_get(a, l, la);
+				lane_get(qv, l, lq);
+				svd3_quat_matrix(lq, lv);
+				svd3_sorted_product(la, lv, lb);
+				lane_set(v, l, lv);
+				lane_set(b, l, lb);
+			}
+			svd3_qr_step_lanes<0, 1, 0>(b, qt);
+			svd3_qr_step_lanes<0, 2, 0>(b, qt);
+			svd3_qr_step_lanes<1, 2, 1>(b, qt);
+			for (size_t l = 0; l < n; ++l) {
+				T u[3][3], sigma[3] = {b[0][l], b[4][l], b[8][l]}, lv[3][3];
+				for (size_t k = 0; k < 9; ++k) u[k % 3][k / 3] = qt[k][l];
+				lane_get(v, l, lv);
+				out(l, u, sigma, lv);
+			}
+		}
+
+	}
+
+	// 3x3 svd of every matrix in a; u, sigma and v may each be empty to skip that output
+	// threads = 0 uses every hardware thread
+	template <typename T>
+	inline void svd_batch(span<const basic_mat<T, 3, 3>> a, span<basic_mat<T, 3, 3>> u, span<basic_vec<T, 3>> sigma, span<basic_mat<T, 3, 3>> v, unsigned threads = 1) {
+		const size_t count = a.size();
+		assert(u.empty() || u.size() == count);
+		assert(sigma.empty() || sigma.size() == count);
+		assert(v.empty() || v.size() == count);
+		detail::decompose_batch(count, threads, [&](size_t i, size_t n) {
+			detail::svd3_block(a.data() + i, n, [&](size_t l, const T (&bu)[3][3], const T (&bs)[3], const T (&bv)[3][3]) {
+				if (!u.empty()) u[i + l] = detail::svd3_store(bu);
+				if (!sigma.empty()) sigma[i + l] = basic_vec<T, 3>(bs[0], bs[1], bs[2]);
+				if (!v.empty()) v[i + l] = detail::svd3_store(bv);
+			});
+		});
+	}
+
+	// 3x3 polar decomposition of every matrix in a; s may be empty to only compute the rotations
+	// threads = 0 uses every hardware thread
+	template <typename T>
+	inline void polar_batch(span<const basic_mat<T, 3, 3>> a, span<basic_mat<T, 3, 3>> r, span<basic_mat<T, 3, 3>> s, unsigned threads = 1) {
+		const size_t count = a.size();
+		assert(r.size() == count);
+		assert(s.empty() || s.size() == count);
+		detail::decompose_batch(count, threads, [&](size_t i, size_t n) {
+			detail::svd3_block(a.data() + i, n, [&](size_t l, const T (&bu)[3][3], const T (&bs)[3], const T (&bv)[3][3]) {
+				T br[3][3], bp[3][3];
+				detail::polar3_from_svd(bu, bs, bv, br, bp);
+				r[i + l] = detail::svd3_store(br);
+				if (!s.empty()) s[i + l] = detail::svd3_store(bp);
+			});
+		});
+	}
+
+
+	// translation, rotation and scale of an affine transform without shear
+	// the rotation about a zero-scale axis is completed from the other two; with more than
+	// one zero scale it is arbitrary but still a unit quaternion
+	template <typename T>
+	inline trs_result<T> decompose_trs(const basic_mat<T, 4, 4> &m) {
+		using vec_t = basic_vec<T, 3>;
+		const vec_t c0(m[0][0], m[0][1], m[0][2]), c1(m[1][0], m[1][1], m[1][2]), c2(m[2][0], m[2][1], m[2][2]);
+		vec_t s(length(c0), length(c1), length(c2));
+		// selects rather than branches, so the batch loop vectorizes
+		const T flip = dot(cross(c0, c1), c2) < T(0) ? T(-1) : T(1);
+		s[0] *= flip;
+		vec_t n0 = c0 * (s[0] != T(0) ? T(1) / s[0] : T(0));
+		vec_t n1 = c1 * (s[1] != T(0) ? T(1) / s[1] : T(0));
+		vec_t n2 = c2 * (s[2] != T(0) ? T(1) / s[2] : T(0));
+		// each completion is computed whether or not it is needed, later axes see earlier fixes
+		const vec_t f0 = cross(n1, n2);
+		n0 = s[0] == T(0) ? f0 : n0;
+		const vec_t f1 = cross(n2, n0);
+		n1 = s[1] == T(0) ? f1 : n1;
+		const vec_t f2 = cross(n0, n1);
+		n2 = s[2] == T(0) ? f2 : n2;
+		basic_mat<T, 3, 3> r;
+		r[0] = n0;
+		r[1] = n1;
+		r[2] = n2;
+		const auto q = detail::quat_from_rotation(r);
+		return trs_result<T>{vec_t(m[3][0], m[3][1], m[3][2]), q * (T(1) / abs(q)), s};
+	}
+
+	// translate3(t) * rotate3(q) * scale3(s), built directly; q must be unit length
+	template <typename T>
+	inline basic_mat<T, 4, 4> compose_trs(const basic_vec<T, 3> &t, const basic_quat<T> &q, const basic_vec<T, 3> &s) {
+		basic_mat<T, 4, 4> m(q);
+		for (size_t j = 0; j < 3; ++j) {
+			for (size_t i = 0; i < 3; ++i) m[j][i] *= s[j];
+			m[3][j] = t[j];
+		}
+		m[3][3] = T(1);
+		return m;
+	}
+
+	template <typename T>
+	inline basic_mat<T, 4, 4> compose_trs(const trs_result<T> &d) {
+		return compose_trs(d.translation, d.rotation, d.scale);
+	}
+
+	// quat_from_matrix of every matrix in m
+	// threads = 0 uses every hardware thread
+	template <typename T, size_t N>
+	inline void quat_from_matrix_batch(span<const basic_mat<T, N, N>> m, span<basic_quat<T>> out, unsigned threads = 1) {
+		static_assert(N == 3 || N == 4, "rotation matrices are 3x3 or 4x4");
+		assert(out.size() == m.size());
+		detail::decompose_batch(m.size(), threads, [&](size_t i, size_t n) {
+			for (size_t k = i; k < i + n; ++k) out[k] = detail::quat_from_rotation(m[k]);
+		});
+	}
+
+	// decompose_trs of every matrix in m, for baking animation
+	// threads = 0 uses every hardware thread
+	template <typename T>
+	inline void decompose_trs_batch(span<const basic_mat<T, 4, 4>> m, span<trs_result<T>> out, unsigned threads = 1) {
+		assert(out.size() == m.size());
+		detail::decompose_batch(m.size(), threads, [&](size_t i, size_t n) {
+			for (size_t k = i; k < i + n; ++k) out[k] = decompose_trs(m[k]);
+		});
+	}
+
+	// compose_trs of every entry in d
+	// threads = 0 uses every hardware thread
+	template <typename T>
+	inline void compose_trs_batch(span<const trs_result<T>> d, span<basic_mat<T, 4, 4>> out, unsigned threads = 1) {
+		assert(out.size() == d.size());
+		detail::decompose_batch(d.size(), threads, [&](size_t i, size_t n) {
+			for (size_t k = i; k < i + n; ++k) out[k] = compose_trs(d[k]);
+		});
+	}
+
+}
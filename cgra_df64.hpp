@@ -0,0 +1,229 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Double-Float Arithmetic
+//
+// df64, an unevaluated sum of two floats with about 48 bits of significand,
+// for large-world coordinates that do not fit in a float. It plugs into
+// basic_vec like std::complex does, and the camera-relative helpers subtract
+// the eye in df64 before rounding to float for the GPU.
+//
+// The error-free transforms rely on IEEE rounding of every float operation;
+// they break under -ffast-math (or /fp:fast) and with x87 excess precision.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include "cgra_math.hpp"
+#include "cgra_parallel.hpp"
+
+namespace cgra {
+
+	namespace detail {
+		namespace scalars {
+
+			// double-float, value is hi + lo with |lo| <= ulp(hi) / 2
+			class df64 {
+			public:
+				float hi;
+				float lo;
+
+				df64() : hi(0), lo(0) { }
+
+				// exact for floats and integers that fit in 24 bits
+				df64(float x) : hi(x), lo(0) { }
+
+				// rounds to the nearest df64
+				df64(double x) : hi(float(x)), lo(float(x - double(float(x)))) { }
+
+				template <typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+				df64(T x) : df64(double(x)) { }
+
+				// already normalized pair
+				static df64 from_parts(float hi_, float lo_) {
+					df64 r;
+					r.hi = hi_;
+					r.lo = lo_;
+					return r;
+				}
+
+				explicit operator float() const { return hi + lo; }
+
+				explicit operator double() const { return double(hi) + double(lo); }
+
+				df64 & operator+=(const df64 &rhs);
+				df64 & operator-=(const df64 &rhs);
+				df64 & operator*=(const df64 &rhs);
+				df64 & operator/=(const df64 &rhs);
+			};
+
+			// a + b = s.hi + s.lo exactly, for any a and b
+			inline df64 two_sum(float a, float b) {
+				const float s = a + b;
+				const float bb = s - a;
+				const float e = (a - (s - bb)) + (b - bb);
+				return df64::from_parts(s, e);
+			}
+
+			// a + b = s.hi + s.lo exactly, if |a| >= |b|
+			inline df64 quick_two_sum(float a, float b) {
+				const float s = a + b;
+				return df64::from_parts(s, b - (s - a));
+			}
+
+			// a * b = p.hi + p.lo exactly, barring overflow and underflow
+			inline df64 two_prod(float a, float b) {
+				const float p = a * b;
+#ifdef FP_FAST_FMAF
+				return df64::from_parts(p, std::fma(a, b, -p));
+#else
+				// Dekker's split into 12-bit halves, whose products are exact
+				const float ca = 4097.f * a, cb = 4097.f * b;
+				const float ah = ca - (ca - a), al = a - ah;
+				const float bh = cb - (cb - b), bl = b - bh;
+				return df64::from_parts(p, ((ah * bh - p) + ah * bl + al * bh) + al * bl);
+#endif
+			}
+
+			inline df64 operator-(const df64 &x) {
+				return df64::from_parts(-x.hi, -x.lo);
+			}
+
+			inline df64 operator+(const df64 &a, const df64 &b) {
+				df64 s = two_sum(a.hi, b.hi);
+				const df64 t = two_sum(a.lo, b.lo);
+				s = quick_two_sum(s.hi, s.lo + t.hi);
+				return quick_two_sum(s.hi, s.lo + t.lo);
+			}
+
+			inline df64 operator-(const df64 &a, const df64 &b) {
+				return a + -b;
+			}
+
+			inline df64 operator*(const df64 &a, const df64 &b) {
+				const df64 p = two_prod(a.hi, b.hi);
+				return quick_two_sum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+			}
+
+			inline df64 operator/(const df64 &a, const df64 &b) {
+				// long division, each quotient digit corrects the remainder of the last
+				const float q1 = a.hi / b.hi;
+				df64 r = a - b * df64(q1);
+				const float q2 = r.hi / b.hi;
+				r = r - b * df64(q2);
+				const float q3 = r.hi / b.hi;
+				return quick_two_sum(q1, q2) + df64(q3);
+			}
+
+			inline df64 & df64::operator+=(const df64 &rhs) { return *this = *this + rhs; }
+			inline df64 & df64::operator-=(const df64 &rhs) { return *this = *this - rhs; }
+			inline df64 & df64::operator*=(const df64 &rhs) { return *this = *this * rhs; }
+			inline df64 & df64::operator/=(const df64 &rhs) { return *this = *this / rhs; }
+
+			// normalized pairs compare lexicographically
+			inline bool operator==(const df64 &a, const df64 &b) { return a.hi == b.hi && a.lo == b.lo; }
+			inline bool operator!=(const df64 &a, const df64 &b) { return !(a == b); }
+			inline bool operator<(const df64 &a, const df64 &b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+			inline bool operator>(const df64 &a, const df64 &b) { return b < a; }
+			inline bool operator<=(const df64 &a, const df64 &b) { return !(b < a); }
+			inline bool operator>=(const df64 &a, const df64 &b) { return !(a < b); }
+
+			inline df64 abs(const df64 &x) {
+				return x.hi < 0 ? -x : x;
+			}
+
+			// one Newton step from the float square root (Karp's method)
+			inline df64 sqrt(const df64 &x) {
+				if (!(x.hi > 0)) return df64(std::sqrt(x.hi));
+				const float r = 1.f / std::sqrt(x.hi);
+				const float y = x.hi * r;
+				const df64 yy = two_prod(y, y);
+				return quick_two_sum(y, (x - yy).hi * (r * 0.5f));
+			}
+
+			inline df64 min(const df64 &a, const df64 &b) { return b < a ? b : a; }
+			inline df64 max(const df64 &a, const df64 &b) { return a < b ? b : a; }
+		}
+
+		template <>
+		struct scalar_traits<scalars::df64, void> {
+			using fpromote_t = scalars::df64;
+			static constexpr bool is_scalar = true;
+			static constexpr bool want_real_fns = false;
+			static constexpr bool want_trig_fns = false;
+			static constexpr bool want_exp_fns = false;
+			static constexpr bool want_linear_fns = true;
+			static constexpr bool want_bool_fns = false;
+		};
+	}
+
+	using df64 = detail::scalars::df64;
+
+	using detail::scalars::two_sum;
+	using detail::scalars::two_prod;
+
+
+	namespace detail {
+
+		// float(a - b) without the renormalization a full df64 subtraction does
+		inline float df64_sub_to_float(const df64 &a, const df64 &b) {
+			const df64 s = scalars::two_sum(a.hi, -b.hi);
+			return s.hi + (s.lo + (a.lo - b.lo));
+		}
+	}
+
+	// camera-relative position, p - eye subtracted in df64 and rounded to float
+	// keeps full float precision near the eye however far both are from the origin
+	inline basic_vec<float, 3> camera_relative(const basic_vec<df64, 3> &p, const basic_vec<df64, 3> &eye) {
+		return basic_vec<float, 3>(
+			detail::df64_sub_to_float(p.x, eye.x),
+			detail::df64_sub_to_float(p.y, eye.y),
+			detail::df64_sub_to_float(p.z, eye.z)
+		);
+	}
+
+	// model matrix relative to the eye, from a float rotation-scale part and a df64 position
+	// pair with a view matrix built with the eye at the origin
+	inline basic_mat<float, 4, 4> camera_relative(const basic_mat<float, 3, 3> &linear, const basic_vec<df64, 3> &position, const basic_vec<df64, 3> &eye) {
+		basic_mat<float, 4, 4> m{1.f};
+		for (size_t j = 0; j < 3; ++j) {
+			for (size_t i = 0; i < 3; ++i) m[j][i] = linear[j][i];
+		}
+		const basic_vec<float, 3> t = camera_relative(position, eye);
+		m[3][0] = t.x;
+		m[3][1] = t.y;
+		m[3][2] = t.z;
+		return m;
+	}
+
+	// out[i] = camera_relative(p[i], eye); threads = 0 uses every hardware thread
+	inline void camera_relative_batch(span<const basic_vec<df64, 3>> p, const basic_vec<df64, 3> &eye, span<basic_vec<float, 3>> out, unsigned threads = 1) {
+		assert(out.size() == p.size());
+		const unsigned nthreads = std::min<unsigned>(detail::resolve_thread_count(threads), unsigned(p.size() / 16384 + 1));
+		detail::parallel_for(p.size(), nthreads, [&](size_t i0, size_t i1, unsigned) {
+			for (size_t i = i0; i < i1; ++i) out[i] = camera_relative(p[i], eye);
+		});
+	}
+
+
+#ifdef CGRA_INITIAL3D_NAMES
+
+	using vec2df = basic_vec<df64, 2>;
+	using vec3df = basic_vec<df64, 3>;
+	using vec4df = basic_vec<df64, 4>;
+
+#else
+
+	using dfvec2 = basic_vec<df64, 2>;
+	using dfvec3 = basic_vec<df64, 3>;
+	using dfvec4 = basic_vec<df64, 4>;
+
+#endif
+
+}
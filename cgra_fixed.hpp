@@ -0,0 +1,435 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Fixed-Point Arithmetic
+//
+// fixed<IntBits, FracBits>, a 32-bit two's complement fixed-point scalar
+// for lockstep simulation that must give bit-identical results on every
+// machine. It plugs into basic_vec, basic_mat and basic_quat like df64 does.
+// Everything is integer arithmetic: sqrt is a table-seeded exact integer
+// square root, and sin, cos and atan interpolate fixed tables, so no result
+// depends on the compiler, the flags or the platform's libm.
+//
+// Overflow wraps, except in division, which saturates. Conversions from
+// floating point are only as deterministic as the values converted, so they
+// are explicit.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "cgra_math.hpp"
+
+namespace cgra {
+
+	namespace detail {
+
+		// quarter turn of sin and eighth turn of atan, 256 segments each, in Q30
+		// (one past the end so interpolation at the last point stays in bounds),
+		// and sqrt(i + 1/2) * 2^28 for the top byte i of a normalized integer
+		template <typename = void>
+		struct fixed_tables {
+			static constexpr std::uint32_t sqrt_seed[192] {
+				2155855936, 2172503719, 2189024898, 2205422317, 2221698718, 2237856739, 2253898928, 2269827741,
+				2285645547, 2301354636, 2316957219, 2332455434, 2347851346, 2363146956, 2378344200, 2393444949,
+				2408451021, 2423364173, 2438186110, 2452918487, 2467562906, 2482120926, 2496594057, 2510983767,
+				2525291483, 2539518589, 2553666435, 2567736329, 2581729546, 2595647326, 2609490877, 2623261373,
+				2636959959, 2650587750, 2664145832, 2677635264, 2691057079, 2704412283, 2717701858, 2730926763,
+				2744087932, 2757186278, 2770222692, 2783198045, 2796113187, 2808968947, 2821766139, 2834505554,
+				2847187969, 2859814141, 2872384814, 2884900711, 2897362543, 2909771005, 2922126776, 2934430522,
+				2946682895, 2958884532, 2971036060, 2983138090, 2995191222, 3007196045, 3019153134, 3031063054,
+				3042926360, 3054743594, 3066515290, 3078241968, 3089924143, 3101562317, 3113156983, 3124708625,
+				3136217720, 3147684733, 3159110124, 3170494341, 3181837828, 3193141017, 3204404336, 3215628204,
+				3226813031, 3237959223, 3249067178, 3260137286, 3271169931, 3282165491, 3293124338, 3304046836,
+				3314933346, 3325784221, 3336599808, 3347380449, 3358126482, 3368838236, 3379516039, 3390160210,
+				3400771066, 3411348918, 3421894071, 3432406827, 3442887483, 3453336331, 3463753659, 3474139750,
+				3484494884, 3494819336, 3505113377, 3515377274, 3525611290, 3535815686, 3545990716, 3556136633,
+				3566253685, 3576342118, 3586402172, 3596434085, 3606438094, 3616414428, 3626363318, 3636284987,
+				3646179658, 3656047551, 3665888881, 3675703862, 3685492705, 3695255616, 3704992802, 3714704464,
+				3724390803, 3734052014, 3743688294, 3753299833, 3762886821, 3772449446, 3781987892, 3791502342,
+				3800992976, 3810459972, 3819903506, 3829323751, 3838720878, 3848095058, 3857446457, 3866775241,
+				3876081573, 3885365614, 3894627523, 3903867459, 3913085577, 3922282031, 3931456972, 3940610551,
+				3949742917, 3958854216, 3967944594, 3977014193, 3986063156, 3995091623, 4004099733, 4013087623,
+				4022055427, 4031003282, 4039931317, 4048839666, 4057728458, 4066597820, 4075447880, 4084278764,
+				4093090594, 4101883495, 4110657588, 4119412992, 4128149826, 4136868210, 4145568258, 4154250085,
+				4162913807, 4171559536, 4180187383, 4188797458, 4197389873, 4205964733, 4214522147, 4223062221,
+				4231585060, 4240090767, 4248579446, 4257051198, 4265506124, 4273944324, 4282365898, 4290770942
+			};
+
+			static constexpr std::int32_t sin_q30[258] {
+				0, 6588356, 13176464, 19764076, 26350943, 32936819, 39521455, 46104602,
+				52686014, 59265442, 65842639, 72417357, 78989349, 85558366, 92124163, 98686491,
+				105245103, 111799753, 118350194, 124896179, 131437462, 137973796, 144504935, 151030634,
+				157550647, 164064728, 170572633, 177074115, 183568930, 190056834, 196537583, 203010932,
+				209476638, 215934457, 222384147, 228825464, 235258165, 241682010, 248096755, 254502159,
+				260897982, 267283981, 273659918, 280025552, 286380643, 292724951, 299058239, 305380268,
+				311690799, 317989595, 324276419, 330551034, 336813204, 343062693, 349299266, 355522689,
+				361732726, 367929144, 374111709, 380280190, 386434353, 392573967, 398698801, 404808624,
+				410903207, 416982319, 423045732, 429093217, 435124548, 441139496, 447137835, 453119340,
+				459083786, 465030947, 470960600, 476872522, 482766489, 488642281, 494499676, 500338453,
+				506158392, 511959275, 517740883, 523502998, 529245404, 534967884, 540670223, 546352205,
+				552013618, 557654248, 563273883, 568872310, 574449320, 580004702, 585538248, 591049748,
+				596538995, 602005783, 607449906, 612871159, 618269338, 623644239, 628995660, 634323400,
+				639627258, 644907034, 650162530, 655393548, 660599890, 665781362, 670937767, 676068911,
+				681174602, 686254647, 691308855, 696337036, 701339000, 706314559, 711263525, 716185713,
+				721080937, 725949013, 730789757, 735602987, 740388522, 745146182, 749875788, 754577161,
+				759250125, 763894504, 768510122, 773096806, 777654384, 782182683, 786681534, 791150767,
+				795590213, 799999706, 804379079, 808728167, 813046808, 817334838, 821592095, 825818421,
+				830013654, 834177638, 838310216, 842411232, 846480531, 850517961, 854523370, 858496606,
+				862437520, 866345964, 870221790, 874064853, 877875009, 881652112, 885396022, 889106597,
+				892783698, 896427186, 900036924, 903612776, 907154608, 910662286, 914135678, 917574653,
+				920979082, 924348837, 927683790, 930983817, 934248793, 937478595, 940673101, 943832191,
+				946955747, 950043650, 953095785, 956112036, 959092290, 962036435, 964944360, 967815955,
+				970651112, 973449725, 976211688, 978936898, 981625251, 984276646, 986890984, 989468165,
+				992008094, 994510675, 996975812, 999403415, 1001793390, 1004145648, 1006460100, 1008736660,
+				1010975242, 1013175761, 1015338134, 1017462281, 1019548121, 1021595575, 1023604567, 1025575020,
+				1027506862, 1029400018, 1031254418, 1033069992, 1034846671, 1036584389, 1038283080, 1039942680,
+				1041563127, 1043144360, 1044686319, 1046188946, 1047652185, 1049075980, 1050460278, 1051805027,
+				1053110176, 1054375676, 1055601479, 1056787540, 1057933813, 1059040255, 1060106826, 1061133483,
+				1062120190, 1063066909, 1063973603, 1064840240, 1065666786, 1066453210, 1067199483, 1067905576,
+				1068571464, 1069197120, 1069782521, 1070327646, 1070832474, 1071296985, 1071721163, 1072104991,
+				1072448455, 1072751542, 1073014240, 1073236540, 1073418433, 1073559913, 1073660973, 1073721611,
+				1073741824,
+				1073741824
+			};
+
+			static constexpr std::int32_t atan_q30[258] {
+				0, 4194283, 8388437, 12582336, 16775851, 20968854, 25161218, 29352814,
+				33543516, 37733196, 41921726, 46108981, 50294833, 54479155, 58661822, 62842708,
+				67021687, 71198634, 75373424, 79545932, 83716036, 87883610, 92048532, 96210679,
+				100369930, 104526161, 108679253, 112829084, 116975536, 121118487, 125257820, 129393416,
+				133525159, 137652930, 141776614, 145896097, 150011262, 154121996, 158228185, 162329719,
+				166426484, 170518371, 174605269, 178687069, 182763663, 186834944, 190900805, 194961140,
+				199015846, 203064818, 207107953, 211145151, 215176309, 219201328, 223220110, 227232556,
+				231238569, 235238055, 239230917, 243217063, 247196400, 251168835, 255134279, 259092643,
+				263043837, 266987774, 270924369, 274853536, 278775192, 282689253, 286595638, 290494267,
+				294385059, 298267937, 302142824, 306009643, 309868320, 313718782, 317560955, 321394768,
+				325220151, 329037035, 332845353, 336645037, 340436023, 344218245, 347991640, 351756148,
+				355511705, 359258254, 362995735, 366724092, 370443267, 374153206, 377853855, 381545162,
+				385227074, 388899541, 392562515, 396215946, 399859787, 403493994, 407118521, 410733324,
+				414338361, 417933591, 421518973, 425094468, 428660037, 432215645, 435761254, 439296830,
+				442822340, 446337750, 449843028, 453338145, 456823070, 460297774, 463762232, 467216414,
+				470660297, 474093856, 477517067, 480929907, 484332355, 487724391, 491105994, 494477146,
+				497837829, 501188027, 504527723, 507856902, 511175551, 514483656, 517781204, 521068185,
+				524344587, 527610402, 530865619, 534110231, 537344232, 540567613, 543780370, 546982499,
+				550173994, 553354853, 556525073, 559684652, 562833591, 565971887, 569099543, 572216558,
+				575322936, 578418678, 581503788, 584578271, 587642129, 590695370, 593737999, 596770023,
+				599791448, 602802283, 605802536, 608792216, 611771334, 614739898, 617697921, 620645413,
+				623582386, 626508854, 629424828, 632330323, 635225352, 638109930, 640984073, 643847795,
+				646701114, 649544044, 652376604, 655198810, 658010682, 660812236, 663603492, 666384468,
+				669155185, 671915663, 674665921, 677405981, 680135863, 682855589, 685565182, 688264663,
+				690954054, 693633380, 696302662, 698961924, 701611191, 704250487, 706879836, 709499262,
+				712108791, 714708448, 717298260, 719878250, 722448447, 725008876, 727559563, 730100536,
+				732631822, 735153448, 737665442, 740167831, 742660643, 745143906, 747617650, 750081902,
+				752536690, 754982045, 757417995, 759844569, 762261796, 764669707, 767068330, 769457696,
+				771837835, 774208776, 776570551, 778923188, 781266719, 783601175, 785926586, 788242982,
+				790550395, 792848855, 795138394, 797419043, 799690833, 801953796, 804207961, 806453363,
+				808690030, 810917996, 813137292, 815347949, 817549999, 819743474, 821928406, 824104826,
+				826272767, 828432260, 830583337, 832726030, 834860371, 836986393, 839104126, 841213603,
+				843314857,
+				843314857
+			};
+		};
+
+		template <typename D>
+		constexpr std::uint32_t fixed_tables<D>::sqrt_seed[192];
+
+		template <typename D>
+		constexpr std::int32_t fixed_tables<D>::sin_q30[258];
+
+		template <typename D>
+		constexpr std::int32_t fixed_tables<D>::atan_q30[258];
+
+		// v / 2^S rounded to nearest, ties up; relies on arithmetic right shift of negative values
+		template <int S>
+		inline std::int64_t fixed_round_shift(std::int64_t v) {
+			return S > 0 ? (v + (std::int64_t(1) << (S > 0 ? S - 1 : 0))) >> S : v;
+		}
+
+		// two's complement wrap to 32 bits
+		inline std::int32_t fixed_wrap(std::uint64_t v) {
+			return std::int32_t(std::uint32_t(v));
+		}
+
+		// table value at a Q(Bits) position over 256 segments, interpolated linearly
+		template <int Bits>
+		inline std::int64_t fixed_lerp_table(const std::int32_t *table, std::uint32_t x) {
+			const std::uint32_t i = x >> (Bits - 8);
+			const std::int64_t f = x & ((std::uint32_t(1) << (Bits - 8)) - 1);
+			return table[i] + ((std::int64_t(table[i + 1] - table[i]) * f) >> (Bits - 8));
+		}
+
+		// sqrt(n) rounded to nearest, for n < 2^62
+		inline std::uint64_t fixed_isqrt(std::uint64_t n) {
+			// bit length by binary search, then an even shift so the top byte indexes the seed table
+			std::uint64_t m = n | (n == 0);
+			int e = 0;
+			for (int s = 32; s > 0; s >>= 1) {
+				const int b = int((m >> s) != 0) * s;
+				m >>= b;
+				e += b;
+			}
+			const int k = (63 - e) & ~1;
+			m = (n | (n == 0)) << k;
+			// two Newton steps take the 8-bit seed past 32 bits
+			std::uint64_t r = fixed_tables<>::sqrt_seed[(m >> 56) - 64];
+			r = (r + m / r) >> 1;
+			r = (r + m / r) >> 1;
+			r >>= k / 2;
+			// within one of floor(sqrt(n)), which integer checks make exact
+			r -= r * r > n;
+			r += (r + 1) * (r + 1) <= n;
+			return r + (n - r * r > r);
+		}
+
+		// x / 2pi for x in Q(F) radians, as a Q30 fraction of a turn in the low 30 bits
+		// bits 32 to 61 of the product survive 64-bit wraparound, so the reduction
+		// needs no division and works for negative x
+		template <int F>
+		inline std::uint32_t fixed_turns(std::int32_t x) {
+			const std::uint64_t inv_2pi = std::uint64_t(0x28BE60DB9391054A) >> (F + 2);
+			return std::uint32_t((std::uint64_t(std::int64_t(x)) * inv_2pi) >> 32);
+		}
+
+		// sin of a Q30 fraction of a turn (higher bits ignored), in Q30
+		inline std::int64_t fixed_sin_phase(std::uint32_t phase) {
+			const std::uint32_t quadrant = (phase >> 28) & 3;
+			// mirrored in odd quadrants, q becomes a quarter turn - q
+			const std::uint32_t odd = 0 - (quadrant & 1);
+			const std::uint32_t q = ((phase & ((std::uint32_t(1) << 28) - 1)) ^ odd) - odd + ((std::uint32_t(1) << 28) & odd);
+			const std::int64_t v = fixed_lerp_table<28>(fixed_tables<>::sin_q30, q);
+			// negated in the second half turn
+			const std::int64_t neg = -std::int64_t(quadrant >> 1);
+			return (v ^ neg) - neg;
+		}
+
+		namespace scalars {
+
+			// fixed-point value raw / 2^FracBits, IntBits includes the sign bit
+			template <int IntBits, int FracBits>
+			class fixed {
+				static_assert(IntBits >= 2 && FracBits >= 1 && FracBits <= 30, "fixed needs 2 to 31 integer bits and 1 to 30 fractional bits");
+				static_assert(IntBits + FracBits <= 32, "fixed is stored in 32 bits");
+
+			public:
+				static constexpr int int_bits = IntBits;
+				static constexpr int frac_bits = FracBits;
+
+				std::int32_t raw;
+
+				fixed() : raw(0) { }
+
+				template <typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+				fixed(T x) : raw(fixed_wrap(std::uint64_t(x) << FracBits)) { }
+
+				// rounds to the nearest fixed
+				template <typename T, std::enable_if_t<std::is_floating_point<T>::value, int> = 0>
+				explicit fixed(T x) : raw(fixed_wrap(std::uint64_t(std::llround(std::ldexp(double(x), FracBits))))) { }
+
+				static fixed from_raw(std::int32_t r) {
+					fixed f;
+					f.raw = r;
+					return f;
+				}
+
+				explicit operator double() const { return std::ldexp(double(raw), -FracBits); }
+
+				explicit operator float() const { return float(double(*this)); }
+
+				friend fixed operator-(const fixed &x) {
+					return from_raw(fixed_wrap(0 - std::uint64_t(std::int64_t(x.raw))));
+				}
+
+				friend fixed operator+(const fixed &a, const fixed &b) {
+					return from_raw(fixed_wrap(std::uint64_t(std::int64_t(a.raw)) + std::uint64_t(std::int64_t(b.raw))));
+				}
+
+				friend fixed operator-(const fixed &a, const fixed &b) {
+					return from_raw(fixed_wrap(std::uint64_t(std::int64_t(a.raw)) - std::uint64_t(std::int64_t(b.raw))));
+				}
+
+				// 64-bit product, rounded to nearest
+				friend fixed operator*(const fixed &a, const fixed &b) {
+					return from_raw(fixed_wrap(std::uint64_t(fixed_round_shift<FracBits>(std::int64_t(a.raw) * b.raw))));
+				}
+
+				// truncates toward zero; quotients out of range, including division by zero,
+				// saturate to the extreme with the sign of a (which isinf reports)
+				friend fixed operator/(const fixed &a, const fixed &b) {
+					const std::int64_t n = std::int64_t(a.raw) * (std::int64_t(1) << FracBits);
+					const std::int64_t q = b.raw != 0 ? n / b.raw : (a.raw < 0 ? INT32_MIN : INT32_MAX);
+					return from_raw(std::int32_t(std::min<std::int64_t>(std::max<std::int64_t>(q, INT32_MIN), INT32_MAX)));
+				}
+
+				fixed & operator+=(const fixed &rhs) { return *this = *this + rhs; }
+				fixed & operator-=(const fixed &rhs) { return *this = *this - rhs; }
+				fixed & operator*=(const fixed &rhs) { return *this = *this * rhs; }
+				fixed & operator/=(const fixed &rhs) { return *this = *this / rhs; }
+
+				friend bool operator==(const fixed &a, const fixed &b) { return a.raw == b.raw; }
+				friend bool operator!=(const fixed &a, const fixed &b) { return a.raw != b.raw; }
+				friend bool operator<(const fixed &a, const fixed &b) { return a.raw < b.raw; }
+				friend bool operator>(const fixed &a, const fixed &b) { return a.raw > b.raw; }
+				friend bool operator<=(const fixed &a, const fixed &b) { return a.raw <= b.raw; }
+				friend bool operator>=(const fixed &a, const fixed &b) { return a.raw >= b.raw; }
+			};
+
+			template <int I, int F>
+			inline fixed<I, F> abs(const fixed<I, F> &x) {
+				const std::int64_t v = x.raw, m = v >> 63;
+				return fixed<I, F>::from_raw(fixed_wrap(std::uint64_t((v ^ m) - m)));
+			}
+
+			// the extremes stand in for infinity, so a singular inverse throws as it does for float
+			template <int I, int F>
+			inline bool isinf(const fixed<I, F> &x) { return x.raw == INT32_MAX || x.raw == INT32_MIN; }
+
+			template <int I, int F>
+			inline bool isnan(const fixed<I, F> &) { return false; }
+
+			template <int I, int F>
+			inline fixed<I, F> min(const fixed<I, F> &a, const fixed<I, F> &b) { return b < a ? b : a; }
+
+			template <int I, int F>
+			inline fixed<I, F> max(const fixed<I, F> &a, const fixed<I, F> &b) { return a < b ? b : a; }
+
+			template <int I, int F>
+			inline fixed<I, F> floor(const fixed<I, F> &x) {
+				return fixed<I, F>::from_raw(std::int32_t(x.raw & ~((std::int32_t(1) << F) - 1)));
+			}
+
+			// exact integer square root, rounded to nearest; negative x gives 0
+			template <int I, int F>
+			inline fixed<I, F> sqrt(const fixed<I, F> &x) {
+				return fixed<I, F>::from_raw(std::int32_t(fixed_isqrt(std::uint64_t(std::uint32_t(x.raw & ~(x.raw >> 31))) << F)));
+			}
+
+			// sin of x radians, within about 5e-6 plus rounding to F bits
+			template <int I, int F>
+			inline fixed<I, F> sin(const fixed<I, F> &x) {
+				return fixed<I, F>::from_raw(std::int32_t(fixed_round_shift<30 - F>(fixed_sin_phase(fixed_turns<F>(x.raw)))));
+			}
+
+			// cos of x radians, within about 5e-6 plus rounding to F bits
+			template <int I, int F>
+			inline fixed<I, F> cos(const fixed<I, F> &x) {
+				const std::uint32_t quarter_turn = std::uint32_t(1) << 28;
+				return fixed<I, F>::from_raw(std::int32_t(fixed_round_shift<30 - F>(fixed_sin_phase(fixed_turns<F>(x.raw) + quarter_turn))));
+			}
+
+			// angle of (x, y) in [-pi, pi] radians, within about 2e-6 plus rounding to F bits
+			template <int I, int F>
+			inline fixed<I, F> atan(const fixed<I, F> &y, const fixed<I, F> &x) {
+				static_assert(I >= 3, "atan needs 3 integer bits to hold pi");
+				const std::int64_t ax = std::abs(std::int64_t(x.raw)), ay = std::abs(std::int64_t(y.raw));
+				const bool steep = ay > ax;
+				const std::int64_t lo = steep ? ax : ay, hi = steep ? ay : ax;
+				// ratio in [0, 1] as Q30, 0 for the origin
+				const std::int64_t t = (lo << 30) / (hi + (hi == 0));
+				std::int64_t a = fixed_lerp_table<30>(fixed_tables<>::atan_q30, std::uint32_t(t));
+				const std::int64_t half_pi = 1686629713, pi = 3373259426;
+				a = steep ? half_pi - a : a;
+				a = x.raw < 0 ? pi - a : a;
+				a = y.raw < 0 ? -a : a;
+				return fixed<I, F>::from_raw(std::int32_t(fixed_round_shift<30 - F>(a)));
+			}
+
+			// arc tangent of x in [-pi/2, pi/2] radians, within about 2e-6 plus rounding to F bits
+			// unlike atan(y, x) this only needs the 2 integer bits every fixed has to hold pi/2
+			template <int I, int F>
+			inline fixed<I, F> atan(const fixed<I, F> &x) {
+				const std::int64_t ax = std::abs(std::int64_t(x.raw)), one = std::int64_t(1) << F;
+				const bool steep = ax > one;
+				const std::int64_t lo = steep ? one : ax, hi = steep ? ax : one;
+				// ratio in [0, 1] as Q30
+				const std::int64_t t = (lo << 30) / hi;
+				std::int64_t a = fixed_lerp_table<30>(fixed_tables<>::atan_q30, std::uint32_t(t));
+				const std::int64_t half_pi = 1686629713;
+				a = steep ? half_pi - a : a;
+				a = x.raw < 0 ? -a : a;
+				return fixed<I, F>::from_raw(std::int32_t(fixed_round_shift<30 - F>(a)));
+			}
+		}
+
+		template <int I, int F>
+		struct scalar_traits<scalars::fixed<I, F>, void> {
+			using fpromote_t = scalars::fixed<I, F>;
+			static constexpr bool is_scalar = true;
+			static constexpr bool want_real_fns = false;
+			static constexpr bool want_trig_fns = false;
+			static constexpr bool want_exp_fns = false;
+			static constexpr bool want_linear_fns = true;
+			static constexpr bool want_bool_fns = false;
+		};
+
+		// fpromote_arith_t starts from float; fixed stays fixed, with no float arithmetic to promote to
+		template <int I, int F>
+		struct arith_result2<float, scalars::fixed<I, F>> {
+			using type = scalars::fixed<I, F>;
+		};
+
+		template <typename T>
+		struct is_fixed : std::false_type {};
+
+		template <int I, int F>
+		struct is_fixed<scalars::fixed<I, F>> : std::true_type {};
+	}
+
+	// eg: cgra::fixed<16, 16>; qualify it where both std and cgra are used, as it shares a name with std::fixed
+	template <int IntBits, int FracBits>
+	using fixed = detail::scalars::fixed<IntBits, FracBits>;
+
+
+	// SoA batches over raw values; straight-line integer loops that compilers can vectorize,
+	// bit-identical to the scalar operators
+
+	// out[i] = a[i] * s + c[i], eg: integrating positions from velocities with a fixed time step
+	template <typename T>
+	inline void mul_add_batch(span<const T> a, const T &s, span<const T> c, span<T> out) {
+		static_assert(detail::is_fixed<T>::value, "mul_add_batch is for fixed");
+		assert(c.size() == a.size() && out.size() == a.size());
+		const std::int64_t sr = s.raw;
+		for (size_t i = 0; i < a.size(); ++i) {
+			const std::int64_t p = detail::fixed_round_shift<T::frac_bits>(a[i].raw * sr);
+			out[i].raw = detail::fixed_wrap(std::uint64_t(p) + std::uint64_t(std::int64_t(c[i].raw)));
+		}
+	}
+
+	// out[i] = dot((ax[i], ay[i], az[i]), (bx[i], by[i], bz[i])), each product rounded as dot does
+	template <typename T>
+	inline void dot_batch(span<const T> ax, span<const T> ay, span<const T> az, span<const T> bx, span<const T> by, span<const T> bz, span<T> out) {
+		static_assert(detail::is_fixed<T>::value, "dot_batch is for fixed");
+		const size_t count = out.size();
+		assert(ax.size() == count && ay.size() == count && az.size() == count);
+		assert(bx.size() == count && by.size() == count && bz.size() == count);
+		for (size_t i = 0; i < count; ++i) {
+			const std::int64_t x = detail::fixed_round_shift<T::frac_bits>(std::int64_t(ax[i].raw) * bx[i].raw);
+			const std::int64_t y = detail::fixed_round_shift<T::frac_bits>(std::int64_t(ay[i].raw) * by[i].raw);
+			const std::int64_t z = detail::fixed_round_shift<T::frac_bits>(std::int64_t(az[i].raw) * bz[i].raw);
+			// wrapping is the same whether it happens per add or once at the end
+			out[i].raw = detail::fixed_wrap(std::uint64_t(x) + std::uint64_t(y) + std::uint64_t(z));
+		}
+	}
+
+
+#ifdef CGRA_INITIAL3D_NAMES
+
+	using vec2x = basic_vec<fixed<16, 16>, 2>;
+	using vec3x = basic_vec<fixed<16, 16>, 3>;
+	using vec4x = basic_vec<fixed<16, 16>, 4>;
+
+#else
+
+	using xvec2 = basic_vec<fixed<16, 16>, 2>;
+	using xvec3 = basic_vec<fixed<16, 16>, 3>;
+	using xvec4 = basic_vec<fixed<16, 16>, 4>;
+
+#endif
+
+}
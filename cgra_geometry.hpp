@@ -0,0 +1,663 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Geometry
+//
+// Bounding boxes, rays, frustums and their intersection and culling tests,
+// and batch rotation of points.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "cgra_math.hpp"
+#include "cgra_parallel.hpp"
+
+namespace cgra {
+
+	// axis-aligned bounding box
+	// a default constructed box is empty (lower > upper) and expands to fit anything
+	template <typename T, size_t N>
+	class basic_aabb {
+	public:
+		using value_t = T;
+		using vec_t = basic_vec<T, N>;
+
+		vec_t lower;
+		vec_t upper;
+
+		basic_aabb() : lower(std::numeric_limits<T>::max()), upper(std::numeric_limits<T>::lowest()) { }
+
+		explicit basic_aabb(const vec_t &p) : lower(p), upper(p) { }
+
+		basic_aabb(const vec_t &lower_, const vec_t &upper_) : lower(lower_), upper(upper_) { }
+
+		template <typename U>
+		explicit basic_aabb(const basic_aabb<U, N> &other) : lower(other.lower), upper(other.upper) { }
+
+		bool empty() const {
+			for (size_t i = 0; i < N; ++i) {
+				if (lower[i] > upper[i]) return true;
+			}
+			return false;
+		}
+
+		vec_t center() const {
+			return (lower + upper) / T(2);
+		}
+
+		vec_t extent() const {
+			return upper - lower;
+		}
+
+		friend bool operator==(const basic_aabb &a, const basic_aabb &b) {
+			return a.lower == b.lower && a.upper == b.upper;
+		}
+
+		friend bool operator!=(const basic_aabb &a, const basic_aabb &b) {
+			return !(a == b);
+		}
+
+		inline friend std::ostream & operator<<(std::ostream &out, const basic_aabb &b) {
+			return out << '[' << b.lower << ", " << b.upper << ']';
+		}
+	};
+
+
+	// ray with cached reciprocal direction for slab tests
+	// the direction does not need to be normalized
+	template <typename T, size_t N>
+	class basic_ray {
+	public:
+		using value_t = T;
+		using vec_t = basic_vec<T, N>;
+
+		vec_t origin;
+		vec_t direction;
+		vec_t inv_direction;
+
+		basic_ray() : origin(0), direction(0), inv_direction(std::numeric_limits<T>::infinity()) { }
+
+		basic_ray(const vec_t &origin_, const vec_t &direction_)
+			: origin(origin_), direction(direction_), inv_direction(T(1) / direction_) { }
+
+		// point along the ray at t
+		vec_t at(T t) const {
+			return origin + direction * t;
+		}
+	};
+
+
+	namespace detail {
+
+		// alignment for a row of a packet: the row size rounded up to a power of two, at most 32
+		constexpr size_t packet_alignment(size_t bytes, size_t a = 1) {
+			return (a >= 32 || a >= bytes) ? a : packet_alignment(bytes, a * 2);
+		}
+	}
+
+
+	// N boxes stored as structure-of-arrays for testing W boxes at a time
+	// unused lanes should be left empty so they never report hits
+	template <typename T, size_t N, size_t W>
+	class basic_aabb_packet {
+	public:
+		static_assert(W > 0 && W <= 32, "packet width must fit in a 32-bit mask");
+
+		using value_t = T;
+		static constexpr size_t width = W;
+
+		alignas(detail::packet_alignment(sizeof(T) * W)) T lower[N][W];
+		alignas(detail::packet_alignment(sizeof(T) * W)) T upper[N][W];
+
+		basic_aabb_packet() {
+			clear();
+		}
+
+		void clear() {
+			for (size_t i = 0; i < N; ++i) {
+				for (size_t l = 0; l < W; ++l) {
+					lower[i][l] = std::numeric_limits<T>::max();
+					upper[i][l] = std::numeric_limits<T>::lowest();
+				}
+			}
+		}
+
+		void set(size_t lane, const basic_aabb<T, N> &b) {
+			assert(lane < W);
+			for (size_t i = 0; i < N; ++i) {
+				lower[i][lane] = b.lower[i];
+				upper[i][lane] = b.upper[i];
+			}
+		}
+
+		basic_aabb<T, N> get(size_t lane) const {
+			assert(lane < W);
+			basic_aabb<T, N> b;
+			for (size_t i = 0; i < N; ++i) {
+				b.lower[i] = lower[i][lane];
+				b.upper[i] = upper[i][lane];
+			}
+			return b;
+		}
+	};
+
+
+	// view frustum as 6 inward facing planes (left, right, bottom, top, near, far)
+	// each plane is (normal, distance) with a unit normal, so dot(plane, (p, 1))
+	// is the signed distance of p, positive inside
+	template <typename T>
+	class basic_frustum {
+	public:
+		using value_t = T;
+		using plane_t = basic_vec<T, 4>;
+
+		enum plane_index { plane_left, plane_right, plane_bottom, plane_top, plane_near, plane_far };
+
+		plane_t planes[6];
+
+		const plane_t & operator[](size_t i) const {
+			assert(i < 6);
+			return planes[i];
+		}
+
+		plane_t & operator[](size_t i) {
+			assert(i < 6);
+			return planes[i];
+		}
+	};
+
+
+#ifdef CGRA_INITIAL3D_NAMES
+	// aliases: Intial3D naming convention
+
+	using aabb2f = basic_aabb<float, 2>;
+	using aabb2d = basic_aabb<double, 2>;
+	using aabb2i = basic_aabb<int, 2>;
+	using aabb3f = basic_aabb<float, 3>;
+	using aabb3d = basic_aabb<double, 3>;
+	using aabb3i = basic_aabb<int, 3>;
+
+	using ray2f = basic_ray<float, 2>;
+	using ray2d = basic_ray<double, 2>;
+	using ray3f = basic_ray<float, 3>;
+	using ray3d = basic_ray<double, 3>;
+
+	using aabb3x4f = basic_aabb_packet<float, 3, 4>;
+	using aabb3x8f = basic_aabb_packet<float, 3, 8>;
+
+	using frustumf = basic_frustum<float>;
+	using frustumd = basic_frustum<double>;
+
+#else
+	// aliases: GLSL naming convention
+
+	using aabb2 = basic_aabb<float, 2>;
+	using daabb2 = basic_aabb<double, 2>;
+	using iaabb2 = basic_aabb<int, 2>;
+	using aabb3 = basic_aabb<float, 3>;
+	using daabb3 = basic_aabb<double, 3>;
+	using iaabb3 = basic_aabb<int, 3>;
+
+	using ray2 = basic_ray<float, 2>;
+	using dray2 = basic_ray<double, 2>;
+	using ray3 = basic_ray<float, 3>;
+	using dray3 = basic_ray<double, 3>;
+
+	using aabb3x4 = basic_aabb_packet<float, 3, 4>;
+	using aabb3x8 = basic_aabb_packet<float, 3, 8>;
+
+	using frustum = basic_frustum<float>;
+	using dfrustum = basic_frustum<double>;
+
+#endif
+
+
+
+
+	//
+	// bounding box functions
+	//
+
+	// smallest box containing a box and a point
+	template <typename T, size_t N>
+	inline basic_aabb<T, N> expand(const basic_aabb<T, N> &b, const basic_vec<T, N> &p) {
+		return basic_aabb<T, N>{min(b.lower, p), max(b.upper, p)};
+	}
+
+	// smallest box containing both boxes (union)
+	template <typename T, size_t N>
+	inline basic_aabb<T, N> merge(const basic_aabb<T, N> &a, const basic_aabb<T, N> &b) {
+		return basic_aabb<T, N>{min(a.lower, b.lower), max(a.upper, b.upper)};
+	}
+
+	// box covered by both boxes, empty if they do not overlap
+	template <typename T, size_t N>
+	inline basic_aabb<T, N> intersection(const basic_aabb<T, N> &a, const basic_aabb<T, N> &b) {
+		return basic_aabb<T, N>{max(a.lower, b.lower), min(a.upper, b.upper)};
+	}
+
+	// box grown by r on every side
+	template <typename T, size_t N>
+	inline basic_aabb<T, N> inflate(const basic_aabb<T, N> &b, const T &r) {
+		return basic_aabb<T, N>{b.lower - r, b.upper + r};
+	}
+
+	template <typename T, size_t N>
+	inline bool overlaps(const basic_aabb<T, N> &a, const basic_aabb<T, N> &b) {
+		for (size_t i = 0; i < N; ++i) {
+			if (a.lower[i] > b.upper[i] || b.lower[i] > a.upper[i]) return false;
+		}
+		return true;
+	}
+
+	template <typename T, size_t N>
+	inline bool contains(const basic_aabb<T, N> &b, const basic_vec<T, N> &p) {
+		for (size_t i = 0; i < N; ++i) {
+			if (p[i] < b.lower[i] || p[i] > b.upper[i]) return false;
+		}
+		return true;
+	}
+
+	template <typename T, size_t N>
+	inline bool contains(const basic_aabb<T, N> &a, const basic_aabb<T, N> &b) {
+		return contains(a, b.lower) && contains(a, b.upper);
+	}
+
+	// sum of the areas of the faces (perimeter in 2d), 0 for an empty box
+	template <typename T, size_t N>
+	inline T surface_area(const basic_aabb<T, N> &b) {
+		if (b.empty()) return T(0);
+		const auto e = b.extent();
+		T a(0);
+		for (size_t i = 0; i < N; ++i) {
+			T f(1);
+			for (size_t j = 0; j < N; ++j) {
+				if (i != j) f *= e[j];
+			}
+			a += f;
+		}
+		return T(2) * a;
+	}
+
+	// 0 for an empty box
+	template <typename T, size_t N>
+	inline T volume(const basic_aabb<T, N> &b) {
+		if (b.empty()) return T(0);
+		return product(b.extent());
+	}
+
+	namespace detail {
+
+		// Arvo's method: each output axis is the translation plus the
+		// per-axis min/max contributions of the linear part
+		template <typename T, size_t N, size_t Cols, size_t Rows>
+		inline basic_aabb<T, N> transform_aabb(const basic_mat<T, Cols, Rows> &m, const basic_aabb<T, N> &b, const basic_vec<T, N> &t) {
+			if (b.empty()) return b;
+			basic_aabb<T, N> r{t, t};
+			for (size_t j = 0; j < N; ++j) {
+				for (size_t i = 0; i < N; ++i) {
+					const T e = m[j][i] * b.lower[j];
+					const T f = m[j][i] * b.upper[j];
+					r.lower[i] += e < f ? e : f;
+					r.upper[i] += e < f ? f : e;
+				}
+			}
+			return r;
+		}
+	}
+
+	// bounds of a box after an affine transform
+	// the last row of m is assumed to be (0, ..., 0, 1)
+	template <typename T, size_t N>
+	inline basic_aabb<T, N> transform(const basic_mat<T, N + 1, N + 1> &m, const basic_aabb<T, N> &b) {
+		return detail::transform_aabb(m, b, basic_vec<T, N>(m[N]));
+	}
+
+	// bounds of a box after a linear transform
+	template <typename T, size_t N>
+	inline basic_aabb<T, N> transform(const basic_mat<T, N, N> &m, const basic_aabb<T, N> &b) {
+		return detail::transform_aabb(m, b, basic_vec<T, N>(0));
+	}
+
+
+
+
+	//
+	// ray functions
+	//
+
+	// slab test of a ray against a box over the parametric interval [tmin, tmax]
+	// on a hit, tmin and tmax are narrowed to the part of the ray inside the box
+	template <typename T, size_t N>
+	inline bool intersect(const basic_ray<T, N> &r, const basic_aabb<T, N> &b, T &tmin, T &tmax) {
+		T t0 = tmin;
+		T t1 = tmax;
+		for (size_t i = 0; i < N; ++i) {
+			// choosing slab order by direction sign (rather than min/max)
+			// makes empty boxes fail the test
+			const bool pos = r.inv_direction[i] >= T(0);
+			const T tn = ((pos ? b.lower[i] : b.upper[i]) - r.origin[i]) * r.inv_direction[i];
+			const T tf = ((pos ? b.upper[i] : b.lower[i]) - r.origin[i]) * r.inv_direction[i];
+			t0 = tn > t0 ? tn : t0;
+			t1 = tf < t1 ? tf : t1;
+		}
+		if (!(t0 <= t1)) return false;
+		tmin = t0;
+		tmax = t1;
+		return true;
+	}
+
+	template <typename T, size_t N>
+	inline bool intersect(const basic_ray<T, N> &r, const basic_aabb<T, N> &b) {
+		T t0 = T(0);
+		T t1 = std::numeric_limits<T>::infinity();
+		return intersect(r, b, t0, t1);
+	}
+
+	// slab test of one ray against all lanes of a packet over [tmin, tmax]
+	// returns a bitmask of lanes hit; entry distances are written to tnear
+	// (only meaningful for lanes that hit)
+	template <typename T, size_t N, size_t W>
+	inline unsigned intersect(const basic_ray<T, N> &r, const basic_aabb_packet<T, N, W> &p, T tmin, T tmax, T *tnear = nullptr) {
+		T t0[W];
+		T t1[W];
+		for (size_t l = 0; l < W; ++l) {
+			t0[l] = tmin;
+			t1[l] = tmax;
+		}
+		// the sign choice is uniform across lanes, so the inner loops
+		// are straight min/max sequences that vectorize across the packet
+		for (size_t i = 0; i < N; ++i) {
+			const T o = r.origin[i];
+			const T inv = r.inv_direction[i];
+			const bool pos = inv >= T(0);
+			const T *near = pos ? p.lower[i] : p.upper[i];
+			const T *far = pos ? p.upper[i] : p.lower[i];
+			for (size_t l = 0; l < W; ++l) {
+				const T tn = (near[l] - o) * inv;
+				const T tf = (far[l] - o) * inv;
+				t0[l] = tn > t0[l] ? tn : t0[l];
+				t1[l] = tf < t1[l] ? tf : t1[l];
+			}
+		}
+		unsigned mask = 0;
+		for (size_t l = 0; l < W; ++l) {
+			mask |= unsigned(t0[l] <= t1[l]) << l;
+		}
+		if (tnear) {
+			for (size_t l = 0; l < W; ++l) tnear[l] = t0[l];
+		}
+		return mask;
+	}
+
+	// packet overlap test of one box against all lanes
+	// returns a bitmask of overlapping lanes
+	template <typename T, size_t N, size_t W>
+	inline unsigned overlaps(const basic_aabb<T, N> &b, const basic_aabb_packet<T, N, W> &p) {
+		bool hit[W];
+		for (size_t l = 0; l < W; ++l) hit[l] = true;
+		for (size_t i = 0; i < N; ++i) {
+			const T lo = b.lower[i];
+			const T hi = b.upper[i];
+			for (size_t l = 0; l < W; ++l) {
+				hit[l] = hit[l] & (p.lower[i][l] <= hi) & (lo <= p.upper[i][l]);
+			}
+		}
+		unsigned mask = 0;
+		for (size_t l = 0; l < W; ++l) {
+			mask |= unsigned(hit[l]) << l;
+		}
+		return mask;
+	}
+
+
+
+
+	//
+	// frustum functions
+	//
+
+	namespace detail {
+
+		// plane with a unit normal, or an always-inside plane if the normal
+		// vanishes (the far plane of an infinite projection)
+		template <typename T>
+		inline basic_vec<T, 4> normalize_plane(const basic_vec<T, 4> &p) {
+			const T l = length(basic_vec<T, 3>(p));
+			if (l <= T(0)) return basic_vec<T, 4>{0, 0, 0, 1};
+			return p / l;
+		}
+
+		// number of bitmask words needed for count objects
+		inline size_t mask_words(size_t count) {
+			return (count + 31) / 32;
+		}
+
+		// culls objects [32 * w0, 32 * w1) one 32-bit mask word at a time
+		// test(i, lanes, d) lowers d[l] to the smallest signed plane distance
+		// (plus radius) of object i + l, which is visible if that stays >= 0
+		template <typename T, typename TestFn>
+		inline void cull_words(size_t count, size_t w0, size_t w1, std::uint32_t *visible, TestFn &&test) {
+			for (size_t w = w0; w < w1; ++w) {
+				const size_t i = 32 * w;
+				const size_t lanes = count - i < 32 ? count - i : 32;
+				T d[32];
+				for (size_t l = 0; l < 32; ++l) d[l] = std::numeric_limits<T>::max();
+				// full blocks get a compile-time lane count so the lane loops
+				// vectorize without a remainder
+				if (lanes == 32) test(i, std::integral_constant<size_t, 32>{}, d);
+				else test(i, lanes, d);
+				std::uint32_t m = 0;
+				for (size_t l = 0; l < lanes; ++l) m |= std::uint32_t(d[l] >= T(0)) << l;
+				visible[w] = m;
+			}
+		}
+	}
+
+	// extract the frustum of a view-projection matrix (Gribb and Hartmann)
+	// depth is the clip space depth range the projection was built with
+	template <typename T>
+	inline basic_frustum<T> frustum_from_matrix(const basic_mat<T, 4, 4> &m, clip_depth depth = clip_depth::negative_one_to_one) {
+		using vec_t = basic_vec<T, 4>;
+		const vec_t r0{m[0][0], m[1][0], m[2][0], m[3][0]};
+		const vec_t r1{m[0][1], m[1][1], m[2][1], m[3][1]};
+		const vec_t r2{m[0][2], m[1][2], m[2][2], m[3][2]};
+		const vec_t r3{m[0][3], m[1][3], m[2][3], m[3][3]};
+		basic_frustum<T> f;
+		f.planes[f.plane_left] = detail::normalize_plane(vec_t(r3 + r0));
+		f.planes[f.plane_right] = detail::normalize_plane(vec_t(r3 - r0));
+		f.planes[f.plane_bottom] = detail::normalize_plane(vec_t(r3 + r1));
+		f.planes[f.plane_top] = detail::normalize_plane(vec_t(r3 - r1));
+		switch (depth) {
+		case clip_depth::zero_to_one:
+			f.planes[f.plane_near] = detail::normalize_plane(r2);
+			f.planes[f.plane_far] = detail::normalize_plane(vec_t(r3 - r2));
+			break;
+		case clip_depth::reversed:
+			f.planes[f.plane_near] = detail::normalize_plane(vec_t(r3 - r2));
+			f.planes[f.plane_far] = detail::normalize_plane(r2);
+			break;
+		default:
+			f.planes[f.plane_near] = detail::normalize_plane(vec_t(r3 + r2));
+			f.planes[f.plane_far] = detail::normalize_plane(vec_t(r3 - r2));
+			break;
+		}
+		return f;
+	}
+
+	// conservative sphere test, true unless the sphere is fully outside a plane
+	template <typename T>
+	inline bool overlaps(const basic_frustum<T> &f, const basic_vec<T, 3> &center, const T &radius) {
+		for (const auto &p : f.planes) {
+			if (dot(basic_vec<T, 3>(p), center) + p.w < -radius) return false;
+		}
+		return true;
+	}
+
+	// conservative box test, true unless the box is fully outside a plane
+	template <typename T>
+	inline bool overlaps(const basic_frustum<T> &f, const basic_aabb<T, 3> &b) {
+		const auto c = b.center();
+		const auto e = b.upper - c;
+		for (const auto &p : f.planes) {
+			const basic_vec<T, 3> n(p);
+			if (dot(n, c) + p.w < -dot(abs(n), e)) return false;
+		}
+		return true;
+	}
+
+	// sphere culling over structure-of-arrays bounds
+	// bit i % 32 of visible[i / 32] is set if sphere i may be visible
+	// visible needs (count + 31) / 32 words; threads = 0 uses every hardware thread
+	template <typename T>
+	inline void cull_spheres(
+		const basic_frustum<T> &f,
+		span<const typename basic_frustum<T>::value_t> x,
+		span<const typename basic_frustum<T>::value_t> y,
+		span<const typename basic_frustum<T>::value_t> z,
+		span<const typename basic_frustum<T>::value_t> radius,
+		span<std::uint32_t> visible, unsigned threads = 1
+	) {
+		const size_t count = x.size();
+		assert(y.size() == count && z.size() == count && radius.size() == count);
+		assert(visible.size() >= detail::mask_words(count));
+		const size_t words = detail::mask_words(count);
+		const unsigned nthreads = std::min<unsigned>(detail::resolve_thread_count(threads), unsigned(words / 256 + 1));
+		detail::parallel_for(words, nthreads, [&](size_t w0, size_t w1, unsigned) {
+			detail::cull_words<T>(count, w0, w1, visible.data(), [&](size_t i, auto lanes, T *dmin) {
+				const T *px = x.data() + i, *py = y.data() + i, *pz = z.data() + i, *pr = radius.data() + i;
+				for (const auto &p : f.planes) {
+					// plane in locals so the lane loop is a straight line
+					// that vectorizes over the block
+					const T a = p.x, b = p.y, c = p.z, e = p.w;
+					for (size_t l = 0; l < size_t(lanes); ++l) {
+						const T d = a * px[l] + b * py[l] + c * pz[l] + e + pr[l];
+						dmin[l] = d < dmin[l] ? d : dmin[l];
+					}
+				}
+			});
+		});
+	}
+
+	// box culling over structure-of-arrays bounds given as centers and half extents
+	// bit i % 32 of visible[i / 32] is set if box i may be visible
+	// visible needs (count + 31) / 32 words; threads = 0 uses every hardware thread
+	template <typename T>
+	inline void cull_aabbs(
+		const basic_frustum<T> &f,
+		span<const typename basic_frustum<T>::value_t> cx,
+		span<const typename basic_frustum<T>::value_t> cy,
+		span<const typename basic_frustum<T>::value_t> cz,
+		span<const typename basic_frustum<T>::value_t> ex,
+		span<const typename basic_frustum<T>::value_t> ey,
+		span<const typename basic_frustum<T>::value_t> ez,
+		span<std::uint32_t> visible, unsigned threads = 1
+	) {
+		const size_t count = cx.size();
+		assert(cy.size() == count && cz.size() == count);
+		assert(ex.size() == count && ey.size() == count && ez.size() == count);
+		assert(visible.size() >= detail::mask_words(count));
+		const size_t words = detail::mask_words(count);
+		const unsigned nthreads = std::min<unsigned>(detail::resolve_thread_count(threads), unsigned(words / 256 + 1));
+		detail::parallel_for(words, nthreads, [&](size_t w0, size_t w1, unsigned) {
+			detail::cull_words<T>(count, w0, w1, visible.data(), [&](size_t i, auto lanes, T *dmin) {
+				const T *pcx = cx.data() + i, *pcy = cy.data() + i, *pcz = cz.data() + i;
+				const T *pex = ex.data() + i, *pey = ey.data() + i, *pez = ez.data() + i;
+				for (const auto &p : f.planes) {
+					const T a = p.x, b = p.y, c = p.z, e = p.w;
+					const T ax = std::abs(a), ay = std::abs(b), az = std::abs(c);
+					for (size_t l = 0; l < size_t(lanes); ++l) {
+						const T d = a * pcx[l] + b * pcy[l] + c * pcz[l] + e;
+						const T r = ax * pex[l] + ay * pey[l] + az * pez[l];
+						dmin[l] = d + r < dmin[l] ? d + r : dmin[l];
+					}
+				}
+			});
+		});
+	}
+
+
+
+
+	//
+	// point functions
+	//
+
+	namespace detail {
+
+		// q as a rotation matrix, with its norm divided out so it matches q * v
+		template <typename T>
+		inline basic_mat<T, 3, 3> rotation_matrix(const basic_quat<T> &q) {
+			return basic_mat<T, 3, 3>(q) * (T(1) / dot(q, q));
+		}
+
+		// runs f(i0, i1) over [0, count) in chunks big enough to be worth a thread
+		template <typename F>
+		inline void point_batch(size_t count, unsigned threads, F &&f) {
+			const unsigned nthreads = std::min<unsigned>(resolve_thread_count(threads), unsigned(count / 16384 + 1));
+			parallel_for(count, nthreads, [&](size_t i0, size_t i1, unsigned) { f(i0, i1); });
+		}
+	}
+
+	// out[i] = q * in[i]; in and out may be the same
+	// q is turned into a matrix once, so each point costs one 3x3 multiply
+	// threads = 0 uses every hardware thread
+	template <typename T>
+	inline void rotate_batch(const basic_quat<T> &q, span<const basic_vec<T, 3>> in, span<basic_vec<T, 3>> out, unsigned threads = 1) {
+		assert(out.size() == in.size());
+		const basic_mat<T, 3, 3> m = detail::rotation_matrix(q);
+		detail::point_batch(in.size(), threads, [&](size_t i0, size_t i1) {
+			// matrix in locals so the loop is a straight line
+			const T m00 = m[0][0], m01 = m[0][1], m02 = m[0][2];
+			const T m10 = m[1][0], m11 = m[1][1], m12 = m[1][2];
+			const T m20 = m[2][0], m21 = m[2][1], m22 = m[2][2];
+			for (size_t i = i0; i < i1; ++i) {
+				const T x = in[i][0], y = in[i][1], z = in[i][2];
+				out[i] = basic_vec<T, 3>(m00 * x + m10 * y + m20 * z, m01 * x + m11 * y + m21 * z, m02 * x + m12 * y + m22 * z);
+			}
+		});
+	}
+
+	// rotation of structure-of-arrays points, (ox, oy, oz)[i] = q * (x, y, z)[i]
+	// the outputs may be the same spans as the inputs
+	// threads = 0 uses every hardware thread
+	template <typename T>
+	inline void rotate_batch(
+		const basic_quat<T> &q,
+		span<const T> x, span<const T> y, span<const T> z,
+		span<T> ox, span<T> oy, span<T> oz, unsigned threads = 1
+	) {
+		const size_t count = x.size();
+		assert(y.size() == count && z.size() == count);
+		assert(ox.size() == count && oy.size() == count && oz.size() == count);
+		const basic_mat<T, 3, 3> m = detail::rotation_matrix(q);
+		detail::point_batch(count, threads, [&](size_t i0, size_t i1) {
+			const T m00 = m[0][0], m01 = m[0][1], m02 = m[0][2];
+			const T m10 = m[1][0], m11 = m[1][1], m12 = m[1][2];
+			const T m20 = m[2][0], m21 = m[2][1], m22 = m[2][2];
+			const T *px = x.data(), *py = y.data(), *pz = z.data();
+			T *qx = ox.data(), *qy = oy.data(), *qz = oz.data();
+			for (size_t i = i0; i < i1; ++i) {
+				const T vx = px[i], vy = py[i], vz = pz[i];
+				qx[i] = m00 * vx + m10 * vy + m20 * vz;
+				qy[i] = m01 * vx + m11 * vy + m21 * vz;
+				qz[i] = m02 * vx + m12 * vy + m22 * vz;
+			}
+		});
+	}
+
+	// per-point rotations, out[i] = q[i] * in[i] for unit quaternions (see rotate_unit)
+	// threads = 0 uses every hardware thread
+	template <typename T>
+	inline void rotate_batch(span<const basic_quat<T>> q, span<const basic_vec<T, 3>> in, span<basic_vec<T, 3>> out, unsigned threads = 1) {
+		assert(q.size() == in.size() && out.size() == in.size());
+		detail::point_batch(in.size(), threads, [&](size_t i0, size_t i1) {
+			for (size_t i = i0; i < i1; ++i) out[i] = rotate_unit(q[i], in[i]);
+		});
+	}
+
+}
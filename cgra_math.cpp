@@ -0,0 +1,19 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Explicit Instantiations
+//
+// Compiled into the optional cgra_math static library. Users of the library
+// define CGRA_MATH_EXTERN_TEMPLATES (the CMake target does this for them) so
+// the common vec, mat and quat class instantiations come from here.
+//
+//----------------------------------------------------------------------------
+
+#include "cgra_math.hpp"
+
+namespace cgra {
+
+#define CGRA_MATH_INSTANTIATE_(...) template class __VA_ARGS__;
+	CGRA_MATH_COMMON_INSTANTIATIONS(CGRA_MATH_INSTANTIATE_)
+#undef CGRA_MATH_INSTANTIATE_
+
+}
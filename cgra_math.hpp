@@ -19,8 +19,6 @@
 - axis/angle function names
 - factory function constraints?
 - vector etc comparison result magic
-- ndc z-bounds for projection matrices (gl vs d3d)
-- infinite perspective projection
 - defend more things against vectors of vectors (scalar compatibility?)
 - defend more things against integer arguments by promoting to floating point
 - test is_vector_compatible etc with static asserts
@@ -28,14 +26,58 @@
 - clean up common function definitions and remove duplicates
 - implement generic cat functions (with vec_cast?)
 - comments and documentation
-- create inputstream operators for data types to recreate from output
 - implement alternatives to body-3-2-1 euler rotation
 	http://www.geometrictools.com/Documentation/EulerAngles.pdf
 - noexceptness
 
 */
 
-#pragma once
+// Every section below is guarded separately so the header can be included
+// in parts through the cgra_math_<section>.hpp sub-headers, which define
+// CGRA_MATH_SELECT_<SECTION> around their include. Including cgra_math.hpp
+// directly (with nothing selected) pulls in all sections as before.
+#if !defined(CGRA_MATH_SELECT_MAT) && !defined(CGRA_MATH_SELECT_QUAT) && !defined(CGRA_MATH_SELECT_TRANSFORM) \
+	&& !defined(CGRA_MATH_SELECT_RANDOM) && !defined(CGRA_MATH_SELECT_HASH) && !defined(CGRA_MATH_SELECT_IO) \
+	&& !defined(CGRA_MATH_SELECT_COMPLEX) && !defined(CGRA_MATH_SELECT_CORE)
+#define CGRA_MATH_SELECT_ALL_
+#endif
+
+#if defined(CGRA_MATH_SELECT_ALL_) || defined(CGRA_MATH_SELECT_TRANSFORM)
+#define CGRA_MATH_WANT_TRANSFORM_
+#define CGRA_MATH_WANT_QUAT_
+#endif
+
+#if defined(CGRA_MATH_SELECT_ALL_) || defined(CGRA_MATH_SELECT_QUAT)
+#define CGRA_MATH_WANT_QUAT_
+#endif
+
+#if defined(CGRA_MATH_SELECT_ALL_) || defined(CGRA_MATH_SELECT_MAT) || defined(CGRA_MATH_WANT_QUAT_)
+#define CGRA_MATH_WANT_MAT_
+#endif
+
+#if defined(CGRA_MATH_SELECT_ALL_) || defined(CGRA_MATH_SELECT_RANDOM)
+#define CGRA_MATH_WANT_RANDOM_
+#endif
+
+#if defined(CGRA_MATH_SELECT_ALL_) || defined(CGRA_MATH_SELECT_HASH)
+#define CGRA_MATH_WANT_HASH_
+#endif
+
+#if defined(CGRA_MATH_SELECT_ALL_) || defined(CGRA_MATH_SELECT_IO)
+#define CGRA_MATH_WANT_IO_
+#endif
+
+#if defined(CGRA_MATH_SELECT_ALL_) || defined(CGRA_MATH_SELECT_COMPLEX)
+#define CGRA_MATH_WANT_COMPLEX_
+#endif
+
+
+
+//
+// core: vec, mat and quat types, operators and component-wise functions
+//
+#ifndef CGRA_MATH_CORE_HPP
+#define CGRA_MATH_CORE_HPP
 
 // we undefine min and max macros if they exist
 // so they don't interfere with our function overloads
@@ -51,18 +93,16 @@
 
 #include <algorithm>
 #include <array>
-#include <complex>
-#include <iomanip>
-#include <iostream>
+#include <iosfwd>
 #include <limits>
-#include <random>
-#include <sstream>
 #include <string>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 #include <exception>
 #include <stdexcept>
 #include <initializer_list>
+#include <iterator>
 
 // MSVC and GCC-likes (including Clang) support anonymous structs which
 // we use for vector members while still allowing constexpr operator[]
@@ -114,6 +154,8 @@ namespace cgra {
 		}
 		namespace vectors {
 			template <typename T, size_t N> class basic_vec;
+			template <typename T, size_t N> class vec_view;
+			template <typename VecT> class strided_span;
 			inline namespace functions {
 				// inline for ADL
 			}
@@ -138,6 +180,12 @@ namespace cgra {
 	template <typename T, size_t Cols, size_t Rows>
 	using basic_mat = detail::matrices::basic_mat<T, Cols, Rows>;
 
+	template <typename T, size_t N>
+	using vec_view = detail::vectors::vec_view<T, N>;
+
+	template <typename VecT>
+	using strided_span = detail::vectors::strided_span<VecT>;
+
 	using namespace detail::scalars::functions;
 	using namespace detail::vectors::functions;
 	using namespace detail::matrices::functions;
@@ -297,6 +345,56 @@ namespace cgra {
 		constexpr double phi = 1.61803398874989484820458683436563811;
 	}
 
+	// non-owning view of contiguous elements, used by the batch functions
+	// (a minimal stand-in for std::span, which needs C++20)
+	template <typename T>
+	class span {
+	private:
+		T *m_data = nullptr;
+		size_t m_size = 0;
+
+	public:
+		using element_type = T;
+		using value_type = std::remove_cv_t<T>;
+		using iterator = T *;
+
+		CGRA_CONSTEXPR_FUNCTION span() { }
+
+		CGRA_CONSTEXPR_FUNCTION span(T *data_, size_t size_) : m_data(data_), m_size(size_) { }
+
+		template <size_t N>
+		CGRA_CONSTEXPR_FUNCTION span(T (&arr)[N]) : m_data(arr), m_size(N) { }
+
+		// any contiguous container with data() and size() (including other spans)
+		// elements must be the same size, so eg basic_vec_aligned<float, 3> (padded) is not viewable as vec3
+		template <
+			typename ContainerT,
+			typename = std::enable_if_t<
+				std::is_convertible<decltype(std::declval<ContainerT &>().data()), T *>::value
+				&& sizeof(*std::declval<ContainerT &>().data()) == sizeof(T)
+			>,
+			typename = decltype(std::declval<ContainerT &>().size())
+		>
+		CGRA_CONSTEXPR_FUNCTION span(ContainerT &&c) : m_data(c.data()), m_size(c.size()) { }
+
+		CGRA_CONSTEXPR_FUNCTION T * data() const { return m_data; }
+		CGRA_CONSTEXPR_FUNCTION size_t size() const { return m_size; }
+		CGRA_CONSTEXPR_FUNCTION bool empty() const { return m_size == 0; }
+
+		CGRA_CONSTEXPR_FUNCTION T * begin() const { return m_data; }
+		CGRA_CONSTEXPR_FUNCTION T * end() const { return m_data + m_size; }
+
+		CGRA_CONSTEXPR_FUNCTION T & operator[](size_t i) const {
+			assert(i < m_size);
+			return m_data[i];
+		}
+
+		CGRA_CONSTEXPR_FUNCTION span subspan(size_t offset, size_t count) const {
+			assert(offset + count <= m_size);
+			return span(m_data + offset, count);
+		}
+	};
+
 	namespace detail {
 		namespace scalars {
 
@@ -467,6 +565,8 @@ namespace cgra {
 
 		struct vec_element_ctor_tag {};
 		struct vec_dead_ctor_tag {};
+		struct vec_magic_cat_tag {};
+		struct vec_magic_vector_tag {};
 
 		namespace vectors {
 			template <typename T, size_t N> class repeat_vec;
@@ -512,17 +612,6 @@ namespace cgra {
 			static constexpr bool want_bool_fns = true;
 		};
 
-		template <typename T>
-		struct scalar_traits<std::complex<T>, void> {
-			using fpromote_t = std::complex<detail::fpromote_t<T>>;
-			static constexpr bool is_scalar = true;
-			static constexpr bool want_real_fns = false;
-			static constexpr bool want_trig_fns = true;
-			static constexpr bool want_exp_fns = true;
-			static constexpr bool want_linear_fns = true;
-			static constexpr bool want_bool_fns = false;
-		};
-
 		template <typename T>
 		struct scalar_traits<basic_quat<T>, void> {
 			using fpromote_t = basic_quat<detail::fpromote_t<T>>;
@@ -598,7 +687,58 @@ namespace cgra {
 			static constexpr bool is_matrix = true;
 		};
 
-		// TODO array_traits for std::array, std::tuple
+		template <typename T, size_t N>
+		struct array_traits<vec_view<T, N>, void> {
+			using value_t = std::remove_const_t<T>;
+			using copy_t = basic_vec<value_t, N>;
+			using fpromote_t = basic_vec<detail::fpromote_t<value_t>, N>;
+			static constexpr size_t size = N;
+
+			static constexpr bool is_array = true;
+			static constexpr bool is_vector = true;
+			static constexpr bool is_matrix = false;
+
+			// views are shallow-const, so this is always the viewed element
+			template <size_t I, typename VecT>
+			CGRA_CONSTEXPR_FUNCTION static T & get(VecT &&v) {
+				return v[I];
+			}
+		};
+
+		template <typename T, size_t N>
+		struct array_traits<std::array<T, N>, void> {
+			using value_t = T;
+			using copy_t = basic_vec<T, N>;
+			using fpromote_t = basic_vec<detail::fpromote_t<T>, N>;
+			static constexpr size_t size = N;
+
+			static constexpr bool is_array = true;
+			static constexpr bool is_vector = true;
+			static constexpr bool is_matrix = false;
+
+			template <size_t I, typename VecT>
+			CGRA_CONSTEXPR_FUNCTION static decltype(auto) get(VecT &&v) {
+				return std::get<I>(std::forward<VecT>(v));
+			}
+		};
+
+		// homogeneous tuples only (rotating the pack is a no-op iff all types are the same)
+		template <typename T, typename ...Ts>
+		struct array_traits<std::tuple<T, Ts...>, std::enable_if_t<std::is_same<std::tuple<T, Ts...>, std::tuple<Ts..., T>>::value>> {
+			using value_t = T;
+			using copy_t = basic_vec<T, 1 + sizeof...(Ts)>;
+			using fpromote_t = basic_vec<detail::fpromote_t<T>, 1 + sizeof...(Ts)>;
+			static constexpr size_t size = 1 + sizeof...(Ts);
+
+			static constexpr bool is_array = true;
+			static constexpr bool is_vector = true;
+			static constexpr bool is_matrix = false;
+
+			template <size_t I, typename VecT>
+			CGRA_CONSTEXPR_FUNCTION static decltype(auto) get(VecT &&v) {
+				return std::get<I>(std::forward<VecT>(v));
+			}
+		};
 
 		template <typename VecT>
 		using array_value_t = typename array_traits<std::decay_t<VecT>>::value_t;
@@ -1187,35 +1327,6 @@ namespace cgra {
 		template <typename Seq, typename N>
 		using seq_trim_t = typename seq_trim<Seq, N>::type;
 
-		template <typename T, bool IsVec>
-		struct cat_arg_vec_size_impl : index_constant<1> {};
-
-		template <typename T>
-		struct cat_arg_vec_size_impl<T, true> : index_constant<array_traits<std::decay_t<T>>::size> {};
-
-		template <typename CatT, typename T>
-		struct cat_arg_vec_size : cat_arg_vec_size_impl<T, is_element_compatible<CatT, T, true>::value> {};
-
-		template <typename CatT, typename ...ArgTs>
-		struct cat_arg_vec_total_size :
-			meta_fold_t<meta_quote<meta_add>, index_constant<0>, std::tuple<cat_arg_vec_size<CatT, ArgTs>...>> {};
-
-		template <typename CatT, typename Seq, typename Tup>
-		struct cat_arg_seq {};
-
-		template <typename CatT, size_t ...Is, typename ...Ts>
-		struct cat_arg_seq<CatT, std::index_sequence<Is...>, std::tuple<Ts...>> {
-			using type = seq_cat_t<std::index_sequence<>, seq_repeat_t<std::index_sequence<Is>, cat_arg_vec_size<CatT, Ts>>...>;
-		};
-
-		template <typename CatT, typename Tup>
-		struct cat_val_seq {};
-
-		template <typename CatT, typename ...Ts>
-		struct cat_val_seq<CatT, std::tuple<Ts...>> {
-			using type = seq_cat_t<std::index_sequence<>, make_index_sequence_t<cat_arg_vec_size<CatT, Ts>>...>;
-		};
-
 		template <size_t I, typename T, bool IsVec>
 		struct vec_get_impl {
 			CGRA_CONSTEXPR_FUNCTION static decltype(auto) go(T &&t) {
@@ -1239,95 +1350,104 @@ namespace cgra {
 			return vec_get_impl<I, T, is_element_compatible<CatT, T, true>::value>::go(std::forward<T>(t));
 		}
 
-		template <typename CatT, typename ArgTupT, size_t ...Js, size_t ...Ks>
-		CGRA_CONSTEXPR_FUNCTION CatT cat_impl_impl(ArgTupT &&args, std::index_sequence<Js...>, std::index_sequence<Ks...>) {
-			return CatT(detail::vec_element_ctor_tag(), vec_get<CatT, Ks>(std::get<Js>(std::forward<ArgTupT>(args)))...);
+		template <bool ...Bs>
+		struct bool_pack {};
+
+		// flat (non-recursive) conjunction
+		template <bool ...Bs>
+		struct meta_all : std::is_same<bool_pack<true, Bs...>, bool_pack<Bs..., true>> {};
+
+		// flat sum, avoids a class instantiation per element like meta_fold
+		constexpr size_t meta_sum(std::initializer_list<size_t> xs, size_t i = 0) {
+			return i < xs.size() ? xs.begin()[i] + meta_sum(xs, i + 1) : 0;
 		}
 
-		template <typename CatT, typename ...Ts>
-		CGRA_CONSTEXPR_FUNCTION CatT cat_impl(Ts &&...args) {
-			using padsize = meta_sub_t<array_size<CatT>, meta_min_t<array_size<CatT>, cat_arg_vec_total_size<CatT, Ts...>>>;
-			using padvec_t = repeat_vec<array_value_t<CatT>, padsize::value>;
-			using argseq0 = typename cat_arg_seq<CatT, std::index_sequence_for<Ts..., padvec_t>, std::tuple<Ts..., padvec_t>>::type;
-			using valseq0 = typename cat_val_seq<CatT, std::tuple<Ts..., padvec_t>>::type;
-			// trim to size so that extra components are ignored
-			using argseq = seq_trim_t<argseq0, index_constant<CatT::size>>;
-			using valseq = seq_trim_t<valseq0, index_constant<CatT::size>>;
-			// prepare padding, default constructed
-			padvec_t pad{array_value_t<CatT>()};
-			// calling forward_as_tuple calls tuple's defaulted move ctor
-			// this compiles fine in vs2017, but intellisense thinks it isn't constexpr
-			// so, we call tuple's ctor directly to stop it complaining
-			return cat_impl_impl<CatT>(std::tuple<Ts &&..., const padvec_t &>{std::forward<Ts>(args)..., pad}, argseq(), valseq());
+		// index of the element of sizes containing position k (sizes.size() if past the end)
+		constexpr size_t meta_locate(std::initializer_list<size_t> sizes, size_t k, size_t i = 0) {
+			return i < sizes.size() && k >= sizes.begin()[i] ? meta_locate(sizes, k - sizes.begin()[i], i + 1) : i;
 		}
 
-		template <typename CatT, typename ...ArgTs>
-		struct can_have_implicit_magic_ctor :
-			bool_constant<
-				array_size<CatT>::value == cat_arg_vec_total_size<CatT, ArgTs...>::value
-				&& meta_fold_t<
-					meta_quote<meta_and>,
-					std::true_type,
-					std::tuple<is_cat_compatible<CatT, ArgTs, false>...>
-				>::value
-			>
-		{};
+		// position k relative to the start of the element of sizes containing it
+		constexpr size_t meta_locate_offset(std::initializer_list<size_t> sizes, size_t k, size_t i = 0) {
+			return i < sizes.size() && k >= sizes.begin()[i] ? meta_locate_offset(sizes, k - sizes.begin()[i], i + 1) : k;
+		}
 
-		// single arg -> array only, don't compete with default copy/move
-		template <typename CatT, typename ArgT>
-		struct can_have_implicit_magic_ctor<CatT, ArgT> : 
-			meta_and_t<
-				is_array_compatible<CatT, ArgT, false>,
-				meta_not_t<std::is_same<CatT, std::decay_t<ArgT>>>
-			>
-		{};
+		enum class magic_ctor_category {
+			none, implicit_ctor, explicit_ctor
+		};
+
+		// per-argument facts for the magic ctors, shared by every argument list containing T
+		// T must already be decayed
+		template <typename CatT, typename T>
+		struct magic_ctor_arg {
+			static constexpr bool element_explicit = is_element_compatible<CatT, T, true>::value;
+			static constexpr size_t size = element_explicit ? array_traits<T>::size : 1;
+			static constexpr bool implicit_ok = is_cat_compatible<CatT, T, false>::value;
+			static constexpr bool explicit_ok = element_explicit || is_array_scalar_compatible<CatT, T, true>::value;
+		};
 
+		// which magic ctor (if any) applies to these (decayed) args, and how to build the result
+		// implicit requires the total number of elements to be correct and implicitly convertible elements;
+		// explicit allows other sizes (unless RequireExactSize) and elements that are only explicitly convertible
+		// evaluated once per distinct argument list rather than once per candidate ctor and value category
 		template <typename CatT, bool RequireExactSize, typename ...ArgTs>
-		struct can_have_explicit_magic_ctor :
-			meta_fold_t<
-				meta_quote<meta_and>,
-				std::true_type,
-				std::tuple<
-					bool_constant<
-						!RequireExactSize
-						|| array_size<CatT>::value == cat_arg_vec_total_size<CatT, ArgTs...>::value
-					>,
-					is_cat_compatible<CatT, ArgTs, true>...
-				>
-			>
-		{};
+		struct magic_ctor_kind {
+			static constexpr size_t total_size = meta_sum({magic_ctor_arg<CatT, ArgTs>::size...});
+			static constexpr bool exact_size = array_size<CatT>::value == total_size;
+			static constexpr magic_ctor_category value =
+				exact_size && meta_all<magic_ctor_arg<CatT, ArgTs>::implicit_ok...>::value
+				? magic_ctor_category::implicit_ctor
+				: (!RequireExactSize || exact_size) && meta_all<magic_ctor_arg<CatT, ArgTs>::explicit_ok...>::value
+				? magic_ctor_category::explicit_ctor
+				: magic_ctor_category::none;
+			// element K of the result is component cat_offset(K) of arg cat_arg(K), or padding if past the args
+			static constexpr size_t cat_arg(size_t k) {
+				return meta_locate({magic_ctor_arg<CatT, ArgTs>::size...}, k);
+			}
+			static constexpr size_t cat_offset(size_t k) {
+				return meta_locate_offset({magic_ctor_arg<CatT, ArgTs>::size...}, k);
+			}
+			// N scalars can be used as elements directly, otherwise go through cat
+			using dispatch_tag = std::conditional_t<
+				exact_size && meta_all<!magic_ctor_arg<CatT, ArgTs>::element_explicit...>::value,
+				vec_element_ctor_tag,
+				vec_magic_cat_tag
+			>;
+		};
+
+		// no args -> default ctor
+		template <typename CatT, bool RequireExactSize>
+		struct magic_ctor_kind<CatT, RequireExactSize> {
+			static constexpr magic_ctor_category value = magic_ctor_category::none;
+		};
 
 		// single arg -> array only, don't compete with default copy/move
 		template <typename CatT, bool RequireExactSize, typename ArgT>
-		struct can_have_explicit_magic_ctor<CatT, RequireExactSize, ArgT> :
-			meta_and_t<
-				meta_and_t<
-					bool_constant<
-						!RequireExactSize
-						|| array_size<CatT>::value == array_size<ArgT>::value
-					>,
-					is_element_compatible<CatT, ArgT, true>
-				>,
-				meta_not_t<std::is_same<CatT, std::decay_t<ArgT>>>
-			>
-		{};
-
-		template <typename CatT, typename ...ArgTs>
-		struct can_have_any_magic_ctor :
-			meta_or_t<
-				can_have_explicit_magic_ctor<CatT, false, ArgTs...>,
-				can_have_implicit_magic_ctor<CatT, ArgTs...>
-			>
-		{};
+		struct magic_ctor_kind<CatT, RequireExactSize, ArgT> {
+			static constexpr bool other = !std::is_same<CatT, ArgT>::value;
+			static constexpr magic_ctor_category value =
+				other && is_array_compatible<CatT, ArgT, false>::value
+				? magic_ctor_category::implicit_ctor
+				: other && is_element_compatible<CatT, ArgT, true>::value
+					&& (!RequireExactSize || array_size<CatT>::value == array_size<ArgT>::value)
+				? magic_ctor_category::explicit_ctor
+				: magic_ctor_category::none;
+			static constexpr size_t cat_arg(size_t k) {
+				return k < array_size<ArgT>::value ? 0 : 1;
+			}
+			static constexpr size_t cat_offset(size_t k) {
+				return k;
+			}
+			// a vector of the same size can be copied elementwise, otherwise go through cat
+			using dispatch_tag = std::conditional_t<
+				array_size<CatT>::value == array_size<ArgT>::value,
+				vec_magic_vector_tag,
+				vec_magic_cat_tag
+			>;
+		};
 
 		template <typename T, typename ...ArgTs>
-		struct can_have_element_ctor :
-			meta_fold_t<
-				meta_quote<meta_and>,
-				std::true_type,
-				std::tuple<std::is_same<T, std::decay_t<ArgTs>>...>
-			>
-		{};
+		struct can_have_element_ctor : meta_all<std::is_same<T, std::decay_t<ArgTs>>::value...> {};
 
 #ifdef __INTELLISENSE__
 		// this sometimes helps intellisense make sense of things
@@ -1864,10 +1984,6 @@ namespace cgra {
 					assert(i < N);
 					return m_v;
 				}
-
-				inline friend std::ostream & operator<<(std::ostream &out, const repeat_vec &v) {
-					return out << '(' << v.m_v << ", ... , n=" << size << ")";
-				}
 			};
 
 			template <typename T, size_t N, bool RequireExactSize, typename ArgTupT, typename BaseDataT>
@@ -1878,6 +1994,10 @@ namespace cgra {
 			private:
 				using base_data_t = BaseDataT;
 
+				// magic ctor selection, cached per decayed argument list
+				template <typename ...ArgTs>
+				using magic_kind_t = magic_ctor_kind<basic_vec_ctor_proxy, RequireExactSize, std::decay_t<ArgTs>...>;
+
 				static_assert(
 					std::is_nothrow_move_constructible<base_data_t>::value == std::is_nothrow_move_constructible<T>::value,
 					"basic_vec_data should be as nothrow-move-constructible as its elements"
@@ -1926,73 +2046,83 @@ namespace cgra {
 					base_data_t{intellisense_constify(static_cast<T>(std::forward<ArgTs>(args)))...}
 				{}
 
-				// general magic ctor (implicit)
-				// enforcing >= 2 args is necessary to prevent unwanted implicit conversions
-				// direct enforcement with explicit 1st and 2nd args results in this being used instead of the above tagged ctor
-				// this implicit version checks that the number of elements is correct and that they are implicitly convertible
+				// magic ctor (implicit)
+				// for 2+ args, checks that the number of elements is correct and that they are implicitly convertible;
 				// this is callable from within nested braced init lists
+				// for 1 arg, only vectors of the same size are accepted, ie, scalars are not implicitly converted to vectors
+				// both magic ctors look up the same cached magic_ctor_kind, keyed on the decayed args,
+				// and tag-dispatch to a cheaper ctor when cat is not needed
 				// for MSVC in VS2015, we have to have an explicit 1st arg to avoid some kind of weird conflict with the default ctor
 				template <
 					typename ArgT0,
 					typename ...ArgTs,
 					typename = std::enable_if_t<
-						(sizeof...(ArgTs) >= 1)
-						&& can_have_implicit_magic_ctor<basic_vec_ctor_proxy, ArgT0, ArgTs...>::value
+						magic_kind_t<ArgT0, ArgTs...>::value == magic_ctor_category::implicit_ctor
 					>
 				>
 				CGRA_CONSTEXPR_FUNCTION basic_vec_ctor_proxy(ArgT0 &&arg0, ArgTs &&...args) :
-					// note that cat_impl constructs a basic_vec_ctor_proxy, not a basic_vec
-					// the latter would result in recursively delegating to this ctor
-					// in correct operation, the (default) move ctor is delegated to
-					basic_vec_ctor_proxy{intellisense_constify(cat_impl<basic_vec_ctor_proxy>(std::forward<ArgT0>(arg0), std::forward<ArgTs>(args)...))}
+					basic_vec_ctor_proxy{typename magic_kind_t<ArgT0, ArgTs...>::dispatch_tag(), std::forward<ArgT0>(arg0), std::forward<ArgTs>(args)...}
 				{}
 
-				// general magic ctor (explicit)
-				// this explicit version allows arguments with a different total number of elements and
-				// element types that are only explicitly convertible
+				// magic ctor (explicit)
+				// allows arguments with a different total number of elements (unless exact size is required)
+				// and element types that are only explicitly convertible; single args must still be vectors
 				template <
 					typename ArgT0,
 					typename ...ArgTs,
 					typename = std::enable_if_t<
-						(sizeof...(ArgTs) >= 1)
-						&& can_have_explicit_magic_ctor<basic_vec_ctor_proxy, require_exact_size, ArgT0, ArgTs...>::value
-						// second condition needed to not conflict with implicit general magic ctor
-						&& !can_have_implicit_magic_ctor<basic_vec_ctor_proxy, ArgT0, ArgTs...>::value
+						magic_kind_t<ArgT0, ArgTs...>::value == magic_ctor_category::explicit_ctor
 					>,
 					typename = void
 				>
 				CGRA_CONSTEXPR_FUNCTION explicit basic_vec_ctor_proxy(ArgT0 &&arg0, ArgTs &&...args) :
-					basic_vec_ctor_proxy{intellisense_constify(cat_impl<basic_vec_ctor_proxy>(std::forward<ArgT0>(arg0), std::forward<ArgTs>(args)...))}
+					basic_vec_ctor_proxy{typename magic_kind_t<ArgT0, ArgTs...>::dispatch_tag(), std::forward<ArgT0>(arg0), std::forward<ArgTs>(args)...}
 				{}
 
-				// 1-arg magic ctor (implicit)
-				// this is separate from the general magic ctor to restrict single args to only vectors
-				// ie, it disables implicit conversion of scalars to vectors with the magic ctors
-				// this implicit version checks that the vector sizes are the same and the element types are implicitly convertible
-				template <
-					typename VecT,
-					typename = std::enable_if_t<
-						can_have_implicit_magic_ctor<basic_vec_ctor_proxy, VecT>::value
-					>
-				>
-				CGRA_CONSTEXPR_FUNCTION basic_vec_ctor_proxy(VecT &&v) :
-					basic_vec_ctor_proxy{intellisense_constify(cat_impl<basic_vec_ctor_proxy>(std::forward<VecT>(v)))}
+			private:
+				// general case, concatenate args
+				// remaining elements are default constructed and extra ones are ignored
+				template <typename ...ArgTs>
+				CGRA_CONSTEXPR_FUNCTION basic_vec_ctor_proxy(vec_magic_cat_tag, ArgTs &&...args) :
+					basic_vec_ctor_proxy{
+						vec_magic_cat_tag(),
+						magic_kind_t<ArgTs...>(),
+						std::make_index_sequence<N>(),
+						// calling forward_as_tuple calls tuple's defaulted move ctor
+						// this compiles fine in vs2017, but intellisense thinks it isn't constexpr
+						// so, we call tuple's ctor directly to stop it complaining
+						std::tuple<ArgTs &&...>{std::forward<ArgTs>(args)...}
+					}
 				{}
 
-				// 1-arg magic ctor (explicit)
-				// this explicit version also restricts single args to only vectors, but allows vectors of different sizes
-				// and those whose elements are only explicitly convertible
-				template <
-					typename VecT,
-					typename = std::enable_if_t<
-						can_have_explicit_magic_ctor<basic_vec_ctor_proxy, require_exact_size, VecT>::value
-						// second condition needed to not conflict with implicit 1-arg magic ctor
-						&& !can_have_implicit_magic_ctor<basic_vec_ctor_proxy, VecT>::value
-					>,
-					typename = void
-				>
-				CGRA_CONSTEXPR_FUNCTION explicit basic_vec_ctor_proxy(VecT &&v) :
-					basic_vec_ctor_proxy{intellisense_constify(cat_impl<basic_vec_ctor_proxy>(std::forward<VecT>(v)))}
+				template <typename KindT, size_t ...Ks, typename ArgTupT>
+				CGRA_CONSTEXPR_FUNCTION basic_vec_ctor_proxy(vec_magic_cat_tag, KindT, std::index_sequence<Ks...>, ArgTupT &&args) :
+					base_data_t{intellisense_constify(static_cast<T>(magic_cat_get<KindT::cat_offset(Ks)>(
+						bool_constant<(KindT::cat_arg(Ks) < std::tuple_size<std::decay_t<ArgTupT>>::value)>(),
+						index_constant<KindT::cat_arg(Ks)>(),
+						std::forward<ArgTupT>(args)
+					)))...}
+				{}
+
+				template <size_t J, size_t I, typename ArgTupT>
+				CGRA_CONSTEXPR_FUNCTION static decltype(auto) magic_cat_get(std::true_type, index_constant<I>, ArgTupT &&args) {
+					return vec_get<basic_vec_ctor_proxy, J>(std::get<I>(std::forward<ArgTupT>(args)));
+				}
+
+				template <size_t J, size_t I, typename ArgTupT>
+				CGRA_CONSTEXPR_FUNCTION static T magic_cat_get(std::false_type, index_constant<I>, ArgTupT &&) {
+					return T();
+				}
+
+				// single vector of the same size
+				template <typename VecT>
+				CGRA_CONSTEXPR_FUNCTION basic_vec_ctor_proxy(vec_magic_vector_tag, VecT &&v) :
+					basic_vec_ctor_proxy{vec_magic_vector_tag(), std::make_index_sequence<N>(), std::forward<VecT>(v)}
+				{}
+
+				template <typename VecT, size_t ...Is>
+				CGRA_CONSTEXPR_FUNCTION basic_vec_ctor_proxy(vec_magic_vector_tag, std::index_sequence<Is...>, VecT &&v) :
+					base_data_t{intellisense_constify(static_cast<T>(array_traits<std::decay_t<VecT>>::template get<Is>(std::forward<VecT>(v))))...}
 				{}
 
 			};
@@ -2287,7 +2417,7 @@ namespace cgra {
 
 				// real + vector imag ctor
 				CGRA_CONSTEXPR_FUNCTION basic_quat(T w_, basic_vec<T, 3> xyz) :
-					w(std::move(w_)), x(std::move(xyz.x)), y(std::move(xyz.y)), z(std::move(xyz.y)) {}
+					w(std::move(w_)), x(std::move(xyz.x)), y(std::move(xyz.y)), z(std::move(xyz.z)) {}
 
 				// TODO complex ctor?
 
@@ -2361,11 +2491,6 @@ namespace cgra {
 				swap(lhs.z, rhs.z);
 			}
 
-			template <typename T>
-			inline std::ostream & operator<<(std::ostream &out, const basic_quat<T> &v) {
-				return out << '(' << v.w << " + " << v.x << "i + " << v.y << "j + " << v.z << "k)";
-			}
-
 		}
 
 		namespace vectors {
@@ -2563,17 +2688,6 @@ namespace cgra {
 					}
 				}
 
-				template <typename T, size_t N>
-				inline std::ostream & operator<<(std::ostream &out, const basic_vec<T, N> &v) {
-					out << '(';
-					if (N > 0) out << v[0];
-					for (size_t i = 1; i < N; ++i) {
-						out << ", " << v[i];
-					}
-					out << ')';
-					return out;
-				}
-
 				template <typename T, size_t N>
 				inline T * begin(basic_vec<T, N> &v) { return v.data(); }
 
@@ -2594,110 +2708,245 @@ namespace cgra {
 
 			}
 
-		}
-
-		namespace matrices {
-
-			// Cols x Rows matrix of type T
-			template <typename T, size_t Cols, size_t Rows>
-			class basic_mat : protected basic_vec<basic_vec<T, Rows>, Cols> {
+			// non-owning view of N contiguous elements of type T (which may be const)
+			// usable as a vector by the generic functions; views are shallow-const, and assignment writes through
+			template <typename T, size_t N>
+			class vec_view {
 			private:
-				using vec_t = basic_vec<basic_vec<T, Rows>, Cols>;
-				using element_t = basic_vec<T, Rows>;
+				T *m_data;
+
+				// parameter type for the copy-assignment declaration that does not apply
+				struct no_assign {};
+				using copy_t = std::conditional_t<std::is_const<T>::value, no_assign, vec_view>;
+				using const_copy_t = std::conditional_t<std::is_const<T>::value, vec_view, no_assign>;
 
 			public:
-				using value_t = T;
-				static constexpr size_t cols = Cols;
-				static constexpr size_t rows = Rows;
+				using value_t = std::remove_const_t<T>;
+				static constexpr size_t size = N;
 
-				// TODO should this member exist? is it useful? could be confusing vs. basic_vec::size
-				//static constexpr size_t size = Cols * Rows;
+				CGRA_CONSTEXPR_FUNCTION explicit vec_view(T *data_) : m_data(data_) {
+					assert(m_data);
+				}
 
-				// define default ctor
-				CGRA_DEFINE_DEFAULT_CTOR(basic_mat, vec_t, element_t, cols)
+				CGRA_CONSTEXPR_FUNCTION vec_view(basic_vec<value_t, N> &v) : m_data(v.data()) { }
 
-				// define magic ctor
-				CGRA_DEFINE_MAGIC_CTOR(basic_mat, vec_t, element_t, cols)
+				template <typename U = T, typename = std::enable_if_t<std::is_const<U>::value>>
+				CGRA_CONSTEXPR_FUNCTION vec_view(const basic_vec<value_t, N> &v) : m_data(v.data()) { }
 
-				// make inherited functions visible
-				using vec_t::operator[];
+				// non-const to const
+				template <typename U, typename = std::enable_if_t<!std::is_same<U, T>::value && std::is_same<const U, T>::value>>
+				CGRA_CONSTEXPR_FUNCTION vec_view(const vec_view<U, N> &v) : m_data(v.data()) { }
 
-				// identity ctor
-				// this does not hide the inherited scalar broadcast ctor
-				// (that takes a vec<T>, this takes a T)
-				CGRA_CONSTEXPR_FUNCTION explicit basic_mat(const T &t) {
-					for (size_t i = 0; i < std::min(Cols, Rows); i++) {
-						(*this)[i][i] = t;
+				// copying a view does not copy the elements
+				CGRA_CONSTEXPR_FUNCTION vec_view(const vec_view &other) = default;
+
+				// assignment writes the elements, not the pointer
+				// the source is copied first, so overlapping views are safe
+				CGRA_CONSTEXPR_FUNCTION const vec_view & operator=(const copy_t &other) const {
+					value_t t[N];
+					for (size_t i = 0; i < N; i++) {
+						t[i] = other.m_data[i];
+					}
+					for (size_t i = 0; i < N; i++) {
+						m_data[i] = t[i];
 					}
+					return *this;
 				}
 
-				CGRA_CONSTEXPR_FUNCTION T * data() { return &(*this)[0][0]; }
+				// views of const elements cannot be assigned to
+				vec_view & operator=(const const_copy_t &) = delete;
 
-				CGRA_CONSTEXPR_FUNCTION const T * data() const { return &(*this)[0][0]; }
+				template <
+					typename VecT,
+					typename = std::enable_if_t<!std::is_const<T>::value && detail::is_array_compatible<vec_view, VecT>::value>
+				>
+				CGRA_CONSTEXPR_FUNCTION const vec_view & operator=(const VecT &v) const {
+					const basic_vec<value_t, N> t(v);
+					for (size_t i = 0; i < N; i++) {
+						m_data[i] = t[i];
+					}
+					return *this;
+				}
 
-				CGRA_CONSTEXPR_FUNCTION vec_t & as_vec() { return *this; }
+				CGRA_CONSTEXPR_FUNCTION operator basic_vec<value_t, N>() const {
+					basic_vec<value_t, N> r;
+					for (size_t i = 0; i < N; i++) {
+						r[i] = m_data[i];
+					}
+					return r;
+				}
 
-				CGRA_CONSTEXPR_FUNCTION const vec_t & as_vec() const { return *this; }
+				CGRA_CONSTEXPR_FUNCTION T & operator[](size_t i) const {
+					assert(i < N);
+					return m_data[i];
+				}
 
+				CGRA_CONSTEXPR_FUNCTION T * data() const { return m_data; }
 			};
 
-			namespace functions {
+			// non-owning view of vectors spaced a fixed number of bytes apart,
+			// eg one attribute of an interleaved vertex buffer
+			// VecT is basic_vec<T, N> or const basic_vec<T, N>; elements are accessed through vec_view
+			template <typename VecT>
+			class strided_span {
+			private:
+				using vec_t = std::remove_const_t<VecT>;
+				using byte_t = std::conditional_t<std::is_const<VecT>::value, const unsigned char, unsigned char>;
 
-				template <typename T, size_t Cols, size_t Rows>
-				void swap(basic_mat<T, Cols, Rows> &lhs, basic_mat<T, Cols, Rows> &rhs) {
-					// TODO c++17: noexcept(std::is_nothrow_swappable<T>::value)
-					for (size_t i = 0; i < Cols; i++) {
-						using std::swap;
-						swap(lhs[i], rhs[i]);
+				template <typename U>
+				friend class strided_span;
+
+				byte_t *m_data = nullptr;
+				size_t m_size = 0;
+				size_t m_stride = sizeof(VecT);
+
+			public:
+				using value_t = typename vec_t::value_t;
+				using component_t = std::conditional_t<std::is_const<VecT>::value, const value_t, value_t>;
+				using element_type = vec_view<component_t, vec_t::size>;
+
+				class iterator {
+				private:
+					byte_t *m_p = nullptr;
+					size_t m_stride = 0;
+
+				public:
+					using iterator_category = std::input_iterator_tag;
+					using value_type = vec_t;
+					using difference_type = std::ptrdiff_t;
+					using pointer = void;
+					using reference = element_type;
+
+					CGRA_CONSTEXPR_FUNCTION iterator() { }
+
+					CGRA_CONSTEXPR_FUNCTION iterator(byte_t *p_, size_t stride_) : m_p(p_), m_stride(stride_) { }
+
+					CGRA_CONSTEXPR_FUNCTION element_type operator*() const {
+						return element_type(reinterpret_cast<component_t *>(m_p));
 					}
-				}
 
-				template <typename T, size_t Cols, size_t Rows>
-				inline std::ostream & operator<<(std::ostream &out, const basic_mat<T, Cols, Rows> &m) {
-					static const char *toplinestart = Rows > 1 ? "/ " : "[ ";
-					static const char *toplineend = Rows > 1 ? " \\" : " ]";
-					static const char *midlinestart = "| ";
-					static const char *midlineend = " |";
-					static const char *bottomlinestart = Rows > 1 ? "\\ " : "[ ";
-					static const char *bottomlineend = Rows > 1 ? " /" : " ]";
-					// calculate column widths
-					size_t maxwidths[Cols];
-					std::ostringstream tempss;
-					tempss.precision(out.precision());
-					for (size_t i = 0; i < Cols; ++i) {
-						maxwidths[i] = 0;
-						for (size_t j = 0; j < Rows; ++j) {
-							// msvc: seeking to 0 on empty stream sets failbit
-							tempss.seekp(0);
-							tempss.clear();
-							tempss << m[i][j];
-							maxwidths[i] = size_t(tempss.tellp()) > maxwidths[i] ? size_t(tempss.tellp()) : maxwidths[i];
-						}
+					CGRA_CONSTEXPR_FUNCTION iterator & operator++() {
+						m_p += m_stride;
+						return *this;
 					}
-					// print
-					for (size_t i = 0; i < Rows; ++i) {
-						if (i == 0) {
-							out << toplinestart;
-						} else if (i + 1 == Rows) {
-							out << bottomlinestart;
-						} else {
-							out << midlinestart;
-						}
-						for (size_t j = 0; j < Cols; ++j) {
-							out.width(maxwidths[j]);
-							out << m[j][i];
-							if (j + 1 < Cols) out << ", ";
-						}
-						if (i == 0) {
-							out << toplineend;
-						} else if (i + 1 == Rows) {
-							out << bottomlineend;
-						} else {
-							out << midlineend;
-						}
-						if (i + 1 < Rows) out << '\n';
+
+					CGRA_CONSTEXPR_FUNCTION iterator operator++(int) {
+						iterator r = *this;
+						m_p += m_stride;
+						return r;
+					}
+
+					CGRA_CONSTEXPR_FUNCTION bool operator==(const iterator &other) const { return m_p == other.m_p; }
+					CGRA_CONSTEXPR_FUNCTION bool operator!=(const iterator &other) const { return m_p != other.m_p; }
+				};
+
+				CGRA_CONSTEXPR_FUNCTION strided_span() { }
+
+				// count vectors, the first starting at first, spaced stride bytes apart
+				CGRA_CONSTEXPR_FUNCTION strided_span(component_t *first, size_t count, size_t stride_) :
+					m_data(reinterpret_cast<byte_t *>(first)), m_size(count), m_stride(stride_)
+				{
+					assert(m_stride >= sizeof(VecT) || m_size <= 1);
+				}
+
+				CGRA_CONSTEXPR_FUNCTION strided_span(VecT *first, size_t count, size_t stride_ = sizeof(VecT)) :
+					strided_span(first ? first->data() : nullptr, count, stride_)
+				{ }
+
+				// any contiguous container of VecT (including span)
+				template <
+					typename ContainerT,
+					typename = std::enable_if_t<std::is_constructible<span<VecT>, ContainerT &&>::value>
+				>
+				CGRA_CONSTEXPR_FUNCTION strided_span(ContainerT &&c) {
+					span<VecT> s(std::forward<ContainerT>(c));
+					*this = strided_span(s.data(), s.size());
+				}
+
+				// non-const to const
+				template <typename U, typename = std::enable_if_t<!std::is_same<U, VecT>::value && std::is_same<const U, VecT>::value>>
+				CGRA_CONSTEXPR_FUNCTION strided_span(const strided_span<U> &other) :
+					m_data(other.m_data), m_size(other.m_size), m_stride(other.m_stride)
+				{ }
+
+				CGRA_CONSTEXPR_FUNCTION component_t * data() const { return reinterpret_cast<component_t *>(m_data); }
+				CGRA_CONSTEXPR_FUNCTION size_t size() const { return m_size; }
+				CGRA_CONSTEXPR_FUNCTION size_t stride() const { return m_stride; }
+				CGRA_CONSTEXPR_FUNCTION bool empty() const { return m_size == 0; }
+
+				CGRA_CONSTEXPR_FUNCTION iterator begin() const { return iterator(m_data, m_stride); }
+				CGRA_CONSTEXPR_FUNCTION iterator end() const { return iterator(m_data + m_size * m_stride, m_stride); }
+
+				CGRA_CONSTEXPR_FUNCTION element_type operator[](size_t i) const {
+					assert(i < m_size);
+					return element_type(reinterpret_cast<component_t *>(m_data + i * m_stride));
+				}
+
+				CGRA_CONSTEXPR_FUNCTION strided_span subspan(size_t offset, size_t count) const {
+					assert(offset + count <= m_size);
+					strided_span r = *this;
+					r.m_data += offset * m_stride;
+					r.m_size = count;
+					return r;
+				}
+			};
+
+		}
+
+		namespace matrices {
+
+			// Cols x Rows matrix of type T
+			template <typename T, size_t Cols, size_t Rows>
+			class basic_mat : protected basic_vec<basic_vec<T, Rows>, Cols> {
+			private:
+				using vec_t = basic_vec<basic_vec<T, Rows>, Cols>;
+				using element_t = basic_vec<T, Rows>;
+
+			public:
+				using value_t = T;
+				static constexpr size_t cols = Cols;
+				static constexpr size_t rows = Rows;
+
+				// TODO should this member exist? is it useful? could be confusing vs. basic_vec::size
+				//static constexpr size_t size = Cols * Rows;
+
+				// define default ctor
+				CGRA_DEFINE_DEFAULT_CTOR(basic_mat, vec_t, element_t, cols)
+
+				// define magic ctor
+				CGRA_DEFINE_MAGIC_CTOR(basic_mat, vec_t, element_t, cols)
+
+				// make inherited functions visible
+				using vec_t::operator[];
+
+				// identity ctor
+				// this does not hide the inherited scalar broadcast ctor
+				// (that takes a vec<T>, this takes a T)
+				CGRA_CONSTEXPR_FUNCTION explicit basic_mat(const T &t) {
+					for (size_t i = 0; i < std::min(Cols, Rows); i++) {
+						(*this)[i][i] = t;
+					}
+				}
+
+				CGRA_CONSTEXPR_FUNCTION T * data() { return &(*this)[0][0]; }
+
+				CGRA_CONSTEXPR_FUNCTION const T * data() const { return &(*this)[0][0]; }
+
+				CGRA_CONSTEXPR_FUNCTION vec_t & as_vec() { return *this; }
+
+				CGRA_CONSTEXPR_FUNCTION const vec_t & as_vec() const { return *this; }
+
+			};
+
+			namespace functions {
+
+				template <typename T, size_t Cols, size_t Rows>
+				void swap(basic_mat<T, Cols, Rows> &lhs, basic_mat<T, Cols, Rows> &rhs) {
+					// TODO c++17: noexcept(std::is_nothrow_swappable<T>::value)
+					for (size_t i = 0; i < Cols; i++) {
+						using std::swap;
+						swap(lhs[i], rhs[i]);
 					}
-					return out;
 				}
 
 				template <typename T, size_t Cols, size_t Rows>
@@ -2768,6 +3017,92 @@ namespace cgra {
 			}
 		};
 
+		// balanced binary tree over elements [I, I + N)
+		template <size_t I, size_t N>
+		struct fold_tree_impl {
+			template <typename F, typename ArgT>
+			static CGRA_CONSTEXPR_FUNCTION auto apply(F f, const ArgT &v) {
+				return f(fold_tree_impl<I, N / 2>::apply(f, v), fold_tree_impl<I + N / 2, N - N / 2>::apply(f, v));
+			}
+		};
+
+		template <size_t I>
+		struct fold_tree_impl<I, 1> {
+			template <typename F, typename ArgT>
+			static CGRA_CONSTEXPR_FUNCTION auto apply(F, const ArgT &v) {
+				return array_traits<std::decay_t<ArgT>>::template get<I>(v);
+			}
+		};
+
+		// reduction::pairwise sum, zero for empty v
+		template <typename VecT>
+		inline auto sum_tree_impl(const VecT &v, std::true_type) {
+			return fold_tree_impl<0, array_size<VecT>::value>::apply(op::add(), v);
+		}
+
+		template <typename VecT>
+		inline auto sum_tree_impl(const VecT &, std::false_type) {
+			return array_value_t<VecT>{};
+		}
+
+		// reduction::kahan sum
+		// only floating-point elements are compensated; integers round nothing and are
+		// summed in order, and vector elements are compensated per component
+		template <typename VecT, typename = void>
+		struct kahan_sum_impl {
+			static auto go(const VecT &v) {
+				return fold_impl<0, array_size<VecT>::value>::apply(op::add(), array_value_t<VecT>{}, v);
+			}
+		};
+
+		template <typename VecT>
+		struct kahan_sum_impl<VecT, std::enable_if_t<std::is_floating_point<array_value_t<VecT>>::value>> {
+			using value_t = array_value_t<VecT>;
+
+			// running sum and compensation
+			struct state {
+				value_t s{};
+				value_t c{};
+			};
+
+			static value_t go(const VecT &v) {
+				const state r = fold_impl<0, array_size<VecT>::value>::apply([](state k, value_t x) {
+					using std::abs;
+					const value_t t = k.s + x;
+					// the low bits lost from whichever operand is smaller
+					// (selecting operands rather than expressions keeps this branch-free)
+					const bool s_big = abs(k.s) >= abs(x);
+					const value_t big = s_big ? k.s : x;
+					const value_t small = s_big ? x : k.s;
+					k.c += (big - t) + small;
+					k.s = t;
+					return k;
+				}, state{}, v);
+				return r.s + r.c;
+			}
+		};
+
+		template <typename VecT>
+		struct kahan_sum_impl<VecT, std::enable_if_t<is_vector<array_value_t<VecT>>::value && (array_size<VecT>::value > 0)>> {
+			using elem_t = array_value_t<VecT>;
+			using component_t = array_value_t<elem_t>;
+			static constexpr size_t count = array_size<VecT>::value;
+
+			// component k of every element, as one vector
+			template <size_t ...Is>
+			static basic_vec<component_t, count> components(const VecT &v, size_t k, std::index_sequence<Is...>) {
+				return basic_vec<component_t, count>{array_traits<VecT>::template get<Is>(v)[k]...};
+			}
+
+			static auto go(const VecT &v) {
+				std::decay_t<decltype(std::declval<elem_t>() + std::declval<elem_t>())> r{};
+				for (size_t k = 0; k < array_size<elem_t>::value; ++k) {
+					r[k] = kahan_sum_impl<basic_vec<component_t, count>>::go(components(v, k, std::make_index_sequence<count>()));
+				}
+				return r;
+			}
+		};
+
 		// fill, but as a repeat_vec
 		template <typename VecT, typename T>
 		CGRA_CONSTEXPR_FUNCTION auto fill_repeat(const T &);
@@ -2794,6 +3129,46 @@ namespace cgra {
 
 	}
 
+	// summation orders for sum, dot and length, passed as the last argument
+	// eg: sum(v, reduction::kahan())
+	namespace reduction {
+
+		// left to right, v[0] + v[1] + ...; one long dependency chain
+		struct sequential {};
+
+		// balanced tree of partial sums; independent adds pipeline and vectorize,
+		// and the rounding error grows with log(N) rather than N
+		struct pairwise {};
+
+		// Neumaier's compensated summation; the rounding error does not grow with N,
+		// at about four times the adds (and not under -ffast-math, which removes the compensation)
+		// vectors of vectors are compensated per component; anything not floating point is summed in order
+		struct kahan {};
+
+	}
+
+// reduction used by sum, dot and length when none is given
+#ifndef CGRA_DEFAULT_REDUCTION
+#define CGRA_DEFAULT_REDUCTION sequential
+#endif
+
+	namespace reduction {
+		using default_policy = CGRA_DEFAULT_REDUCTION;
+	}
+
+	namespace detail {
+
+		template <typename T>
+		struct is_reduction_policy : bool_constant<
+			std::is_same<T, reduction::sequential>::value ||
+			std::is_same<T, reduction::pairwise>::value ||
+			std::is_same<T, reduction::kahan>::value
+		> {};
+
+		template <typename T>
+		using enable_if_reduction_policy_t = std::enable_if_t<is_reduction_policy<std::decay_t<T>>::value, int>;
+	}
+
 	// metafunction class: convert array-like type to vector
 	struct type_to_vec {
 		template <typename VecT>
@@ -2856,6 +3231,15 @@ namespace cgra {
 					return fold_impl<0, array_size<VecT>::value>::apply(f, std::forward<T1>(t1), std::forward<VecT>(v));
 				}
 
+				// Produce a scalar by applying f(T, T) -> T to the elements of v as a balanced binary tree,
+				// i.e., f(f(v[0], v[1]), f(v[2], v[3])) for 4 elements; v must not be empty
+				// gives the same result as fold for associative f, with a shorter dependency chain
+				template <typename F, typename VecT, typename = enable_if_array_t<VecT>>
+				CGRA_CONSTEXPR_FUNCTION auto fold_tree(F f, const VecT &v) {
+					static_assert(array_size<VecT>::value > 0, "fold_tree needs at least one element");
+					return fold_tree_impl<0, array_size<VecT>::value>::apply(f, v);
+				}
+
 				// fill an array-like type VecT with copies of a (relatively) scalar-like value of type T
 				template <typename VecT, typename T>
 				CGRA_CONSTEXPR_FUNCTION inline VecT fill(const T &t) {
@@ -2863,10 +3247,26 @@ namespace cgra {
 					return VecT{fill_repeat<VecT>(t)};
 				}
 
+				// sum of all x in v, i.e., v[0] + v[1] + ..., in the order given by the reduction policy
+				template <typename VecT, typename = enable_if_array_t<VecT>>
+				inline auto sum(const VecT &v, reduction::sequential) {
+					return fold(detail::op::add(), array_value_t<VecT>{}, v);
+				}
+
+				template <typename VecT, typename = enable_if_array_t<VecT>>
+				inline auto sum(const VecT &v, reduction::pairwise) {
+					return detail::sum_tree_impl(v, bool_constant<(array_size<VecT>::value > 0)>());
+				}
+
+				template <typename VecT, typename = enable_if_array_t<VecT>>
+				inline auto sum(const VecT &v, reduction::kahan) {
+					return detail::kahan_sum_impl<VecT>::go(v);
+				}
+
 				// sum of all x in v, i.e., v[0] + v[1] + ...
 				template <typename VecT, typename = enable_if_array_t<VecT>>
 				inline auto sum(const VecT &v) {
-					return fold(detail::op::add(), array_value_t<VecT>{}, v);
+					return sum(v, reduction::default_policy());
 				}
 
 				// product of all x in v, i.e., v[0] * v[1] * ...
@@ -2875,11 +3275,17 @@ namespace cgra {
 					return fold(detail::op::mul(), array_value_t<VecT>{1}, v);
 				}
 
+				// dot product of v1 and v2, i.e., (v1[0] * v2[0]) + (v1[1] * v2[1]) + ...
+				// summed in the order given by the reduction policy
+				template <typename VecT1, typename VecT2, typename Policy, typename = enable_if_array_t<VecT1, VecT2>, enable_if_reduction_policy_t<Policy> = 0>
+				inline auto dot(const VecT1 &v1, const VecT2 &v2, Policy policy) {
+					return sum(zip_with(detail::op::mul(), v1, v2), policy);
+				}
+
 				// dot product of v1 and v2, i.e., (v1[0] * v2[0]) + (v1[1] * v2[1]) + ...
 				template <typename VecT1, typename VecT2, typename = enable_if_array_t<VecT1, VecT2>>
 				inline auto dot(const VecT1 &v1, const VecT2 &v2) {
-					auto vprod = zip_with(detail::op::mul(), v1, v2);
-					return fold(detail::op::add(), array_value_t<decltype(vprod)>{}, std::move(vprod));
+					return dot(v1, v2, reduction::default_policy());
 				}
 
 				// true iff any component of v is true; empty => false
@@ -3046,14 +3452,24 @@ namespace cgra {
 					return q;
 				}
 
-				// quat mul vec3 (rotate vec3 by quat)
-				// TODO allow other vector types
-				template <typename T1, typename T2, enable_if_mutually_convertible_t<T1, T2> = 0>
-				inline auto operator*(const basic_quat<T1> &lhs, const basic_vec<T2, 3> &rhs) {
-					using common_t = decltype(T1() * T2());
-					basic_quat<common_t> p{common_t{}, rhs};
-					p = lhs * p * inverse(lhs);
-					return basic_vec<common_t, 3>(p.x, p.y, p.z);
+				// quat mul vec3 (rotate vec3 by quat), for any array-like 3-vector
+				// q * v * inverse(q) expanded to v + w * t + cross(u, t) with t = 2 * cross(u, v) / norm(q),
+				// about a third of the work of the two quaternion products; see rotate_unit to skip the norm
+				template <typename T1, typename VecT, std::enable_if_t<is_vector_scalar_compatible<VecT, T1>::value && array_size<VecT>::value == 3, int> = 0>
+				inline auto operator*(const basic_quat<T1> &lhs, const VecT &rhs) {
+					using traits = array_traits<std::decay_t<VecT>>;
+					using common_t = decltype(T1() * array_value_t<VecT>());
+					const common_t vx = traits::template get<0>(rhs), vy = traits::template get<1>(rhs), vz = traits::template get<2>(rhs);
+					// cross products spelled out so the core section does not need the vector functions
+					const common_t s = common_t(2) / (lhs.w * lhs.w + lhs.x * lhs.x + lhs.y * lhs.y + lhs.z * lhs.z);
+					const common_t tx = (lhs.y * vz - lhs.z * vy) * s;
+					const common_t ty = (lhs.z * vx - lhs.x * vz) * s;
+					const common_t tz = (lhs.x * vy - lhs.y * vx) * s;
+					return basic_vec<common_t, 3>(
+						vx + lhs.w * tx + (lhs.y * tz - lhs.z * ty),
+						vy + lhs.w * ty + (lhs.z * tx - lhs.x * tz),
+						vz + lhs.w * tz + (lhs.x * ty - lhs.y * tx)
+					);
 				}
 
 				// quat mul right scalar
@@ -4733,12 +5149,15 @@ namespace cgra {
 
 			template <>
 			struct cross_impl<3> {
+				// through array_traits, so any array-like 3-vector works
 				template <typename VecT1, typename VecT2>
 				static auto go(const VecT1 &v1, const VecT2 &v2) {
-					return basic_vec<decltype(v1[0] * v2[0]), 3>(
-						v1[1] * v2[2] - v1[2] * v2[1],
-						v1[2] * v2[0] - v1[0] * v2[2],
-						v1[0] * v2[1] - v1[1] * v2[0]
+					using t1 = array_traits<VecT1>;
+					using t2 = array_traits<VecT2>;
+					return basic_vec<decltype(t1::template get<0>(v1) * t2::template get<0>(v2)), 3>(
+						t1::template get<1>(v1) * t2::template get<2>(v2) - t1::template get<2>(v1) * t2::template get<1>(v2),
+						t1::template get<2>(v1) * t2::template get<0>(v2) - t1::template get<0>(v1) * t2::template get<2>(v2),
+						t1::template get<0>(v1) * t2::template get<1>(v2) - t1::template get<1>(v1) * t2::template get<0>(v2)
 					);
 				}
 			};
@@ -4760,6 +5179,13 @@ namespace cgra {
 					return sqrt(sum(v * v));
 				}
 
+				// Returns the length of vector v, with the squares summed in the order given by the reduction policy
+				template <typename VecT, typename Policy, enable_if_vector_t<VecT> = 0, enable_if_reduction_policy_t<Policy> = 0>
+				inline auto length(const VecT &v, Policy policy) {
+					using cgra::detail::scalars::sqrt;
+					return sqrt(sum(v * v, policy));
+				}
+
 				// Returns the distance between p1 and p2, i.e., length (p1 – p2)
 				template <typename VecT1, typename VecT2, enable_if_vector_compatible_t<VecT1, VecT2> = 0>
 				inline auto distance(const VecT1 &p1, const VecT2 &p2) {
@@ -4927,6 +5353,42 @@ namespace cgra {
 
 
 
+	// 
+	// explicit instantiations
+	// 
+	// The common vec, mat and quat types are explicitly instantiated in the
+	// optional cgra_math static library (cgra_math.cpp). Defining
+	// CGRA_MATH_EXTERN_TEMPLATES declares those instantiations extern so each
+	// translation unit can skip instantiating the class members itself.
+	// 
+	//=================
+
+#define CGRA_MATH_COMMON_INSTANTIATIONS(X) \
+	X(detail::vectors::basic_vec<float, 2>) X(detail::vectors::basic_vec<float, 3>) X(detail::vectors::basic_vec<float, 4>) \
+	X(detail::vectors::basic_vec<double, 2>) X(detail::vectors::basic_vec<double, 3>) X(detail::vectors::basic_vec<double, 4>) \
+	X(detail::vectors::basic_vec<int, 2>) X(detail::vectors::basic_vec<int, 3>) X(detail::vectors::basic_vec<int, 4>) \
+	X(detail::matrices::basic_mat<float, 2, 2>) X(detail::matrices::basic_mat<float, 3, 3>) X(detail::matrices::basic_mat<float, 4, 4>) \
+	X(detail::matrices::basic_mat<double, 2, 2>) X(detail::matrices::basic_mat<double, 3, 3>) X(detail::matrices::basic_mat<double, 4, 4>) \
+	X(detail::scalars::basic_quat<float>) X(detail::scalars::basic_quat<double>)
+
+#ifdef CGRA_MATH_EXTERN_TEMPLATES
+#define CGRA_MATH_EXTERN_TEMPLATE_(...) extern template class __VA_ARGS__;
+	CGRA_MATH_COMMON_INSTANTIATIONS(CGRA_MATH_EXTERN_TEMPLATE_)
+#undef CGRA_MATH_EXTERN_TEMPLATE_
+#endif
+
+}
+
+#endif // CGRA_MATH_CORE_HPP
+
+
+
+
+#if defined(CGRA_MATH_WANT_MAT_) && !defined(CGRA_MATH_MAT_HPP)
+#define CGRA_MATH_MAT_HPP
+
+namespace cgra {
+
 	//  .___  ___.      ___   .___________..______       __  ___   ___     _______  __    __  .__   __.   ______ .___________. __    ______   .__   __.      _______.  //
 	//  |   \/   |     /   \  |           ||   _  \     |  | \  \ /  /    |   ____||  |  |  | |  \ |  |  /      ||           ||  |  /  __  \  |  \ |  |     /       |  //
 	//  |  \  /  |    /  ^  \ `---|  |----`|  |_)  |    |  |  \  V  /     |  |__   |  |  |  | |   \|  | |  ,----'`---|  |----`|  | |  |  |  | |   \|  |    |   (----`  //
@@ -5246,9 +5708,18 @@ namespace cgra {
 		}
 	}
 
+}
+
+#endif // CGRA_MATH_MAT_HPP
+
 
 
 
+#if defined(CGRA_MATH_WANT_QUAT_) && !defined(CGRA_MATH_QUAT_HPP)
+#define CGRA_MATH_QUAT_HPP
+
+namespace cgra {
+
 	//    ______      __    __       ___   .___________. _______ .______      .__   __.  __    ______   .__   __.     _______  __    __  .__   __.   ______ .___________. __    ______   .__   __.      _______.  //
 	//   /  __  \    |  |  |  |     /   \  |           ||   ____||   _  \     |  \ |  | |  |  /  __  \  |  \ |  |    |   ____||  |  |  | |  \ |  |  /      ||           ||  |  /  __  \  |  \ |  |     /       |  //
 	//  |  |  |  |   |  |  |  |    /  ^  \ `---|  |----`|  |__   |  |_)  |    |   \|  | |  | |  |  |  | |   \|  |    |  |__   |  |  |  | |   \|  | |  ,----'`---|  |----`|  | |  |  |  | |   \|  |    |   (----`  //
@@ -5281,6 +5752,17 @@ namespace cgra {
 					return conj(q) * (fpromote_t<T>(1) / dot(q, q));
 				}
 
+				// rotate an array-like 3-vector by a unit quat, v + 2 * w * cross(u, v) + 2 * cross(u, cross(u, v))
+				// cheaper than q * v, which also divides out the norm; q must be normalized
+				template <typename T, typename VecT, std::enable_if_t<is_vector_scalar_compatible<VecT, T>::value && array_size<VecT>::value == 3, int> = 0>
+				inline auto rotate_unit(const basic_quat<T> &q, const VecT &v) {
+					using common_t = decltype(T() * array_value_t<VecT>());
+					const basic_vec<common_t, 3> u{q.x, q.y, q.z};
+					const basic_vec<common_t, 3> p{v};
+					const auto t = cross(u, p) * common_t(2);
+					return p + t * common_t(q.w) + cross(u, t);
+				}
+
 				// quat rotation angle
 				template <typename T>
 				inline auto angle(const basic_quat<T> &q) {
@@ -5357,14 +5839,14 @@ namespace cgra {
 					auto p = normalize(q2);
 					value_t epsilon{0.0001};
 					if (dot(p, q) < value_t(0)) {
-						q = q * value_t{-1};
+						p = p * value_t{-1};
 					}
 					const auto dpq = dot(p, q);
 					if ((value_t(1) - dpq) > epsilon) {
 						const auto w = acos(dpq);
-						return ((sin((value_t(1) - t) * w) * p) + (sin(t * w) * q)) / sin(w);
+						return ((sin((value_t(1) - t) * w) * q) + (sin(t * w) * p)) / sin(w);
 					}
-					return (value_t(1) - t) * p + t * q;
+					return (value_t(1) - t) * q + t * p;
 				}
 
 				// returns the rotation (in radians) of the quaternion around a given axis
@@ -5389,9 +5871,18 @@ namespace cgra {
 		}
 	}
 
+}
+
+#endif // CGRA_MATH_QUAT_HPP
+
 
 
 
+#if defined(CGRA_MATH_WANT_TRANSFORM_) && !defined(CGRA_MATH_TRANSFORM_HPP)
+#define CGRA_MATH_TRANSFORM_HPP
+
+namespace cgra {
+
 	//  .___________..______          ___      .__   __.      _______. _______   ______   .______      .___  ___.     _______  __    __  .__   __.   ______ .___________. __    ______   .__   __.      _______.  //
 	//  |           ||   _  \        /   \     |  \ |  |     /       ||   ____| /  __  \  |   _  \     |   \/   |    |   ____||  |  |  | |  \ |  |  /      ||           ||  |  /  __  \  |  \ |  |     /       |  //
 	//  `---|  |----`|  |_)  |      /  ^  \    |   \|  |    |   (----`|  |__   |  |  |  | |  |_)  |    |  \  /  |    |  |__   |  |  |  | |   \|  | |  ,----'`---|  |----`|  | |  |  |  | |   \|  |    |   (----`  //
@@ -5468,18 +5959,44 @@ namespace cgra {
 	// Functions for constructing 3d transformations
 	//
 
+	namespace detail {
+
+		// inverse of the orthonormal camera frame {vx, vy, vz, eye}: transposed rotation, rotated translation
+		template <typename T, typename Te>
+		inline basic_mat<T, 4, 4> view_from_frame(const basic_vec<T, 3> &vx, const basic_vec<T, 3> &vy, const basic_vec<T, 3> &vz, const basic_vec<Te, 3> &eye) {
+			basic_mat<T, 4, 4> r{T(1)};
+			for (size_t i = 0; i < 3; ++i) {
+				r[i][0] = vx[i];
+				r[i][1] = vy[i];
+				r[i][2] = vz[i];
+			}
+			r[3][0] = -dot(vx, eye);
+			r[3][1] = -dot(vy, eye);
+			r[3][2] = -dot(vz, eye);
+			return r;
+		}
+	}
+
 	template <typename Te, typename Tf, typename Tu>
 	inline auto lookat(const basic_vec<Te, 3> &eye, const basic_vec<Tf, 3> &focus, const basic_vec<Tu, 3> &up) {
 		// TODO Nan check
 		using value_t = detail::fpromote_arith_t<Te, Tf, Tu>;
-		const auto vz = normalize(eye - focus);
-		const auto vx = normalize(cross(up, vz));
-		const auto vy = normalize(cross(vz, vx));
-		basic_mat<value_t, 4, 4> r{vx, vy, vz, eye};
-		r[3][3] = value_t(1);
-		return inverse(r);
+		const basic_vec<value_t, 3> vz = normalize(eye - focus);
+		const basic_vec<value_t, 3> vx = normalize(cross(up, vz));
+		// already unit length, vz and vx are orthonormal
+		return detail::view_from_frame(vx, cross(vz, vx), vz, eye);
 	}
 
+	// clip space depth range for projection matrices
+	enum class clip_depth {
+		// near maps to -1, far to 1 (OpenGL)
+		negative_one_to_one,
+		// near maps to 0, far to 1 (Direct3D, Vulkan, Metal)
+		zero_to_one,
+		// near maps to 1, far to 0 (reversed-Z, use with a [0,1] depth buffer)
+		reversed
+	};
+
 	// fovy: vertical field of view in radians; aspect is w/h
 	template <typename Ty, typename Ta, typename Tn, typename Tf>
 	inline auto perspective(const Ty &fovy, const Ta &aspect, const Tn &znear, const Tf &zfar) {
@@ -5499,21 +6016,122 @@ namespace cgra {
 		return r;
 	}
 
+	// perspective projection with the given clip space depth range
+	template <typename Ty, typename Ta, typename Tn, typename Tf>
+	inline auto perspective(const Ty &fovy, const Ta &aspect, const Tn &znear, const Tf &zfar, clip_depth depth) {
+		using value_t = detail::fpromote_arith_t<Ty, Ta, Tn, Tf>;
+		const value_t n = znear;
+		const value_t f = zfar;
+		auto r = perspective(fovy, aspect, n, f);
+		switch (depth) {
+		case clip_depth::zero_to_one:
+			r[2][2] = f / (n - f);
+			r[3][2] = n * f / (n - f);
+			break;
+		case clip_depth::reversed:
+			r[2][2] = n / (f - n);
+			r[3][2] = n * f / (f - n);
+			break;
+		default:
+			break;
+		}
+		return r;
+	}
+
+	// perspective projection with the far plane at infinity
+	template <typename Ty, typename Ta, typename Tn>
+	inline auto perspective_infinite(const Ty &fovy, const Ta &aspect, const Tn &znear, clip_depth depth = clip_depth::negative_one_to_one) {
+		using value_t = detail::fpromote_arith_t<Ty, Ta, Tn>;
+		const value_t n = znear;
+		const auto f = cot(fovy / value_t(2));
+		basic_mat<value_t, 4, 4> r{0};
+		r[0][0] = f / aspect;
+		r[1][1] = f;
+		r[2][3] = -1;
+		switch (depth) {
+		case clip_depth::zero_to_one:
+			r[2][2] = -1;
+			r[3][2] = -n;
+			break;
+		case clip_depth::reversed:
+			r[2][2] = 0;
+			r[3][2] = n;
+			break;
+		default:
+			r[2][2] = -1;
+			r[3][2] = -2 * n;
+			break;
+		}
+		return r;
+	}
+
+	// closed form inverse of any matrix produced by perspective or perspective_infinite
+	// (also off-center frustums, where only [2][0] and [2][1] are added)
+	template <typename T>
+	inline auto inverse_perspective(const basic_mat<T, 4, 4> &m) {
+		using value_t = detail::fpromote_t<T>;
+		// x' = a x + e z, y' = b y + g z, z' = c z + d w, w' = -z
+		const value_t a = m[0][0], b = m[1][1], c = m[2][2], d = m[3][2], e = m[2][0], g = m[2][1];
+		basic_mat<value_t, 4, 4> r{0};
+		r[0][0] = 1 / a;
+		r[3][0] = e / a;
+		r[1][1] = 1 / b;
+		r[3][1] = g / b;
+		r[3][2] = -1;
+		r[2][3] = 1 / d;
+		r[3][3] = c / d;
+		return r;
+	}
+
 	template <typename Tl, typename Tr, typename Tb, typename Tt, typename Tn, typename Tf>
 	inline auto orthographic(const Tl &left, const Tr &right, const Tb &bottom, const Tt &top, const Tn &znear, const Tf &zfar) {
 		// TODO Nan check
 		using value_t = detail::fpromote_arith_t<Tl, Tr, Tb, Tt, Tn, Tf>;
 		basic_mat<value_t, 4, 4> r{0};
 		r[0][0] = value_t(2) / (right - value_t(left));
-		r[3][0] = (right + value_t(left)) / (right - value_t(left));
+		r[3][0] = -(right + value_t(left)) / (right - value_t(left));
 		r[1][1] = value_t(2) / (top - value_t(bottom));
-		r[3][1] = (top + value_t(bottom)) / (top - value_t(bottom));
+		r[3][1] = -(top + value_t(bottom)) / (top - value_t(bottom));
 		r[2][2] = -value_t(2) / (zfar - value_t(znear));
-		r[3][2] = (zfar + value_t(znear)) / (zfar - value_t(znear));
+		r[3][2] = -(zfar + value_t(znear)) / (zfar - value_t(znear));
 		r[3][3] = value_t(1);
 		return r;
 	}
 
+	// orthographic projection with the given clip space depth range
+	template <typename Tl, typename Tr, typename Tb, typename Tt, typename Tn, typename Tf>
+	inline auto orthographic(const Tl &left, const Tr &right, const Tb &bottom, const Tt &top, const Tn &znear, const Tf &zfar, clip_depth depth) {
+		using value_t = detail::fpromote_arith_t<Tl, Tr, Tb, Tt, Tn, Tf>;
+		const value_t n = znear;
+		const value_t f = zfar;
+		auto r = orthographic(left, right, bottom, top, n, f);
+		switch (depth) {
+		case clip_depth::zero_to_one:
+			r[2][2] = -1 / (f - n);
+			r[3][2] = -n / (f - n);
+			break;
+		case clip_depth::reversed:
+			r[2][2] = 1 / (f - n);
+			r[3][2] = f / (f - n);
+			break;
+		default:
+			break;
+		}
+		return r;
+	}
+
+	// closed form inverse of any matrix produced by orthographic
+	template <typename T>
+	inline auto inverse_orthographic(const basic_mat<T, 4, 4> &m) {
+		using value_t = detail::fpromote_t<T>;
+		basic_mat<value_t, 4, 4> r{1};
+		for (size_t i = 0; i < 3; ++i) {
+			r[i][i] = 1 / value_t(m[i][i]);
+			r[3][i] = -m[3][i] / value_t(m[i][i]);
+		}
+		return r;
+	}
+
 	template <typename T>
 	inline auto rotate3x(const T &x) {
 		using value_t = detail::fpromote_t<T>;
@@ -5553,6 +6171,53 @@ namespace cgra {
 		return basic_mat<value_t, 4, 4>{basic_quat<value_t>{q}};
 	}
 
+	namespace detail {
+
+		// Shepperd's method: divide by whichever of w, x, y, z is largest, chosen with selects
+		// rather than branches so loops over many matrices vectorize
+		// reads the upper 3x3 of m
+		template <typename MatT>
+		inline auto quat_from_rotation(const MatT &m) {
+			using value_t = fpromote_t<matrix_value_t<MatT>>;
+			const value_t r00 = m[0][0], r11 = m[1][1], r22 = m[2][2];
+			const value_t tr = r00 + r11 + r22;
+			const bool cw = tr >= r00 && tr >= r11 && tr >= r22;
+			const bool cx = !cw && r00 >= r11 && r00 >= r22;
+			const bool cy = !cw && !cx && r11 >= r22;
+			const value_t sx = cx ? value_t(1) : value_t(-1);
+			const value_t sy = cy ? value_t(1) : value_t(-1);
+			const value_t sz = !cw && !cx && !cy ? value_t(1) : value_t(-1);
+			const value_t d = cw ? value_t(1) + tr : value_t(1) + sx * r00 + sy * r11 + sz * r22;
+			const value_t r = value_t(0.5) * sqrt(d);
+			const value_t s = value_t(0.25) / r;
+			// off-diagonal sums and differences, already scaled
+			const value_t dx = (m[1][2] - m[2][1]) * s, dy = (m[2][0] - m[0][2]) * s, dz = (m[0][1] - m[1][0]) * s;
+			const value_t pxy = (m[1][0] + m[0][1]) * s, pxz = (m[2][0] + m[0][2]) * s, pyz = (m[2][1] + m[1][2]) * s;
+			value_t qw = cw ? r : cx ? dx : cy ? dy : dz;
+			value_t qx = cw ? dx : cx ? r : cy ? pxy : pxz;
+			value_t qy = cw ? dy : cx ? pxy : cy ? r : pyz;
+			value_t qz = cw ? dz : cx ? pxz : cy ? pyz : r;
+			// canonical hemisphere
+			const value_t f = qw < value_t(0) ? value_t(-1) : value_t(1);
+			return basic_quat<value_t>{qw * f, qx * f, qy * f, qz * f};
+		}
+
+	}
+
+	// rotation matrix to unit quaternion, the inverse of rotate3
+	// stable for every rotation; the result has w >= 0
+	// the matrix should be orthonormal, use decompose_trs for matrices with scale
+	template <typename T>
+	inline auto quat_from_matrix(const basic_mat<T, 3, 3> &m) {
+		return detail::quat_from_rotation(m);
+	}
+
+	// quaternion for the upper 3x3 of m
+	template <typename T>
+	inline auto quat_from_matrix(const basic_mat<T, 4, 4> &m) {
+		return detail::quat_from_rotation(m);
+	}
+
 	template <typename Tx, typename Ty, typename Tz>
 	inline auto scale3(const Tx &x, const Ty &y, const Tz &z) {
 		using value_t = detail::fpromote_arith_t<Tx, Ty, Tz>;
@@ -5634,8 +6299,19 @@ namespace cgra {
 		return basic_quat<value_t>{cos(x / value_t(2)), sin(x / value_t(2)) * normalize(cross(from, to))};
 	}
 
+}
+
+#endif // CGRA_MATH_TRANSFORM_HPP
+
+
 
 
+#if defined(CGRA_MATH_WANT_RANDOM_) && !defined(CGRA_MATH_RANDOM_HPP)
+#define CGRA_MATH_RANDOM_HPP
+
+#include <random>
+
+namespace cgra {
 
 	//  .______          ___      .__   __.  _______   ______   .___  ___.  //
 	//  |   _  \        /   \     |  \ |  | |       \ /  __  \  |   \/   |  //
@@ -5858,7 +6534,8 @@ namespace cgra {
 			// TODO make this true uniformally random
 			const auto x = m_elem_dist(g, typename elem_dist_type::param_type(param.a(), param.b()));
 			const auto ax = normalize(m_vec_dist(g, typename vec_dist_type::param_type(basic_vec<T, 3>(-1), basic_vec<T, 3>(1))));
-			r = axisangle(normalize(ax), x);
+			// axisangle(ax, x), spelled out so the random section does not need the transforms
+			r = result_type{cos(x / T(2)), sin(x / T(2)) * ax};
 			return r;
 		}
 
@@ -5944,9 +6621,16 @@ namespace cgra {
 
 }
 
+#endif // CGRA_MATH_RANDOM_HPP
+
 
 
 
+#if defined(CGRA_MATH_WANT_HASH_) && !defined(CGRA_MATH_HASH_HPP)
+#define CGRA_MATH_HASH_HPP
+
+#include <functional>
+
 //   __    __       ___           _______. __    __   __  .__   __.   _______   //
 //  |  |  |  |     /   \         /       ||  |  |  | |  | |  \ |  |  /  _____|  //
 //  |  |__|  |    /  ^  \       |   (----`|  |__|  | |  | |   \|  | |  |  __    //
@@ -5993,7 +6677,584 @@ namespace std {
 	};
 }
 
+#endif // CGRA_MATH_HASH_HPP
+
+
+
+
+#if defined(CGRA_MATH_WANT_IO_) && !defined(CGRA_MATH_IO_HPP)
+#define CGRA_MATH_IO_HPP
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// locale-free from_chars/to_chars need C++17 <charconv> with floating point support
+#if !defined(CGRA_HAVE_CHARCONV) && !defined(CGRA_NO_CHARCONV) && defined(__has_include)
+#if __has_include(<charconv>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <charconv>
+#if defined(__cpp_lib_to_chars)
+#define CGRA_HAVE_CHARCONV
+#endif
+#endif
+#endif
+
+#ifdef CGRA_HAVE_CHARCONV
+#include <charconv>
+#include <system_error>
+#endif
+
+//   __    ______   //
+//  |  |  /  __  \  //
+//  |  | |  |  |  | //
+//  |  | |  |  |  | //
+//  |  | |  `--'  | //
+//  |__|  \______/  //
+//                  //
+//==================//
+
+namespace cgra {
+
+#ifdef CGRA_HAVE_CHARCONV
+	namespace detail {
+
+		// cursor for from_chars; the first error sticks
+		struct chars_reader {
+			const char *first;
+			const char *p;
+			const char *last;
+			std::errc ec{};
+
+			void skip_ws() {
+				while (p < last && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+			}
+
+			void expect(char c) {
+				if (ec != std::errc{}) return;
+				skip_ws();
+				if (p < last && *p == c) {
+					++p;
+				} else {
+					ec = std::errc::invalid_argument;
+				}
+			}
+
+			template <typename T>
+			void value(T &x) {
+				if (ec != std::errc{}) return;
+				skip_ws();
+				const auto r = scalar(x);
+				if (r.ec == std::errc{}) {
+					p = r.ptr;
+				} else {
+					ec = r.ec;
+				}
+			}
+
+			template <typename T>
+			std::from_chars_result scalar(T &x) {
+				static_assert(std::is_arithmetic<T>::value, "from_chars requires arithmetic elements");
+				return std::from_chars(p, last, x);
+			}
+
+			std::from_chars_result scalar(bool &x) {
+				unsigned u = 0;
+				const auto r = std::from_chars(p, last, u);
+				if (r.ec == std::errc{} && u > 1) return {p, std::errc::invalid_argument};
+				x = u != 0;
+				return r;
+			}
+
+			// like std::from_chars, ptr is first on error
+			std::from_chars_result result() const {
+				return {ec == std::errc{} ? p : first, ec};
+			}
+		};
+
+		// cursor for to_chars; precision < 0 means shortest round-trip
+		struct chars_writer {
+			char *p;
+			char *last;
+			int precision = -1;
+			bool compact = false;
+			bool ok = true;
+
+			void put(char c) {
+				if (!ok) return;
+				if (p < last) {
+					*p++ = c;
+				} else {
+					ok = false;
+				}
+			}
+
+			void put(const char *str) {
+				while (*str) put(*str++);
+			}
+
+			void pad(size_t n) {
+				for (; n > 0; --n) put(' ');
+			}
+
+			template <typename T>
+			void value(const T &x) {
+				if (!ok) return;
+				const auto r = scalar(x);
+				if (r.ec == std::errc{}) {
+					p = r.ptr;
+				} else {
+					ok = false;
+				}
+			}
+
+			template <typename T>
+			std::to_chars_result scalar(const T &x, std::enable_if_t<std::is_floating_point<T>::value, int> = 0) {
+				return precision < 0 ? std::to_chars(p, last, x) : std::to_chars(p, last, x, std::chars_format::general, precision);
+			}
+
+			template <typename T>
+			std::to_chars_result scalar(const T &x, std::enable_if_t<std::is_integral<T>::value, int> = 0) {
+				return std::to_chars(p, last, x);
+			}
+
+			std::to_chars_result scalar(const bool &x) {
+				return std::to_chars(p, last, int(x));
+			}
+
+			std::to_chars_result result() const {
+				return ok ? std::to_chars_result{p, std::errc{}} : std::to_chars_result{last, std::errc::value_too_large};
+			}
+		};
+
+		// width of x as written by chars_writer w
+		template <typename T>
+		inline size_t chars_width(const chars_writer &w, const T &x) {
+			char buf[64];
+			chars_writer t{buf, buf + sizeof(buf), w.precision};
+			t.value(x);
+			return size_t(t.p - buf);
+		}
+
+		template <typename T, size_t N>
+		inline void write_chars(chars_writer &w, const basic_vec<T, N> &v) {
+			w.put('(');
+			for (size_t i = 0; i < N; ++i) {
+				if (i > 0) w.put(", ");
+				w.value(v[i]);
+			}
+			w.put(')');
+		}
+
+		template <typename T, size_t Cols, size_t Rows>
+		inline void write_chars(chars_writer &w, const basic_mat<T, Cols, Rows> &m) {
+			if (w.compact) {
+				w.put('[');
+				for (size_t i = 0; i < Rows; ++i) {
+					if (i > 0) w.put("; ");
+					for (size_t j = 0; j < Cols; ++j) {
+						if (j > 0) w.put(", ");
+						w.value(m[j][i]);
+					}
+				}
+				w.put(']');
+				return;
+			}
+			// measure each element once, then pad each column to its widest
+			size_t widths[Cols > 0 ? Cols : 1] = {};
+			size_t elem_w[Cols * Rows > 0 ? Cols * Rows : 1];
+			for (size_t j = 0; j < Cols; ++j) {
+				for (size_t i = 0; i < Rows; ++i) {
+					elem_w[j * Rows + i] = chars_width(w, m[j][i]);
+					widths[j] = std::max(widths[j], elem_w[j * Rows + i]);
+				}
+			}
+			for (size_t i = 0; i < Rows; ++i) {
+				w.put(Rows == 1 ? "[ " : i == 0 ? "/ " : i + 1 == Rows ? "\\ " : "| ");
+				for (size_t j = 0; j < Cols; ++j) {
+					w.pad(widths[j] - elem_w[j * Rows + i]);
+					w.value(m[j][i]);
+					if (j + 1 < Cols) w.put(", ");
+				}
+				w.put(Rows == 1 ? " ]" : i == 0 ? " \\" : i + 1 == Rows ? " /" : " |");
+				if (i + 1 < Rows) w.put('\n');
+			}
+		}
+
+		template <typename T>
+		inline void write_chars(chars_writer &w, const basic_quat<T> &q) {
+			w.put('(');
+			w.value(q.w);
+			w.put(" + ");
+			w.value(q.x);
+			w.put("i + ");
+			w.value(q.y);
+			w.put("j + ");
+			w.value(q.z);
+			w.put("k)");
+		}
+
+		// does out format T exactly like chars_writer with its precision?
+		// (ie default flags, fill, width and locale; chars print as characters, so they are excluded)
+		template <typename T>
+		inline bool io_plain_stream(std::ostream &out) {
+			constexpr bool plain_t = std::is_floating_point<T>::value || std::is_same<T, bool>::value || (
+				std::is_integral<T>::value && sizeof(T) > 1 && !std::is_same<T, wchar_t>::value
+				&& !std::is_same<T, char16_t>::value && !std::is_same<T, char32_t>::value
+			);
+			return plain_t
+				&& (out.flags() & ~(std::ios::skipws | std::ios::unitbuf)) == std::ios::dec
+				&& out.width() == 0 && out.fill() == ' '
+				&& out.precision() >= 0 && out.precision() <= 17
+				&& out.getloc() == std::locale::classic();
+		}
+
+	}
+#endif // CGRA_HAVE_CHARCONV
+
+	namespace detail {
+
+		// ios_base::iword slot for the compact matrix format flag
+		inline int io_compact_index() {
+			static const int i = std::ios_base::xalloc();
+			return i;
+		}
+
+		inline bool io_compact(std::ios_base &s) {
+			return s.iword(io_compact_index()) != 0;
+		}
+
+	}
+
+	// stream manipulator: write matrices on a single line, rows separated by ';', eg [1, 0; 0, 1]
+	inline std::ios_base & compact(std::ios_base &s) {
+		s.iword(detail::io_compact_index()) = 1;
+		return s;
+	}
+
+	// stream manipulator: write matrices over multiple lines with aligned columns (the default)
+	inline std::ios_base & nocompact(std::ios_base &s) {
+		s.iword(detail::io_compact_index()) = 0;
+		return s;
+	}
+
+	namespace detail {
+
+		// skip whitespace and consume c, or set failbit
+		inline std::istream & io_expect(std::istream &in, char c) {
+			if (!(in >> std::ws)) return in;
+			if (in.peek() == std::char_traits<char>::to_int_type(c)) {
+				in.get();
+			} else {
+				in.setstate(std::ios::failbit);
+			}
+			return in;
+		}
+
+		namespace scalars {
+
+
+			template <typename T>
+			inline std::ostream & operator<<(std::ostream &out, const basic_quat<T> &v) {
+				return out << '(' << v.w << " + " << v.x << "i + " << v.y << "j + " << v.z << "k)";
+			}
+
+			// reads the format written by operator<<, ie (w + xi + yj + zk)
+			// q is only modified on success
+			template <typename T>
+			inline std::istream & operator>>(std::istream &in, basic_quat<T> &q) {
+				basic_quat<T> r;
+				io_expect(in, '(') >> r.w;
+				io_expect(in, '+') >> r.x;
+				io_expect(io_expect(in, 'i'), '+') >> r.y;
+				io_expect(io_expect(in, 'j'), '+') >> r.z;
+				io_expect(io_expect(in, 'k'), ')');
+				if (in) q = r;
+				return in;
+			}
+
+		}
+
+		namespace vectors {
+
+			template <typename T, size_t N>
+			inline std::ostream & operator<<(std::ostream &out, const repeat_vec<T, N> &v) {
+				return out << '(' << v[0] << ", ... , n=" << N << ")";
+			}
+
+			namespace functions {
+
+
+				template <typename T, size_t N>
+				inline std::ostream & operator<<(std::ostream &out, const basic_vec<T, N> &v) {
+					out << '(';
+					if (N > 0) out << v[0];
+					for (size_t i = 1; i < N; ++i) {
+						out << ", " << v[i];
+					}
+					out << ')';
+					return out;
+				}
+
+				// reads the format written by operator<<, ie (x, y, ...)
+				// v is only modified on success
+				template <typename T, size_t N>
+				inline std::istream & operator>>(std::istream &in, basic_vec<T, N> &v) {
+					basic_vec<T, N> r;
+					detail::io_expect(in, '(');
+					for (size_t i = 0; i < N && in; ++i) {
+						if (i > 0) detail::io_expect(in, ',');
+						in >> r[i];
+					}
+					detail::io_expect(in, ')');
+					if (in) v = r;
+					return in;
+				}
+
+			}
+		}
+
+		namespace matrices {
+			namespace functions {
+
+
+				template <typename T, size_t Cols, size_t Rows>
+				inline std::ostream & operator<<(std::ostream &out, const basic_mat<T, Cols, Rows> &m) {
+#ifdef CGRA_HAVE_CHARCONV
+					// format into a stack buffer and write once, if that gives the same result
+					if (detail::io_plain_stream<T>(out)) {
+						char buf[Cols * Rows * 36 + Rows * 8 + 2];
+						detail::chars_writer w{buf, buf + sizeof(buf), int(out.precision()), detail::io_compact(out)};
+						detail::write_chars(w, m);
+						if (w.ok) return out.write(buf, w.p - buf);
+					}
+#endif
+					if (detail::io_compact(out)) {
+						out << '[';
+						for (size_t i = 0; i < Rows; ++i) {
+							if (i > 0) out << "; ";
+							for (size_t j = 0; j < Cols; ++j) {
+								if (j > 0) out << ", ";
+								out << m[j][i];
+							}
+						}
+						return out << ']';
+					}
+					static const char *toplinestart = Rows > 1 ? "/ " : "[ ";
+					static const char *toplineend = Rows > 1 ? " \\" : " ]";
+					static const char *midlinestart = "| ";
+					static const char *midlineend = " |";
+					static const char *bottomlinestart = Rows > 1 ? "\\ " : "[ ";
+					static const char *bottomlineend = Rows > 1 ? " /" : " ]";
+					// calculate column widths
+					size_t maxwidths[Cols];
+					std::ostringstream tempss;
+					tempss.precision(out.precision());
+					for (size_t i = 0; i < Cols; ++i) {
+						maxwidths[i] = 0;
+						for (size_t j = 0; j < Rows; ++j) {
+							// msvc: seeking to 0 on empty stream sets failbit
+							tempss.seekp(0);
+							tempss.clear();
+							tempss << m[i][j];
+							maxwidths[i] = size_t(tempss.tellp()) > maxwidths[i] ? size_t(tempss.tellp()) : maxwidths[i];
+						}
+					}
+					// print
+					for (size_t i = 0; i < Rows; ++i) {
+						if (i == 0) {
+							out << toplinestart;
+						} else if (i + 1 == Rows) {
+							out << bottomlinestart;
+						} else {
+							out << midlinestart;
+						}
+						for (size_t j = 0; j < Cols; ++j) {
+							out.width(maxwidths[j]);
+							out << m[j][i];
+							if (j + 1 < Cols) out << ", ";
+						}
+						if (i == 0) {
+							out << toplineend;
+						} else if (i + 1 == Rows) {
+							out << bottomlineend;
+						} else {
+							out << midlineend;
+						}
+						if (i + 1 < Rows) out << '\n';
+					}
+					return out;
+				}
+
+				// reads the format written by operator<< (row by row, between brackets), compact or not
+				// column padding and line breaks are not significant; m is only modified on success
+				template <typename T, size_t Cols, size_t Rows>
+				inline std::istream & operator>>(std::istream &in, basic_mat<T, Cols, Rows> &m) {
+					basic_mat<T, Cols, Rows> r;
+					if (Rows > 1 && (in >> std::ws) && in.peek() == '[') {
+						detail::io_expect(in, '[');
+						for (size_t i = 0; i < Rows && in; ++i) {
+							if (i > 0) detail::io_expect(in, ';');
+							for (size_t j = 0; j < Cols && in; ++j) {
+								if (j > 0) detail::io_expect(in, ',');
+								in >> r[j][i];
+							}
+						}
+						detail::io_expect(in, ']');
+						if (in) m = r;
+						return in;
+					}
+					for (size_t i = 0; i < Rows && in; ++i) {
+						detail::io_expect(in, Rows == 1 ? '[' : i == 0 ? '/' : i + 1 == Rows ? '\\' : '|');
+						for (size_t j = 0; j < Cols && in; ++j) {
+							if (j > 0) detail::io_expect(in, ',');
+							in >> r[j][i];
+						}
+						detail::io_expect(in, Rows == 1 ? ']' : i == 0 ? '\\' : i + 1 == Rows ? '/' : '|');
+					}
+					if (in) m = r;
+					return in;
+				}
+
+			}
+		}
+	}
+}
+
+#ifdef CGRA_HAVE_CHARCONV
+
+namespace cgra {
+
+	// locale-free parsing of the format written by operator<<, built on std::from_chars
+	// like std::from_chars, leading whitespace is not skipped and the value is only modified on success
+	template <typename T, size_t N>
+	inline std::from_chars_result from_chars(const char *first, const char *last, basic_vec<T, N> &v) {
+		detail::chars_reader r{first, first, last};
+		basic_vec<T, N> t;
+		r.expect('(');
+		for (size_t i = 0; i < N; ++i) {
+			if (i > 0) r.expect(',');
+			r.value(t[i]);
+		}
+		r.expect(')');
+		if (r.ec == std::errc{}) v = t;
+		return r.result();
+	}
+
+	template <typename T, size_t Cols, size_t Rows>
+	inline std::from_chars_result from_chars(const char *first, const char *last, basic_mat<T, Cols, Rows> &m) {
+		detail::chars_reader r{first, first, last};
+		basic_mat<T, Cols, Rows> t;
+		if (Rows > 1 && first < last && *first == '[') {
+			// compact
+			r.expect('[');
+			for (size_t i = 0; i < Rows; ++i) {
+				if (i > 0) r.expect(';');
+				for (size_t j = 0; j < Cols; ++j) {
+					if (j > 0) r.expect(',');
+					r.value(t[j][i]);
+				}
+			}
+			r.expect(']');
+			if (r.ec == std::errc{}) m = t;
+			return r.result();
+		}
+		for (size_t i = 0; i < Rows; ++i) {
+			r.expect(Rows == 1 ? '[' : i == 0 ? '/' : i + 1 == Rows ? '\\' : '|');
+			for (size_t j = 0; j < Cols; ++j) {
+				if (j > 0) r.expect(',');
+				r.value(t[j][i]);
+			}
+			r.expect(Rows == 1 ? ']' : i == 0 ? '\\' : i + 1 == Rows ? '/' : '|');
+		}
+		if (r.ec == std::errc{}) m = t;
+		return r.result();
+	}
+
+	template <typename T>
+	inline std::from_chars_result from_chars(const char *first, const char *last, basic_quat<T> &q) {
+		detail::chars_reader r{first, first, last};
+		basic_quat<T> t;
+		r.expect('(');
+		r.value(t.w);
+		r.expect('+');
+		r.value(t.x);
+		r.expect('i');
+		r.expect('+');
+		r.value(t.y);
+		r.expect('j');
+		r.expect('+');
+		r.value(t.z);
+		r.expect('k');
+		r.expect(')');
+		if (r.ec == std::errc{}) q = t;
+		return r.result();
+	}
+
+	// locale-free formatting in the layout of operator<<, built on std::to_chars
+	// values are written in shortest round-trip form, so from_chars recovers them exactly
+	template <typename T, size_t N>
+	inline std::to_chars_result to_chars(char *first, char *last, const basic_vec<T, N> &v) {
+		detail::chars_writer w{first, last};
+		detail::write_chars(w, v);
+		return w.result();
+	}
+
+	template <typename T, size_t Cols, size_t Rows>
+	inline std::to_chars_result to_chars(char *first, char *last, const basic_mat<T, Cols, Rows> &m) {
+		detail::chars_writer w{first, last};
+		detail::write_chars(w, m);
+		return w.result();
+	}
+
+	template <typename T>
+	inline std::to_chars_result to_chars(char *first, char *last, const basic_quat<T> &q) {
+		detail::chars_writer w{first, last};
+		detail::write_chars(w, q);
+		return w.result();
+	}
+
+}
+
+#endif // CGRA_HAVE_CHARCONV
+
+#endif // CGRA_MATH_IO_HPP
+
+
+
+
+#if defined(CGRA_MATH_WANT_COMPLEX_) && !defined(CGRA_MATH_COMPLEX_HPP)
+#define CGRA_MATH_COMPLEX_HPP
+
+#include <complex>
+
+namespace cgra {
+	namespace detail {
+
+		template <typename T>
+		struct scalar_traits<std::complex<T>, void> {
+			using fpromote_t = std::complex<detail::fpromote_t<T>>;
+			static constexpr bool is_scalar = true;
+			static constexpr bool want_real_fns = false;
+			static constexpr bool want_trig_fns = true;
+			static constexpr bool want_exp_fns = true;
+			static constexpr bool want_linear_fns = true;
+			static constexpr bool want_bool_fns = false;
+		};
+	}
+}
+
+#endif // CGRA_MATH_COMPLEX_HPP
+
+
 
 #undef CGRA_DEFINE_MAGIC_CTOR
 #undef CGRA_DEFINE_DEFAULT_CTOR
 
+#undef CGRA_MATH_SELECT_ALL_
+#undef CGRA_MATH_WANT_MAT_
+#undef CGRA_MATH_WANT_QUAT_
+#undef CGRA_MATH_WANT_TRANSFORM_
+#undef CGRA_MATH_WANT_RANDOM_
+#undef CGRA_MATH_WANT_HASH_
+#undef CGRA_MATH_WANT_IO_
+#undef CGRA_MATH_WANT_COMPLEX_
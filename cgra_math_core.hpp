@@ -0,0 +1,14 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Core
+//
+// Vec, mat and quat types with their operators and component-wise functions,
+// without the iostream, random and complex dependencies of the full header.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#define CGRA_MATH_SELECT_CORE
+#include "cgra_math.hpp"
+#undef CGRA_MATH_SELECT_CORE
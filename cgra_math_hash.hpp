@@ -0,0 +1,13 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Hash
+//
+// Core plus the std::hash specialisations.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#define CGRA_MATH_SELECT_HASH
+#include "cgra_math.hpp"
+#undef CGRA_MATH_SELECT_HASH
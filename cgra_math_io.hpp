@@ -0,0 +1,13 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Stream IO
+//
+// Core plus the std::ostream operators (includes <iostream>).
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#define CGRA_MATH_SELECT_IO
+#include "cgra_math.hpp"
+#undef CGRA_MATH_SELECT_IO
@@ -0,0 +1,13 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Matrix Functions
+//
+// Core plus determinant, inverse, transpose and the other matrix functions.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#define CGRA_MATH_SELECT_MAT
+#include "cgra_math.hpp"
+#undef CGRA_MATH_SELECT_MAT
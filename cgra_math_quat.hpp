@@ -0,0 +1,14 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Quaternion Functions
+//
+// Core and matrix functions plus slerp, axis-angle and the other quaternion
+// functions.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#define CGRA_MATH_SELECT_QUAT
+#include "cgra_math.hpp"
+#undef CGRA_MATH_SELECT_QUAT
@@ -0,0 +1,13 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Random
+//
+// Core plus the random value distributions (includes <random>).
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#define CGRA_MATH_SELECT_RANDOM
+#include "cgra_math.hpp"
+#undef CGRA_MATH_SELECT_RANDOM
@@ -0,0 +1,14 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Transformations
+//
+// Core, matrix and quaternion functions plus rotate, lookat, perspective and
+// the other transformation matrices.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#define CGRA_MATH_SELECT_TRANSFORM
+#include "cgra_math.hpp"
+#undef CGRA_MATH_SELECT_TRANSFORM
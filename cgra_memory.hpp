@@ -0,0 +1,443 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Memory
+//
+// Aligned allocation, over-aligned vector and matrix types, aligned
+// container aliases for SIMD-friendly storage and arenas for transient
+// per-frame buffers.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cgra_math.hpp"
+#include "cgra_parallel.hpp"
+
+// largest alignment chosen by default for the aligned types (AVX register width)
+#ifndef CGRA_SIMD_ALIGNMENT
+#define CGRA_SIMD_ALIGNMENT 32
+#endif
+
+namespace cgra {
+
+	namespace detail {
+
+		constexpr size_t next_pow2(size_t x, size_t p = 1) {
+			return p >= x ? p : next_pow2(x, p * 2);
+		}
+
+		constexpr size_t simd_alignment_for(size_t size, size_t natural) {
+			return next_pow2(size) < size_t(CGRA_SIMD_ALIGNMENT)
+				? (next_pow2(size) < natural ? natural : next_pow2(size))
+				: (size_t(CGRA_SIMD_ALIGNMENT) < natural ? natural : size_t(CGRA_SIMD_ALIGNMENT));
+		}
+
+		// default alignment for an over-aligned T: the next power of 2 of its size,
+		// capped at CGRA_SIMD_ALIGNMENT but never less than its natural alignment
+		template <typename T>
+		struct simd_alignment : index_constant<simd_alignment_for(sizeof(T), alignof(T))> {};
+
+		// the buffer alignment used by aligned containers of T
+		template <typename T>
+		struct buffer_alignment : index_constant<
+			(alignof(T) > size_t(CGRA_SIMD_ALIGNMENT)) ? alignof(T) : size_t(CGRA_SIMD_ALIGNMENT)
+		> {};
+
+		// allocate/free size bytes aligned to align (a power of 2)
+		// throws std::bad_alloc on failure
+		inline void * aligned_malloc(size_t size, size_t align) {
+			// the start of the block is stored just before the result,
+			// so the result must be aligned well enough to hold a pointer
+			if (align < alignof(void *)) align = alignof(void *);
+			if (size > std::numeric_limits<size_t>::max() - align - sizeof(void *)) throw std::bad_alloc();
+			void *base = std::malloc(size + align + sizeof(void *));
+			if (!base) throw std::bad_alloc();
+			const uintptr_t p = (reinterpret_cast<uintptr_t>(base) + sizeof(void *) + align - 1) & ~uintptr_t(align - 1);
+			reinterpret_cast<void **>(p)[-1] = base;
+			return reinterpret_cast<void *>(p);
+		}
+
+		inline void aligned_free(void *p) {
+			if (p) std::free(reinterpret_cast<void **>(p)[-1]);
+		}
+
+	}
+
+	// standard allocator returning storage aligned to Align bytes
+	// use with std containers, eg std::vector<vec4, aligned_allocator<vec4, 32>>
+	template <typename T, size_t Align = detail::buffer_alignment<T>::value>
+	class aligned_allocator {
+	public:
+		static_assert((Align & (Align - 1)) == 0, "alignment must be a power of 2");
+		static_assert(Align >= alignof(T), "alignment must be at least that of T");
+
+		using value_type = T;
+		using size_type = size_t;
+		using difference_type = std::ptrdiff_t;
+		using propagate_on_container_move_assignment = std::true_type;
+		using is_always_equal = std::true_type;
+
+		static constexpr size_t alignment = Align;
+
+		template <typename U>
+		struct rebind {
+			using other = aligned_allocator<U, (Align > alignof(U) ? Align : alignof(U))>;
+		};
+
+		aligned_allocator() noexcept { }
+
+		template <typename U, size_t UAlign>
+		aligned_allocator(const aligned_allocator<U, UAlign> &) noexcept { }
+
+		T * allocate(size_t n) {
+			if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_alloc();
+			return static_cast<T *>(detail::aligned_malloc(n * sizeof(T), Align));
+		}
+
+		void deallocate(T *p, size_t) noexcept {
+			detail::aligned_free(p);
+		}
+
+		template <typename U, size_t UAlign>
+		bool operator==(const aligned_allocator<U, UAlign> &) const noexcept { return true; }
+
+		template <typename U, size_t UAlign>
+		bool operator!=(const aligned_allocator<U, UAlign> &) const noexcept { return false; }
+	};
+
+	template <typename T, size_t Align>
+	constexpr size_t aligned_allocator<T, Align>::alignment;
+
+	namespace detail {
+		namespace vectors {
+
+			// over-aligned N-vector of type T
+			// behaves as a basic_vec<T, N> (and converts implicitly to and from one),
+			// but is aligned to Align bytes and padded to a multiple of it
+			// eg basic_vec_aligned<float, 3> is 16 bytes and 16-byte aligned
+			template <typename T, size_t N, size_t Align = simd_alignment<basic_vec<T, N>>::value>
+			class alignas(Align) basic_vec_aligned : public basic_vec<T, N> {
+			public:
+				using base_t = basic_vec<T, N>;
+				static constexpr size_t alignment = Align;
+
+				// the default ctor and conversion from the base are not inherited
+				CGRA_CONSTEXPR_FUNCTION basic_vec_aligned() : base_t{} { }
+
+				CGRA_CONSTEXPR_FUNCTION basic_vec_aligned(const base_t &v) : base_t(v) { }
+
+				using base_t::base_t;
+
+				CGRA_CONSTEXPR_FUNCTION base_t & as_unaligned() { return *this; }
+
+				CGRA_CONSTEXPR_FUNCTION const base_t & as_unaligned() const { return *this; }
+			};
+
+		}
+
+		namespace matrices {
+
+			// over-aligned Cols x Rows matrix of type T
+			// behaves as a basic_mat<T, Cols, Rows> (and converts implicitly to and from one),
+			// but is aligned to Align bytes and padded to a multiple of it
+			template <typename T, size_t Cols, size_t Rows, size_t Align = simd_alignment<basic_mat<T, Cols, Rows>>::value>
+			class alignas(Align) basic_mat_aligned : public basic_mat<T, Cols, Rows> {
+			public:
+				using base_t = basic_mat<T, Cols, Rows>;
+				static constexpr size_t alignment = Align;
+
+				CGRA_CONSTEXPR_FUNCTION basic_mat_aligned() : base_t{} { }
+
+				CGRA_CONSTEXPR_FUNCTION basic_mat_aligned(const base_t &m) : base_t(m) { }
+
+				using base_t::base_t;
+
+				CGRA_CONSTEXPR_FUNCTION base_t & as_unaligned() { return *this; }
+
+				CGRA_CONSTEXPR_FUNCTION const base_t & as_unaligned() const { return *this; }
+			};
+
+		}
+
+		// the aligned types are arrays exactly like their bases,
+		// so operators and functions accept them and return the unaligned types
+		template <typename T, size_t N, size_t Align>
+		struct array_traits<vectors::basic_vec_aligned<T, N, Align>, void> : array_traits<basic_vec<T, N>> {};
+
+		template <typename T, size_t Cols, size_t Rows, size_t Align>
+		struct array_traits<matrices::basic_mat_aligned<T, Cols, Rows, Align>, void> : array_traits<basic_mat<T, Cols, Rows>> {};
+
+	}
+
+	using detail::vectors::basic_vec_aligned;
+	using detail::matrices::basic_mat_aligned;
+
+	// std::vector with storage aligned for SIMD loads
+	// elements are only individually aligned if T is (eg basic_vec_aligned)
+	template <typename T, size_t Align = detail::buffer_alignment<T>::value>
+	using aligned_vector = std::vector<T, aligned_allocator<T, Align>>;
+
+	template <typename T, size_t N>
+	using aligned_vec_vector = aligned_vector<basic_vec_aligned<T, N>>;
+
+	template <typename T, size_t Cols, size_t Rows = Cols>
+	using aligned_mat_vector = aligned_vector<basic_mat_aligned<T, Cols, Rows>>;
+
+	// GLSL-style aliases
+	using vec2a = basic_vec_aligned<float, 2>;
+	using vec3a = basic_vec_aligned<float, 3>;
+	using vec4a = basic_vec_aligned<float, 4>;
+	using dvec2a = basic_vec_aligned<double, 2>;
+	using dvec3a = basic_vec_aligned<double, 3>;
+	using dvec4a = basic_vec_aligned<double, 4>;
+	using ivec2a = basic_vec_aligned<int, 2>;
+	using ivec3a = basic_vec_aligned<int, 3>;
+	using ivec4a = basic_vec_aligned<int, 4>;
+	using mat3a = basic_mat_aligned<float, 3, 3>;
+	using mat4a = basic_mat_aligned<float, 4, 4>;
+	using dmat3a = basic_mat_aligned<double, 3, 3>;
+	using dmat4a = basic_mat_aligned<double, 4, 4>;
+
+
+	namespace detail {
+
+		struct aligned_deleter {
+			void operator()(void *p) const { aligned_free(p); }
+		};
+
+		// arrays are trivially destructible if their elements are,
+		// even though basic_vec_data declares a destructor
+		template <typename T, bool IsArray = array_traits<T>::is_array>
+		struct is_trivially_destructible_elements : std::is_trivially_destructible<T> {};
+
+		template <typename T>
+		struct is_trivially_destructible_elements<T, true> : is_trivially_destructible_elements<typename array_traits<T>::value_t> {};
+
+	}
+
+	// single-threaded bump allocator
+	// memory is taken from a list of blocks that are kept across reset(),
+	// so after warming up a steady workload allocates nothing from the system
+	// destructors are never run; only trivially destructible types (and arrays of them) can be allocated
+	class linear_arena {
+	private:
+		struct block {
+			std::unique_ptr<char, detail::aligned_deleter> data;
+			size_t size;
+		};
+
+		std::vector<block> m_blocks;
+		size_t m_block_size;
+		size_t m_block = 0;
+		size_t m_offset = 0;
+		size_t m_used = 0;
+
+		static constexpr size_t block_alignment = 64;
+
+		// move to a block with room for size bytes aligned to align, allocating one if needed
+		void next_block(size_t size, size_t align) {
+			const size_t need = size + align;
+			if (!m_blocks.empty()) m_block++;
+			if (m_block >= m_blocks.size() || m_blocks[m_block].size < need) {
+				const size_t bsize = std::max(m_block_size, need);
+				block b{std::unique_ptr<char, detail::aligned_deleter>(static_cast<char *>(detail::aligned_malloc(bsize, block_alignment))), bsize};
+				m_block = std::min(m_block, m_blocks.size());
+				m_blocks.insert(m_blocks.begin() + m_block, std::move(b));
+			}
+			m_offset = 0;
+		}
+
+	public:
+		explicit linear_arena(size_t block_size = size_t(1) << 20) : m_block_size(block_size) { }
+
+		linear_arena(linear_arena &&) = default;
+		linear_arena & operator=(linear_arena &&) = default;
+
+		// size bytes aligned to align (a power of 2)
+		// the memory is valid until the next reset()
+		void * allocate(size_t size, size_t align = CGRA_SIMD_ALIGNMENT) {
+			assert((align & (align - 1)) == 0 && "alignment must be a power of 2");
+			for (;;) {
+				if (m_block < m_blocks.size()) {
+					const block &b = m_blocks[m_block];
+					const uintptr_t base = reinterpret_cast<uintptr_t>(b.data.get());
+					const size_t start = ((base + m_offset + align - 1) & ~uintptr_t(align - 1)) - base;
+					if (start <= b.size && size <= b.size - start) {
+						m_used += start + size - m_offset;
+						m_offset = start + size;
+						return b.data.get() + start;
+					}
+				}
+				next_block(size, align);
+			}
+		}
+
+		// n default constructed T, aligned to at least CGRA_SIMD_ALIGNMENT
+		template <typename T>
+		span<T> alloc(size_t n) {
+			static_assert(detail::is_trivially_destructible_elements<T>::value, "arena memory is never destroyed");
+			if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_alloc();
+			T *p = static_cast<T *>(allocate(n * sizeof(T), std::max(alignof(T), size_t(CGRA_SIMD_ALIGNMENT))));
+			for (size_t i = 0; i < n; i++) new (p + i) T();
+			return span<T>(p, n);
+		}
+
+		// n copies of value, aligned to at least CGRA_SIMD_ALIGNMENT
+		template <typename T>
+		span<T> alloc(size_t n, const T &value) {
+			static_assert(detail::is_trivially_destructible_elements<T>::value, "arena memory is never destroyed");
+			if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_alloc();
+			T *p = static_cast<T *>(allocate(n * sizeof(T), std::max(alignof(T), size_t(CGRA_SIMD_ALIGNMENT))));
+			for (size_t i = 0; i < n; i++) new (p + i) T(value);
+			return span<T>(p, n);
+		}
+
+		// invalidate everything allocated; O(1), the blocks are kept
+		void reset() {
+			m_block = 0;
+			m_offset = 0;
+			m_used = 0;
+		}
+
+		// return all blocks to the system (also resets)
+		void release() {
+			m_blocks.clear();
+			reset();
+		}
+
+		// bytes handed out (including alignment padding) since the last reset
+		size_t bytes_used() const { return m_used; }
+
+		// bytes held in blocks
+		size_t capacity() const {
+			size_t c = 0;
+			for (const auto &b : m_blocks) c += b.size;
+			return c;
+		}
+	};
+
+	// per-frame arena: one linear_arena per thread, all invalidated together by reset()
+	// inside parallel_for(count, n, f), thread t should use local(t)
+	// reset() is O(1) regardless of the number of threads: it advances an epoch,
+	// and each sub-arena rewinds itself the next time it is used
+	// reset() must not run concurrently with allocation
+	class frame_arena {
+	private:
+		// padded to a cache line so threads don't share one
+		struct alignas(64) local_arena {
+			linear_arena arena;
+			size_t epoch = 0;
+
+			explicit local_arena(size_t block_size) : arena(block_size) { }
+		};
+
+		aligned_vector<local_arena> m_locals;
+		size_t m_epoch = 0;
+
+	public:
+		// threads = 0 means one sub-arena per hardware thread
+		explicit frame_arena(unsigned threads = 0, size_t block_size = size_t(1) << 20) {
+			threads = detail::resolve_thread_count(threads);
+			m_locals.reserve(threads);
+			for (unsigned t = 0; t < threads; t++) m_locals.emplace_back(block_size);
+		}
+
+		unsigned thread_count() const { return unsigned(m_locals.size()); }
+
+		// sub-arena for thread t
+		linear_arena & local(unsigned t) {
+			assert(t < m_locals.size());
+			local_arena &l = m_locals[t];
+			if (l.epoch != m_epoch) {
+				l.arena.reset();
+				l.epoch = m_epoch;
+			}
+			return l.arena;
+		}
+
+		// allocate from the sub-arena of thread 0 (ie, the calling thread of parallel_for)
+		void * allocate(size_t size, size_t align = CGRA_SIMD_ALIGNMENT) {
+			return local(0).allocate(size, align);
+		}
+
+		template <typename T>
+		span<T> alloc(size_t n) {
+			return local(0).alloc<T>(n);
+		}
+
+		template <typename T>
+		span<T> alloc(size_t n, const T &value) {
+			return local(0).alloc<T>(n, value);
+		}
+
+		// end of frame: invalidate everything allocated from all sub-arenas
+		void reset() {
+			m_epoch++;
+		}
+
+		// return all memory to the system (also resets)
+		void release() {
+			for (auto &l : m_locals) l.arena.release();
+			reset();
+		}
+
+		// bytes handed out this frame, over all sub-arenas
+		size_t bytes_used() const {
+			size_t u = 0;
+			for (const auto &l : m_locals) u += l.epoch == m_epoch ? l.arena.bytes_used() : 0;
+			return u;
+		}
+
+		size_t capacity() const {
+			size_t c = 0;
+			for (const auto &l : m_locals) c += l.arena.capacity();
+			return c;
+		}
+	};
+
+	// std allocator drawing from a linear_arena, for std containers of scratch data
+	// deallocation is a no-op; the memory is reclaimed when the arena is reset
+	template <typename T>
+	class arena_allocator {
+	private:
+		template <typename U> friend class arena_allocator;
+		linear_arena *m_arena;
+
+	public:
+		using value_type = T;
+
+		arena_allocator(linear_arena &arena_) noexcept : m_arena(&arena_) { }
+
+		template <typename U>
+		arena_allocator(const arena_allocator<U> &other) noexcept : m_arena(other.m_arena) { }
+
+		T * allocate(size_t n) {
+			if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_alloc();
+			return static_cast<T *>(m_arena->allocate(n * sizeof(T), std::max(alignof(T), size_t(CGRA_SIMD_ALIGNMENT))));
+		}
+
+		void deallocate(T *, size_t) noexcept { }
+
+		linear_arena & arena() const { return *m_arena; }
+
+		template <typename U>
+		bool operator==(const arena_allocator<U> &other) const noexcept { return m_arena == other.m_arena; }
+
+		template <typename U>
+		bool operator!=(const arena_allocator<U> &other) const noexcept { return m_arena != other.m_arena; }
+	};
+
+	template <typename T>
+	using arena_vector = std::vector<T, arena_allocator<T>>;
+
+}
@@ -0,0 +1,547 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Noise
+//
+// Gradient (Perlin) and simplex noise in 1 to 4 dimensions and cellular
+// (Worley) noise, with analytic gradients, fractal sums and batch
+// evaluation over structure-of-arrays coordinates.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+
+#include "cgra_math.hpp"
+#include "cgra_parallel.hpp"
+
+namespace cgra {
+
+	// permutation table that hashes integer lattice points for the noise functions
+	// differently seeded tables give independent noise fields
+	class noise_table {
+	private:
+		// doubled so that perm[h + c] never needs masking for h, c < 256
+		std::array<std::uint8_t, 512> m_perm;
+
+		void mirror() {
+			std::copy(m_perm.begin(), m_perm.begin() + 256, m_perm.begin() + 256);
+		}
+
+	public:
+		// Ken Perlin's reference permutation
+		noise_table() {
+			static const std::uint8_t reference[256] = {
+				151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
+				140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
+				247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
+				57, 177, 33, 88, 237, 149, 56, 87, 174, 20, 125, 136, 171, 168, 68, 175,
+				74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122,
+				60, 211, 133, 230, 220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54,
+				65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+				200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64,
+				52, 217, 226, 250, 124, 123, 5, 202, 38, 147, 118, 126, 255, 82, 85, 212,
+				207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213,
+				119, 248, 152, 2, 44, 154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9,
+				129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+				218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241,
+				81, 51, 145, 235, 249, 14, 239, 107, 49, 192, 214, 31, 181, 199, 106, 157,
+				184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93,
+				222, 114, 67, 29, 24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180
+			};
+			std::copy(reference, reference + 256, m_perm.begin());
+			mirror();
+		}
+
+		// shuffled with a fully specified engine (minstd_rand),
+		// so the same seed gives the same noise on every platform
+		explicit noise_table(std::uint32_t seed) {
+			std::iota(m_perm.begin(), m_perm.begin() + 256, 0);
+			std::minstd_rand re(seed);
+			for (unsigned i = 255; i > 0; --i) {
+				std::swap(m_perm[i], m_perm[re() % (i + 1)]);
+			}
+			mirror();
+		}
+
+		// a table seeded from cgra::random
+		static noise_table random() {
+			return noise_table(cgra::random<std::uint32_t>());
+		}
+
+		// the reference table, used by default
+		static const noise_table & standard() {
+			static const noise_table t;
+			return t;
+		}
+
+		unsigned perm(unsigned i) const {
+			assert(i < 512);
+			return m_perm[i];
+		}
+
+		// hash of an integer lattice point, in [0, 256)
+		template <size_t N>
+		unsigned hash(const int (&cell)[N]) const {
+			unsigned h = 0;
+			for (size_t k = 0; k < N; ++k) {
+				h = m_perm[h + (unsigned(cell[k]) & 255u)];
+			}
+			return h;
+		}
+	};
+
+	// noise value and its gradient
+	template <typename T, size_t N>
+	struct noise_sample {
+		T value;
+		basic_vec<T, N> gradient;
+	};
+
+	namespace detail {
+
+		// output scales that bring each noise to roughly [-1, 1] (measured maxima)
+		template <size_t N>
+		struct noise_scale {};
+
+		template <>
+		struct noise_scale<1> {
+			static constexpr double perlin = 2.0;
+			static constexpr double simplex = 70.0;
+		};
+
+		template <>
+		struct noise_scale<2> {
+			static constexpr double perlin = 1.0;
+			static constexpr double simplex = 70.0;
+		};
+
+		template <>
+		struct noise_scale<3> {
+			static constexpr double perlin = 1.0;
+			static constexpr double simplex = 76.0;
+		};
+
+		template <>
+		struct noise_scale<4> {
+			static constexpr double perlin = 0.87;
+			static constexpr double simplex = 62.0;
+		};
+
+		// floor for coordinates within int range; unlike std::floor this
+		// needs no SSE4.1 to inline, and it vectorizes
+		template <typename T>
+		inline int noise_floor(T x) {
+			const int i = int(x);
+			return i - int(x < T(i));
+		}
+
+		// quintic fade 6t^5 - 15t^4 + 10t^3 and its derivative
+		template <typename T>
+		inline T noise_fade(T t) {
+			return t * t * t * (t * (t * T(6) - T(15)) + T(10));
+		}
+
+		template <typename T>
+		inline T noise_dfade(T t) {
+			return T(30) * t * t * (t * (t - T(2)) + T(1));
+		}
+
+		// component k of the lattice gradient for hash h
+		// 1 and 2D use the diagonals (+-1, +-1), 3 and 4D the edges of the cube
+		// (one component 0, the rest +-1); branch-free so the batch loops vectorize
+		template <typename T, size_t N>
+		inline T noise_grad(unsigned h, size_t k) {
+			const T s = (h >> k) & 1u ? T(-1) : T(1);
+			return N >= 3 && (h >> N) % N == k ? T(0) : s;
+		}
+
+		template <typename T, size_t N, bool WantGrad>
+		inline T perlin_impl(const basic_vec<T, N> &p, const noise_table &tab, basic_vec<T, N> &grad) {
+			int cell[N];
+			T f[N], u[N], du[N];
+			for (size_t k = 0; k < N; ++k) {
+				cell[k] = noise_floor(p[k]);
+				f[k] = p[k] - T(cell[k]);
+				u[k] = noise_fade(f[k]);
+				du[k] = noise_dfade(f[k]);
+			}
+			T value = 0;
+			for (unsigned c = 0; c < (1u << N); ++c) {
+				int corner[N];
+				for (size_t k = 0; k < N; ++k) corner[k] = cell[k] + int((c >> k) & 1u);
+				const unsigned h = tab.hash(corner);
+				T d = 0, w = 1;
+				for (size_t k = 0; k < N; ++k) {
+					const bool o = (c >> k) & 1u;
+					d += noise_grad<T, N>(h, k) * (f[k] - T(o));
+					w *= o ? u[k] : T(1) - u[k];
+				}
+				value += w * d;
+				if (WantGrad) {
+					for (size_t k = 0; k < N; ++k) {
+						// d(w)/d(p_k) is w with the k factor replaced by its derivative
+						T dw = (c >> k) & 1u ? du[k] : -du[k];
+						for (size_t j = 0; j < N; ++j) {
+							if (j != k) dw *= (c >> j) & 1u ? u[j] : T(1) - u[j];
+						}
+						grad[k] += dw * d + w * noise_grad<T, N>(h, k);
+					}
+				}
+			}
+			grad *= T(noise_scale<N>::perlin);
+			return value * T(noise_scale<N>::perlin);
+		}
+
+		// skew and unskew factors for the simplex lattice
+		template <typename T, size_t N>
+		struct simplex_skew {
+			static T f() { return (std::sqrt(T(N + 1)) - T(1)) / T(N); }
+			static T g() { return (T(1) - T(1) / std::sqrt(T(N + 1))) / T(N); }
+		};
+
+		template <typename T, size_t N, bool WantGrad>
+		inline T simplex_impl(const basic_vec<T, N> &p, const noise_table &tab, basic_vec<T, N> &grad) {
+			const T F = simplex_skew<T, N>::f(), G = simplex_skew<T, N>::g();
+			T s = 0;
+			for (size_t k = 0; k < N; ++k) s += p[k];
+			s *= F;
+			int cell[N];
+			T t = 0;
+			for (size_t k = 0; k < N; ++k) {
+				cell[k] = noise_floor(p[k] + s);
+				t += T(cell[k]);
+			}
+			t *= G;
+			T d0[N];
+			for (size_t k = 0; k < N; ++k) d0[k] = p[k] - (T(cell[k]) - t);
+			// rank the offsets; corner i steps along the i largest
+			unsigned rank[N] = {};
+			for (size_t j = 0; j < N; ++j) {
+				for (size_t k = j + 1; k < N; ++k) {
+					if (d0[j] >= d0[k]) rank[k]++; else rank[j]++;
+				}
+			}
+			T value = 0;
+			for (unsigned i = 0; i <= N; ++i) {
+				int corner[N];
+				T d[N], r2 = 0;
+				for (size_t k = 0; k < N; ++k) {
+					const unsigned o = rank[k] < i ? 1 : 0;
+					corner[k] = cell[k] + int(o);
+					d[k] = d0[k] - T(o) + T(i) * G;
+					r2 += d[k] * d[k];
+				}
+				const T a = T(0.5) - r2;
+				if (a <= 0) continue;
+				const unsigned h = tab.hash(corner);
+				T gd = 0;
+				for (size_t k = 0; k < N; ++k) gd += noise_grad<T, N>(h, k) * d[k];
+				const T a2 = a * a;
+				value += a2 * a2 * gd;
+				if (WantGrad) {
+					for (size_t k = 0; k < N; ++k) {
+						grad[k] += a2 * a2 * noise_grad<T, N>(h, k) - T(8) * a2 * a * gd * d[k];
+					}
+				}
+			}
+			grad *= T(noise_scale<N>::simplex);
+			return value * T(noise_scale<N>::simplex);
+		}
+
+		// distances to the nearest and second nearest feature points (one per cell),
+		// and the nearest feature point
+		template <typename T, size_t N>
+		inline basic_vec<T, 2> worley_impl(const basic_vec<T, N> &p, const noise_table &tab, basic_vec<T, N> &nearest) {
+			int cell[N];
+			for (size_t k = 0; k < N; ++k) cell[k] = noise_floor(p[k]);
+			T f1 = std::numeric_limits<T>::max(), f2 = f1;
+			unsigned count = 1;
+			for (size_t k = 0; k < N; ++k) count *= 3;
+			for (unsigned c = 0; c < count; ++c) {
+				int corner[N];
+				unsigned cc = c;
+				for (size_t k = 0; k < N; ++k, cc /= 3) corner[k] = cell[k] + int(cc % 3) - 1;
+				const unsigned h = tab.hash(corner);
+				basic_vec<T, N> q;
+				for (size_t k = 0; k < N; ++k) {
+					// 16 bits of jitter per component
+					const unsigned a = tab.perm(h + unsigned(k));
+					const unsigned b = tab.perm(a + unsigned(k));
+					q[k] = T(corner[k]) + (T(a * 256 + b) + T(0.5)) / T(65536);
+				}
+				const T d2 = dot(q - p, q - p);
+				if (d2 < f1) {
+					f2 = f1;
+					f1 = d2;
+					nearest = q;
+				} else if (d2 < f2) {
+					f2 = d2;
+				}
+			}
+			return basic_vec<T, 2>(std::sqrt(f1), std::sqrt(f2));
+		}
+
+	}
+
+	// gradient noise, roughly in [-1, 1] and 0 at integer lattice points
+	template <typename T, size_t N>
+	inline T perlin(const basic_vec<T, N> &p, const noise_table &tab = noise_table::standard()) {
+		static_assert(N >= 1 && N <= 4, "perlin noise is defined for 1 to 4 dimensions");
+		basic_vec<T, N> g;
+		return detail::perlin_impl<T, N, false>(p, tab, g);
+	}
+
+	template <typename T, size_t N>
+	inline noise_sample<T, N> perlin_grad(const basic_vec<T, N> &p, const noise_table &tab = noise_table::standard()) {
+		static_assert(N >= 1 && N <= 4, "perlin noise is defined for 1 to 4 dimensions");
+		noise_sample<T, N> r{T(0), basic_vec<T, N>(0)};
+		r.value = detail::perlin_impl<T, N, true>(p, tab, r.gradient);
+		return r;
+	}
+
+	// simplex noise, roughly in [-1, 1]
+	template <typename T, size_t N>
+	inline T simplex(const basic_vec<T, N> &p, const noise_table &tab = noise_table::standard()) {
+		static_assert(N >= 1 && N <= 4, "simplex noise is defined for 1 to 4 dimensions");
+		basic_vec<T, N> g;
+		return detail::simplex_impl<T, N, false>(p, tab, g);
+	}
+
+	template <typename T, size_t N>
+	inline noise_sample<T, N> simplex_grad(const basic_vec<T, N> &p, const noise_table &tab = noise_table::standard()) {
+		static_assert(N >= 1 && N <= 4, "simplex noise is defined for 1 to 4 dimensions");
+		noise_sample<T, N> r{T(0), basic_vec<T, N>(0)};
+		r.value = detail::simplex_impl<T, N, true>(p, tab, r.gradient);
+		return r;
+	}
+
+	// cellular noise: distance to the nearest of one jittered feature point per unit cell
+	template <typename T, size_t N>
+	inline T worley(const basic_vec<T, N> &p, const noise_table &tab = noise_table::standard()) {
+		basic_vec<T, N> q;
+		return detail::worley_impl(p, tab, q)[0];
+	}
+
+	// distances to the nearest and second nearest feature points (F1, F2)
+	template <typename T, size_t N>
+	inline basic_vec<T, 2> worley_f1f2(const basic_vec<T, N> &p, const noise_table &tab = noise_table::standard()) {
+		basic_vec<T, N> q;
+		return detail::worley_impl(p, tab, q);
+	}
+
+	template <typename T, size_t N>
+	inline noise_sample<T, N> worley_grad(const basic_vec<T, N> &p, const noise_table &tab = noise_table::standard()) {
+		basic_vec<T, N> q;
+		const T f1 = detail::worley_impl(p, tab, q)[0];
+		return noise_sample<T, N>{f1, f1 > 0 ? basic_vec<T, N>((p - q) / f1) : basic_vec<T, N>(0)};
+	}
+
+	namespace detail {
+
+		template <typename T, size_t N>
+		inline void fractal_add(T &acc, T a, T, T x, bool turbulent) {
+			acc += a * (turbulent ? std::abs(x) : x);
+		}
+
+		template <typename T, size_t N>
+		inline void fractal_add(noise_sample<T, N> &acc, T a, T freq, const noise_sample<T, N> &x, bool turbulent) {
+			const T sign = turbulent && x.value < 0 ? T(-1) : T(1);
+			acc.value += a * sign * x.value;
+			acc.gradient += (a * freq * sign) * x.gradient;
+		}
+
+		template <typename T, size_t N>
+		inline void fractal_scale(T &acc, T s) {
+			acc *= s;
+		}
+
+		template <typename T, size_t N>
+		inline void fractal_scale(noise_sample<T, N> &acc, T s) {
+			acc.value *= s;
+			acc.gradient *= s;
+		}
+
+		template <typename F, typename T, size_t N>
+		inline auto fractal(F noise, const basic_vec<T, N> &p, int octaves, T lacunarity, T gain, bool turbulent) {
+			using result_t = std::decay_t<decltype(noise(p))>;
+			result_t acc{};
+			T a = 1, freq = 1, norm = 0;
+			for (int i = 0; i < octaves; ++i) {
+				fractal_add<T, N>(acc, a, freq, noise(p * freq), turbulent);
+				norm += a;
+				a *= gain;
+				freq *= lacunarity;
+			}
+			if (norm > 0) fractal_scale<T, N>(acc, T(1) / norm);
+			return acc;
+		}
+
+	}
+
+	// fractal Brownian motion: octaves of noise(p * lacunarity^i) weighted by gain^i,
+	// normalized by the total weight so the range stays that of noise
+	// noise is any callable on basic_vec<T, N> returning T or noise_sample<T, N>
+	// (for which the gradient is summed too), eg [](const vec3 &q) { return simplex_grad(q); }
+	template <typename F, typename T, size_t N>
+	inline auto fbm(F noise, const basic_vec<T, N> &p, int octaves, T lacunarity = T(2), T gain = T(0.5)) {
+		return detail::fractal(noise, p, octaves, lacunarity, gain, false);
+	}
+
+	// fbm of abs(noise)
+	template <typename F, typename T, size_t N>
+	inline auto turbulence(F noise, const basic_vec<T, N> &p, int octaves, T lacunarity = T(2), T gain = T(0.5)) {
+		return detail::fractal(noise, p, octaves, lacunarity, gain, true);
+	}
+
+	namespace detail {
+
+		// points per block in the batch kernels
+		constexpr size_t noise_lanes = 16;
+
+		// simplex noise for a block of points, lane-major so that everything
+		// but the table lookups vectorizes
+		template <typename T, size_t N>
+		inline void simplex_block(const T *const (&x)[N], size_t n, const noise_table &tab, T *out) {
+			const T F = simplex_skew<T, N>::f(), G = simplex_skew<T, N>::g();
+			T s[noise_lanes] = {}, t[noise_lanes] = {}, acc[noise_lanes] = {};
+			T d0[N][noise_lanes];
+			int cell[N][noise_lanes];
+			unsigned rank[N][noise_lanes] = {};
+			for (size_t k = 0; k < N; ++k) {
+				for (size_t l = 0; l < n; ++l) s[l] += x[k][l];
+			}
+			for (size_t k = 0; k < N; ++k) {
+				for (size_t l = 0; l < n; ++l) {
+					cell[k][l] = noise_floor(x[k][l] + s[l] * F);
+					t[l] += T(cell[k][l]);
+				}
+			}
+			for (size_t k = 0; k < N; ++k) {
+				for (size_t l = 0; l < n; ++l) d0[k][l] = x[k][l] - (T(cell[k][l]) - t[l] * G);
+			}
+			for (size_t j = 0; j < N; ++j) {
+				for (size_t k = j + 1; k < N; ++k) {
+					for (size_t l = 0; l < n; ++l) {
+						const unsigned b = d0[j][l] >= d0[k][l];
+						rank[k][l] += b;
+						rank[j][l] += 1 - b;
+					}
+				}
+			}
+			for (unsigned i = 0; i <= N; ++i) {
+				T d[N][noise_lanes];
+				T r2[noise_lanes] = {};
+				unsigned h[noise_lanes];
+				for (size_t k = 0; k < N; ++k) {
+					for (size_t l = 0; l < n; ++l) {
+						d[k][l] = d0[k][l] - T(rank[k][l] < i) + T(i) * G;
+						r2[l] += d[k][l] * d[k][l];
+					}
+				}
+				// the gather
+				for (size_t l = 0; l < n; ++l) {
+					int corner[N];
+					for (size_t k = 0; k < N; ++k) corner[k] = cell[k][l] + int(rank[k][l] < i);
+					h[l] = tab.hash(corner);
+				}
+				for (size_t l = 0; l < n; ++l) {
+					T gd = 0;
+					for (size_t k = 0; k < N; ++k) gd += noise_grad<T, N>(h[l], k) * d[k][l];
+					T a = T(0.5) - r2[l];
+					a = a > 0 ? a : T(0);
+					acc[l] += a * a * a * a * gd;
+				}
+			}
+			for (size_t l = 0; l < n; ++l) out[l] = acc[l] * T(noise_scale<N>::simplex);
+		}
+
+		template <typename T, size_t N>
+		inline void perlin_block(const T *const (&x)[N], size_t n, const noise_table &tab, T *out) {
+			int cell[N][noise_lanes];
+			T f[N][noise_lanes], u[N][noise_lanes];
+			T acc[noise_lanes] = {};
+			for (size_t k = 0; k < N; ++k) {
+				for (size_t l = 0; l < n; ++l) {
+					cell[k][l] = noise_floor(x[k][l]);
+					f[k][l] = x[k][l] - T(cell[k][l]);
+					u[k][l] = noise_fade(f[k][l]);
+				}
+			}
+			for (unsigned c = 0; c < (1u << N); ++c) {
+				unsigned h[noise_lanes];
+				for (size_t l = 0; l < n; ++l) {
+					int corner[N];
+					for (size_t k = 0; k < N; ++k) corner[k] = cell[k][l] + int((c >> k) & 1u);
+					h[l] = tab.hash(corner);
+				}
+				for (size_t l = 0; l < n; ++l) {
+					T d = 0, w = 1;
+					for (size_t k = 0; k < N; ++k) {
+						const bool o = (c >> k) & 1u;
+						d += noise_grad<T, N>(h[l], k) * (f[k][l] - T(o));
+						w *= o ? u[k][l] : T(1) - u[k][l];
+					}
+					acc[l] += w * d;
+				}
+			}
+			for (size_t l = 0; l < n; ++l) out[l] = acc[l] * T(noise_scale<N>::perlin);
+		}
+
+		template <typename T, size_t N, typename BlockF>
+		inline void noise_batch(const span<const T> (&x)[N], span<T> out, unsigned threads, BlockF block) {
+			const size_t count = out.size();
+			for (size_t k = 0; k < N; ++k) assert(x[k].size() == count);
+			const unsigned nthreads = std::min<unsigned>(resolve_thread_count(threads), unsigned(count / 4096 + 1));
+			parallel_for(count, nthreads, [&](size_t i0, size_t i1, unsigned) {
+				for (size_t i = i0; i < i1; i += noise_lanes) {
+					const T *p[N];
+					for (size_t k = 0; k < N; ++k) p[k] = x[k].data() + i;
+					block(p, std::min(noise_lanes, i1 - i), out.data() + i);
+				}
+			});
+		}
+
+	}
+
+	// simplex noise over structure-of-arrays coordinates: out[i] = simplex(vec(x[i], y[i], ...))
+	// threads = 0 uses every hardware thread
+	template <typename T>
+	inline void simplex_batch(span<const T> x, span<const T> y, span<T> out, const noise_table &tab = noise_table::standard(), unsigned threads = 1) {
+		const span<const T> xs[2] = {x, y};
+		detail::noise_batch<T, 2>(xs, out, threads, [&](const T *const (&p)[2], size_t n, T *o) { detail::simplex_block<T, 2>(p, n, tab, o); });
+	}
+
+	template <typename T>
+	inline void simplex_batch(span<const T> x, span<const T> y, span<const T> z, span<T> out, const noise_table &tab = noise_table::standard(), unsigned threads = 1) {
+		const span<const T> xs[3] = {x, y, z};
+		detail::noise_batch<T, 3>(xs, out, threads, [&](const T *const (&p)[3], size_t n, T *o) { detail::simplex_block<T, 3>(p, n, tab, o); });
+	}
+
+	template <typename T>
+	inline void simplex_batch(span<const T> x, span<const T> y, span<const T> z, span<const T> w, span<T> out, const noise_table &tab = noise_table::standard(), unsigned threads = 1) {
+		const span<const T> xs[4] = {x, y, z, w};
+		detail::noise_batch<T, 4>(xs, out, threads, [&](const T *const (&p)[4], size_t n, T *o) { detail::simplex_block<T, 4>(p, n, tab, o); });
+	}
+
+	// perlin noise over structure-of-arrays coordinates: out[i] = perlin(vec(x[i], y[i], ...))
+	template <typename T>
+	inline void perlin_batch(span<const T> x, span<const T> y, span<T> out, const noise_table &tab = noise_table::standard(), unsigned threads = 1) {
+		const span<const T> xs[2] = {x, y};
+		detail::noise_batch<T, 2>(xs, out, threads, [&](const T *const (&p)[2], size_t n, T *o) { detail::perlin_block<T, 2>(p, n, tab, o); });
+	}
+
+	template <typename T>
+	inline void perlin_batch(span<const T> x, span<const T> y, span<const T> z, span<T> out, const noise_table &tab = noise_table::standard(), unsigned threads = 1) {
+		const span<const T> xs[3] = {x, y, z};
+		detail::noise_batch<T, 3>(xs, out, threads, [&](const T *const (&p)[3], size_t n, T *o) { detail::perlin_block<T, 3>(p, n, tab, o); });
+	}
+
+}
@@ -0,0 +1,54 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Parallel Helpers
+//
+// Minimal std::thread based helpers shared by the batch/bulk modules.
+// Nothing here is part of the public interface.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace cgra {
+
+	namespace detail {
+
+		// resolve a requested thread count (0 means one per hardware thread)
+		inline unsigned resolve_thread_count(unsigned threads) {
+			if (threads == 0) threads = std::thread::hardware_concurrency();
+			return std::max(threads, 1u);
+		}
+
+		// first index of chunk t when splitting [0, count) into n contiguous chunks
+		inline size_t chunk_begin(size_t count, unsigned n, unsigned t) {
+			return size_t((unsigned long long)(count) * t / n);
+		}
+
+		// calls f(begin, end, t) for each of n contiguous chunks of [0, count)
+		// chunk 0 runs on the calling thread, the rest on their own threads
+		template <typename F>
+		inline void parallel_for(size_t count, unsigned n, F &&f) {
+			n = std::max(n, 1u);
+			if (n == 1) {
+				f(size_t(0), count, 0u);
+				return;
+			}
+			std::vector<std::thread> workers;
+			workers.reserve(n - 1);
+			for (unsigned t = 1; t < n; ++t) {
+				workers.emplace_back([&f, count, n, t]() {
+					f(chunk_begin(count, n, t), chunk_begin(count, n, t + 1), t);
+				});
+			}
+			f(size_t(0), chunk_begin(count, n, 1), 0u);
+			for (auto &w : workers) w.join();
+		}
+
+	}
+
+}
@@ -0,0 +1,289 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Spatial Hash Grid
+//
+// Uniform grid over basic_vec positions for fixed radius neighbour search.
+// Cells are stored in an open-addressing table and point indices are kept
+// in one flat array sorted by cell, rebuilt in bulk with a counting sort.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "cgra_math.hpp"
+#include "cgra_parallel.hpp"
+
+namespace cgra {
+
+	namespace detail {
+
+		// large primes for spatial hashing (Teschner et al. 2003), extended past 3d
+		constexpr std::uint64_t spatial_hash_primes[8] {
+			73856093, 19349663, 83492791, 49979687, 86028121, 15485863, 32452843, 67867967
+		};
+
+		template <size_t N>
+		inline std::uint64_t spatial_hash(const basic_vec<int, N> &c) {
+			std::uint64_t h = 0;
+			for (size_t i = 0; i < N; ++i) {
+				h ^= std::uint64_t(std::int64_t(c[i])) * spatial_hash_primes[i % 8];
+			}
+			// finalizer so the low bits are usable for power of 2 tables
+			h ^= h >> 33;
+			h *= 0xff51afd7ed558ccdull;
+			h ^= h >> 33;
+			return h;
+		}
+	}
+
+
+	// spatial hash grid over N-dimensional points
+	// the grid stores indices into the point array it was built from
+	template <typename T, size_t N>
+	class spatial_hash_grid {
+	public:
+		using value_t = T;
+		using vec_t = basic_vec<T, N>;
+		using cell_t = basic_vec<int, N>;
+		using index_t = std::uint32_t;
+
+		static constexpr index_t npos = std::numeric_limits<index_t>::max();
+
+	private:
+		// open-addressing table entry, cell_id == npos means empty
+		struct slot {
+			cell_t cell;
+			index_t cell_id;
+		};
+
+		T m_cell_size;
+		T m_inv_cell_size;
+
+		// table of occupied cells (capacity is a power of 2)
+		std::vector<slot> m_slots;
+
+		// points in cell i are m_indices[m_cell_begin[i]] to m_indices[m_cell_begin[i+1]]
+		std::vector<index_t> m_cell_begin;
+		std::vector<index_t> m_indices;
+
+		// copy of positions in sorted order, so queries read contiguous memory
+		std::vector<vec_t> m_points;
+
+		// rebuild scratch
+		std::vector<std::uint64_t> m_point_hash;
+		std::vector<cell_t> m_point_cell;
+		std::vector<index_t> m_point_cell_id;
+		std::vector<index_t> m_counts;
+
+		index_t find_or_insert(const cell_t &c, std::uint64_t h, index_t next_id) {
+			const size_t mask = m_slots.size() - 1;
+			for (size_t i = size_t(h) & mask; ; i = (i + 1) & mask) {
+				slot &s = m_slots[i];
+				if (s.cell_id == npos) {
+					s.cell = c;
+					s.cell_id = next_id;
+					return next_id;
+				}
+				if (equal_cell(s.cell, c)) return s.cell_id;
+			}
+		}
+
+		static bool equal_cell(const cell_t &a, const cell_t &b) {
+			for (size_t i = 0; i < N; ++i) {
+				if (a[i] != b[i]) return false;
+			}
+			return true;
+		}
+
+	public:
+		explicit spatial_hash_grid(T cell_size = T(1)) {
+			this->cell_size(cell_size);
+		}
+
+		T cell_size() const { return m_cell_size; }
+
+		// changing the cell size invalidates the grid until the next rebuild
+		void cell_size(T cell_size) {
+			assert(cell_size > T(0));
+			m_cell_size = cell_size;
+			m_inv_cell_size = T(1) / cell_size;
+			clear();
+		}
+
+		// cell containing a position
+		// positions too far out for an int cell index share the outermost cells
+		cell_t cell_of(const vec_t &p) const {
+			cell_t c;
+			for (size_t i = 0; i < N; ++i) {
+				const T f = std::floor(p[i] * m_inv_cell_size);
+				c[i] = f > T(std::numeric_limits<int>::min())
+					? (f < T(std::numeric_limits<int>::max()) ? int(f) : std::numeric_limits<int>::max())
+					: std::numeric_limits<int>::min();
+			}
+			return c;
+		}
+
+		void clear() {
+			m_slots.clear();
+			m_cell_begin.assign(1, 0);
+			m_indices.clear();
+			m_points.clear();
+		}
+
+		// number of points in the grid
+		size_t size() const { return m_indices.size(); }
+
+		bool empty() const { return m_indices.empty(); }
+
+		// number of occupied cells
+		size_t cell_count() const { return m_cell_begin.size() - 1; }
+
+		// point indices sorted by cell
+		const std::vector<index_t> & indices() const { return m_indices; }
+
+		// point positions in the same order as indices()
+		const std::vector<vec_t> & points() const { return m_points; }
+
+		// rebuild the grid from count positions
+		// threads is the number of threads to use (0 for one per hardware thread)
+		void rebuild(const vec_t *positions, size_t count, unsigned threads = 1) {
+			assert(count < size_t(npos));
+			const unsigned nthreads = std::min<unsigned>(
+				detail::resolve_thread_count(threads),
+				unsigned(std::max<size_t>(count / 4096, 1))
+			);
+
+			m_point_hash.resize(count);
+			m_point_cell.resize(count);
+			m_point_cell_id.resize(count);
+			m_indices.resize(count);
+			m_points.resize(count);
+
+			// hash every point
+			detail::parallel_for(count, nthreads, [&](size_t begin, size_t end, unsigned) {
+				for (size_t i = begin; i < end; ++i) {
+					m_point_cell[i] = cell_of(positions[i]);
+					m_point_hash[i] = detail::spatial_hash(m_point_cell[i]);
+				}
+			});
+
+			// assign dense cell ids through the table, at most one cell per point
+			size_t capacity = 16;
+			while (capacity < 2 * count) capacity *= 2;
+			m_slots.assign(capacity, slot{cell_t(0), npos});
+			index_t ncells = 0;
+			for (size_t i = 0; i < count; ++i) {
+				const index_t id = find_or_insert(m_point_cell[i], m_point_hash[i], ncells);
+				if (id == ncells) ncells++;
+				m_point_cell_id[i] = id;
+			}
+
+			// counting sort: per thread histograms, then a cell major prefix sum
+			// so the order within each cell stays stable regardless of thread count
+			m_counts.assign(size_t(nthreads) * ncells, 0);
+			detail::parallel_for(count, nthreads, [&](size_t begin, size_t end, unsigned t) {
+				index_t *counts = m_counts.data() + size_t(t) * ncells;
+				for (size_t i = begin; i < end; ++i) {
+					counts[m_point_cell_id[i]]++;
+				}
+			});
+
+			m_cell_begin.resize(size_t(ncells) + 1);
+			index_t running = 0;
+			for (index_t c = 0; c < ncells; ++c) {
+				m_cell_begin[c] = running;
+				for (unsigned t = 0; t < nthreads; ++t) {
+					index_t &n = m_counts[size_t(t) * ncells + c];
+					const index_t offset = running;
+					running += n;
+					n = offset;
+				}
+			}
+			m_cell_begin[ncells] = running;
+
+			detail::parallel_for(count, nthreads, [&](size_t begin, size_t end, unsigned t) {
+				index_t *offsets = m_counts.data() + size_t(t) * ncells;
+				for (size_t i = begin; i < end; ++i) {
+					const index_t j = offsets[m_point_cell_id[i]]++;
+					m_indices[j] = index_t(i);
+					m_points[j] = positions[i];
+				}
+			});
+		}
+
+		void rebuild(const std::vector<vec_t> &positions, unsigned threads = 1) {
+			rebuild(positions.data(), positions.size(), threads);
+		}
+
+		// id of a cell, or npos if the cell is empty
+		index_t find_cell(const cell_t &c) const {
+			if (m_slots.empty()) return npos;
+			const size_t mask = m_slots.size() - 1;
+			for (size_t i = size_t(detail::spatial_hash(c)) & mask; ; i = (i + 1) & mask) {
+				const slot &s = m_slots[i];
+				if (s.cell_id == npos || equal_cell(s.cell, c)) return s.cell_id;
+			}
+		}
+
+		// calls f(index, position) for every point in a cell
+		template <typename F>
+		void for_each_in_cell(const cell_t &c, F &&f) const {
+			const index_t id = find_cell(c);
+			if (id == npos) return;
+			for (index_t j = m_cell_begin[id]; j < m_cell_begin[id + 1]; ++j) {
+				f(m_indices[j], m_points[j]);
+			}
+		}
+
+		// calls f(index, position) for every point within radius of center
+		template <typename F>
+		void for_each_in_radius(const vec_t &center, T radius, F &&f) const {
+			assert(radius >= T(0));
+			const cell_t lo = cell_of(center - radius);
+			const cell_t hi = cell_of(center + radius);
+			const T r2 = radius * radius;
+			cell_t c = lo;
+			while (true) {
+				const index_t id = find_cell(c);
+				if (id != npos) {
+					for (index_t j = m_cell_begin[id]; j < m_cell_begin[id + 1]; ++j) {
+						const vec_t d = m_points[j] - center;
+						if (dot(d, d) <= r2) f(m_indices[j], m_points[j]);
+					}
+				}
+				// step to the next cell in the range, first dimension fastest
+				size_t i = 0;
+				for (; i < N; ++i) {
+					if (c[i] < hi[i]) {
+						c[i]++;
+						break;
+					}
+					c[i] = lo[i];
+				}
+				if (i == N) break;
+			}
+		}
+
+		// appends the indices of all points within radius of center to out
+		// returns the number of indices appended
+		size_t query_radius(const vec_t &center, T radius, std::vector<index_t> &out) const {
+			const size_t n0 = out.size();
+			for_each_in_radius(center, radius, [&](index_t i, const vec_t &) { out.push_back(i); });
+			return out.size() - n0;
+		}
+
+		std::vector<index_t> query_radius(const vec_t &center, T radius) const {
+			std::vector<index_t> out;
+			query_radius(center, radius, out);
+			return out;
+		}
+	};
+
+	template <typename T, size_t N>
+	constexpr typename spatial_hash_grid<T, N>::index_t spatial_hash_grid<T, N>::npos;
+
+}
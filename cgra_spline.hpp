@@ -0,0 +1,461 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Spline
+//
+// Cubic Bezier, Catmull-Rom, B-spline and Hermite curves, arc-length
+// parameterisation and squad quaternion splines.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "cgra_math.hpp"
+
+namespace cgra {
+
+	// cubic curve segment stored in the power basis:
+	// p(t) = c0 + c1 t + c2 t^2 + c3 t^3, for t in [0, 1]
+	// every spline basis converts to this once, so evaluation is the same Horner step for all of them
+	template <typename T, size_t N>
+	class basic_cubic {
+	public:
+		using value_t = T;
+		using vec_t = basic_vec<T, N>;
+
+		vec_t c0, c1, c2, c3;
+
+		basic_cubic() : c0(0), c1(0), c2(0), c3(0) { }
+
+		basic_cubic(const vec_t &c0_, const vec_t &c1_, const vec_t &c2_, const vec_t &c3_) : c0(c0_), c1(c1_), c2(c2_), c3(c3_) { }
+
+		vec_t operator()(T t) const {
+			return ((c3 * t + c2) * t + c1) * t + c0;
+		}
+
+		vec_t derivative(T t) const {
+			return (c3 * (T(3) * t) + c2 * T(2)) * t + c1;
+		}
+
+		vec_t second_derivative(T t) const {
+			return c3 * (T(6) * t) + c2 * T(2);
+		}
+
+		vec_t third_derivative() const {
+			return c3 * T(6);
+		}
+
+		// cubic Bezier with control points p0..p3; passes through p0 and p3
+		static basic_cubic bezier(const vec_t &p0, const vec_t &p1, const vec_t &p2, const vec_t &p3) {
+			return basic_cubic{
+				p0,
+				(p1 - p0) * T(3),
+				(p0 - p1 * T(2) + p2) * T(3),
+				(p1 - p2) * T(3) + p3 - p0
+			};
+		}
+
+		// uniform Catmull-Rom between p1 and p2, with p0 and p3 as the neighbouring points
+		static basic_cubic catmull_rom(const vec_t &p0, const vec_t &p1, const vec_t &p2, const vec_t &p3) {
+			return basic_cubic{
+				p1,
+				(p2 - p0) * T(0.5),
+				p0 - p1 * T(2.5) + p2 * T(2) - p3 * T(0.5),
+				((p1 - p2) * T(3) + p3 - p0) * T(0.5)
+			};
+		}
+
+		// uniform cubic B-spline segment; approximates rather than interpolates its control points
+		static basic_cubic bspline(const vec_t &p0, const vec_t &p1, const vec_t &p2, const vec_t &p3) {
+			const T s = T(1) / T(6);
+			return basic_cubic{
+				(p0 + p1 * T(4) + p2) * s,
+				(p2 - p0) * T(0.5),
+				(p0 - p1 * T(2) + p2) * T(0.5),
+				((p1 - p2) * T(3) + p3 - p0) * s
+			};
+		}
+
+		// cubic Hermite from p0 with tangent m0 to p1 with tangent m1
+		static basic_cubic hermite(const vec_t &p0, const vec_t &m0, const vec_t &p1, const vec_t &m1) {
+			return basic_cubic{
+				p0,
+				m0,
+				(p1 - p0) * T(3) - m0 * T(2) - m1,
+				(p0 - p1) * T(2) + m0 + m1
+			};
+		}
+	};
+
+
+	// piecewise cubic curve; segment i covers parameters [i, i + 1], so the domain is [0, size()]
+	// parameters outside the domain are clamped
+	template <typename T, size_t N>
+	class basic_spline {
+	public:
+		using value_t = T;
+		using vec_t = basic_vec<T, N>;
+		using cubic_t = basic_cubic<T, N>;
+
+	private:
+		std::vector<cubic_t> m_segments;
+
+		// segment index for t, leaving the local parameter in t
+		size_t locate(T &t) const {
+			assert(!m_segments.empty());
+			t = std::min(std::max(t, T(0)), T(m_segments.size()));
+			const size_t i = std::min(size_t(t), m_segments.size() - 1);
+			t -= T(i);
+			return i;
+		}
+
+	public:
+		basic_spline() { }
+
+		explicit basic_spline(std::vector<cubic_t> segments_) : m_segments(std::move(segments_)) { }
+
+		size_t size() const {
+			return m_segments.size();
+		}
+
+		bool empty() const {
+			return m_segments.empty();
+		}
+
+		span<const cubic_t> segments() const {
+			return m_segments;
+		}
+
+		vec_t operator()(T t) const {
+			const size_t i = locate(t);
+			return m_segments[i](t);
+		}
+
+		vec_t derivative(T t) const {
+			const size_t i = locate(t);
+			return m_segments[i].derivative(t);
+		}
+
+		vec_t second_derivative(T t) const {
+			const size_t i = locate(t);
+			return m_segments[i].second_derivative(t);
+		}
+
+		// piecewise Bezier from 3k + 1 control points; every third point lies on the curve
+		static basic_spline bezier(span<const vec_t> points) {
+			assert(points.size() >= 4 && points.size() % 3 == 1);
+			std::vector<cubic_t> segs;
+			segs.reserve(points.size() / 3);
+			for (size_t i = 0; i + 3 < points.size(); i += 3) {
+				segs.push_back(cubic_t::bezier(points[i], points[i + 1], points[i + 2], points[i + 3]));
+			}
+			return basic_spline(std::move(segs));
+		}
+
+		// Catmull-Rom through every point; the missing neighbours at the ends are
+		// extrapolated, so there are points.size() - 1 segments
+		static basic_spline catmull_rom(span<const vec_t> points) {
+			assert(points.size() >= 2);
+			const size_t n = points.size();
+			std::vector<cubic_t> segs;
+			segs.reserve(n - 1);
+			for (size_t i = 0; i + 1 < n; ++i) {
+				const vec_t p0 = i > 0 ? points[i - 1] : points[0] * T(2) - points[1];
+				const vec_t p3 = i + 2 < n ? points[i + 2] : points[n - 1] * T(2) - points[n - 2];
+				segs.push_back(cubic_t::catmull_rom(p0, points[i], points[i + 1], p3));
+			}
+			return basic_spline(std::move(segs));
+		}
+
+		// uniform B-spline with points.size() - 3 segments
+		static basic_spline bspline(span<const vec_t> points) {
+			assert(points.size() >= 4);
+			std::vector<cubic_t> segs;
+			segs.reserve(points.size() - 3);
+			for (size_t i = 0; i + 3 < points.size(); ++i) {
+				segs.push_back(cubic_t::bspline(points[i], points[i + 1], points[i + 2], points[i + 3]));
+			}
+			return basic_spline(std::move(segs));
+		}
+
+		// Hermite through every point with the given tangent at each
+		static basic_spline hermite(span<const vec_t> points, span<const vec_t> tangents) {
+			assert(points.size() >= 2 && tangents.size() == points.size());
+			std::vector<cubic_t> segs;
+			segs.reserve(points.size() - 1);
+			for (size_t i = 0; i + 1 < points.size(); ++i) {
+				segs.push_back(cubic_t::hermite(points[i], tangents[i], points[i + 1], tangents[i + 1]));
+			}
+			return basic_spline(std::move(segs));
+		}
+	};
+
+
+	namespace detail {
+
+		// 5-point Gauss-Legendre integral of |p'| over [a, b]
+		template <typename T, size_t N>
+		inline T cubic_length(const basic_cubic<T, N> &c, T a, T b) {
+			static const T x[5] = {T(0), T(-0.5384693101056831), T(0.5384693101056831), T(-0.9061798459386640), T(0.9061798459386640)};
+			static const T w[5] = {T(0.5688888888888889), T(0.4786286704993665), T(0.4786286704993665), T(0.2369268850561891), T(0.2369268850561891)};
+			const T m = (a + b) * T(0.5), r = (b - a) * T(0.5);
+			T s = 0;
+			for (size_t i = 0; i < 5; ++i) s += w[i] * length(c.derivative(m + r * x[i]));
+			return s * r;
+		}
+
+		// writes p(t0 + i h) for i in [0, count)
+		// cubics have a constant third difference, so each step is three vector adds
+		// restarting at every segment keeps the rounding error from accumulating along the curve
+		template <typename T, size_t N>
+		inline void cubic_forward_difference(const basic_cubic<T, N> &c, T t0, T h, size_t count, basic_vec<T, N> *out) {
+			if (count < 4) {
+				for (size_t i = 0; i < count; ++i) out[i] = c(t0 + T(i) * h);
+				return;
+			}
+			const T h2 = h * h, h3 = h2 * h;
+			basic_vec<T, N> p = c(t0);
+			basic_vec<T, N> d1 = c.c1 * h + c.c2 * (h2 + T(2) * t0 * h) + c.c3 * (h3 + T(3) * t0 * h2 + T(3) * t0 * t0 * h);
+			basic_vec<T, N> d2 = c.c2 * (T(2) * h2) + c.c3 * (T(6) * h3 + T(6) * t0 * h2);
+			const basic_vec<T, N> d3 = c.c3 * (T(6) * h3);
+			for (size_t i = 0; i < count; ++i) {
+				out[i] = p;
+				p += d1;
+				d1 += d2;
+				d2 += d3;
+			}
+		}
+
+	}
+
+
+	// evaluates count evenly spaced parameters over [0, 1], both ends included
+	template <typename T, size_t N>
+	inline void sample_n(const basic_cubic<T, N> &c, size_t count, span<basic_vec<T, N>> out) {
+		assert(out.size() >= count);
+		if (count == 0) return;
+		if (count == 1) {
+			out[0] = c(T(0));
+			return;
+		}
+		detail::cubic_forward_difference(c, T(0), T(1) / T(count - 1), count, out.data());
+	}
+
+	// evaluates count evenly spaced parameters over the whole spline, both ends included
+	template <typename T, size_t N>
+	inline void sample_n(const basic_spline<T, N> &s, size_t count, span<basic_vec<T, N>> out) {
+		assert(out.size() >= count && !s.empty());
+		if (count == 0) return;
+		if (count == 1) {
+			out[0] = s(T(0));
+			return;
+		}
+		const size_t n = s.size();
+		const T h = T(n) / T(count - 1);
+		size_t i = 0;
+		for (size_t j = 0; j < n && i < count; ++j) {
+			// first sample index with parameter >= j + 1, in exact integer arithmetic
+			const size_t end = j + 1 == n ? count : std::min(count, ((j + 1) * (count - 1) + n - 1) / n);
+			if (end <= i) continue;
+			detail::cubic_forward_difference(s.segments()[j], T(i) * h - T(j), h, end - i, out.data() + i);
+			i = end;
+		}
+	}
+
+
+	// cumulative arc length of a spline at evenly spaced parameters,
+	// for reparameterising by distance
+	template <typename T, size_t N>
+	class basic_arc_length_table {
+	private:
+		std::vector<T> m_distance;
+		size_t m_samples = 1;
+
+	public:
+		using value_t = T;
+
+		basic_arc_length_table() : m_distance(1, T(0)) { }
+
+		// samples_per_segment trades table size for accuracy of param()
+		explicit basic_arc_length_table(const basic_spline<T, N> &s, size_t samples_per_segment = 16) : m_samples(std::max<size_t>(1, samples_per_segment)) {
+			const T h = T(1) / T(m_samples);
+			m_distance.reserve(s.size() * m_samples + 1);
+			m_distance.push_back(T(0));
+			T d = 0;
+			for (const auto &c : s.segments()) {
+				for (size_t k = 0; k < m_samples; ++k) {
+					d += detail::cubic_length(c, T(k) * h, T(k + 1) * h);
+					m_distance.push_back(d);
+				}
+			}
+		}
+
+		T length() const {
+			return m_distance.back();
+		}
+
+		// arc length from the start of the spline to parameter t
+		T distance(T t) const {
+			if (m_distance.size() < 2) return T(0);
+			const T x = std::min(std::max(t * T(m_samples), T(0)), T(m_distance.size() - 1));
+			const size_t i = std::min(size_t(x), m_distance.size() - 2);
+			return mix(m_distance[i], m_distance[i + 1], x - T(i));
+		}
+
+		// spline parameter at arc length s, clamped to [0, length()]
+		T param(T s) const {
+			if (m_distance.size() < 2 || !(s > T(0))) return T(0);
+			if (s >= length()) return T(m_distance.size() - 1) / T(m_samples);
+			const size_t i = size_t(std::upper_bound(m_distance.begin(), m_distance.end(), s) - m_distance.begin()) - 1;
+			const T d = m_distance[i + 1] - m_distance[i];
+			const T f = d > T(0) ? (s - m_distance[i]) / d : T(0);
+			return (T(i) + f) / T(m_samples);
+		}
+	};
+
+	// evaluates count points evenly spaced by arc length, both ends included
+	template <typename T, size_t N>
+	inline void sample_n(const basic_spline<T, N> &s, const basic_arc_length_table<T, N> &table, size_t count, span<basic_vec<T, N>> out) {
+		assert(out.size() >= count);
+		if (count == 0) return;
+		const T step = count > 1 ? table.length() / T(count - 1) : T(0);
+		for (size_t i = 0; i < count; ++i) out[i] = s(table.param(T(i) * step));
+	}
+
+
+	namespace detail {
+
+		// slerp without the shortest-path flip, which would make squad jump between q and -q
+		template <typename T>
+		inline basic_quat<T> squad_slerp(const basic_quat<T> &a, const basic_quat<T> &b, T t) {
+			const T d = std::min(std::max(dot(a, b), T(-1)), T(1));
+			const T w = acos(d);
+			const T sw = sin(w);
+			if (std::abs(sw) < T(1e-4)) return normalize(a * (T(1) - t) + b * t);
+			return (a * sin((T(1) - t) * w) + b * sin(t * w)) * (T(1) / sw);
+		}
+
+	}
+
+	// squad control quaternion for key q between q_prev and q_next
+	// keys should be unit length; neighbours are flipped onto q's hemisphere first
+	template <typename T>
+	inline basic_quat<T> squad_control(const basic_quat<T> &q_prev, const basic_quat<T> &q, const basic_quat<T> &q_next) {
+		const basic_quat<T> qi = conj(q);
+		const basic_quat<T> a = dot(q, q_prev) < T(0) ? q_prev * T(-1) : q_prev;
+		const basic_quat<T> b = dot(q, q_next) < T(0) ? q_next * T(-1) : q_next;
+		return q * exp((log(qi * a) + log(qi * b)) * T(-0.25));
+	}
+
+	// spherical quadrangle interpolation from q0 (t = 0) to q1 (t = 1)
+	// with control quaternions a0 and a1, see squad_control
+	// q0 and q1 should be on the same hemisphere
+	template <typename T, typename Tt>
+	inline basic_quat<T> squad(const basic_quat<T> &q0, const basic_quat<T> &a0, const basic_quat<T> &a1, const basic_quat<T> &q1, const Tt &t) {
+		const T u = T(t);
+		return detail::squad_slerp(detail::squad_slerp(q0, q1, u), detail::squad_slerp(a0, a1, u), T(2) * u * (T(1) - u));
+	}
+
+
+	// C1 rotation spline through a sequence of unit quaternion keys using squad
+	// key i is at parameter i, so the domain is [0, size() - 1]
+	template <typename T>
+	class basic_quat_spline {
+	public:
+		using value_t = T;
+		using quat_t = basic_quat<T>;
+
+	private:
+		std::vector<quat_t> m_keys;
+		std::vector<quat_t> m_controls;
+
+	public:
+		basic_quat_spline() { }
+
+		explicit basic_quat_spline(span<const quat_t> keys) : m_keys(keys.begin(), keys.end()) {
+			const size_t n = m_keys.size();
+			// keep consecutive keys on the same hemisphere so each segment takes the short way
+			for (size_t i = 1; i < n; ++i) {
+				if (dot(m_keys[i - 1], m_keys[i]) < T(0)) m_keys[i] = m_keys[i] * T(-1);
+			}
+			m_controls.resize(n);
+			for (size_t i = 0; i < n; ++i) {
+				m_controls[i] = i == 0 || i + 1 == n ? m_keys[i] : squad_control(m_keys[i - 1], m_keys[i], m_keys[i + 1]);
+			}
+		}
+
+		size_t size() const {
+			return m_keys.size();
+		}
+
+		span<const quat_t> keys() const {
+			return m_keys;
+		}
+
+		quat_t operator()(T t) const {
+			assert(!m_keys.empty());
+			if (m_keys.size() == 1) return m_keys[0];
+			t = std::min(std::max(t, T(0)), T(m_keys.size() - 1));
+			const size_t i = std::min(size_t(t), m_keys.size() - 2);
+			return squad(m_keys[i], m_controls[i], m_controls[i + 1], m_keys[i + 1], t - T(i));
+		}
+	};
+
+	// evaluates count evenly spaced parameters over the whole spline, both ends included
+	template <typename T>
+	inline void sample_n(const basic_quat_spline<T> &s, size_t count, span<basic_quat<T>> out) {
+		assert(out.size() >= count);
+		const T h = count > 1 ? T(s.size() - 1) / T(count - 1) : T(0);
+		for (size_t i = 0; i < count; ++i) out[i] = s(T(i) * h);
+	}
+
+
+#ifdef CGRA_INITIAL3D_NAMES
+	// aliases: Intial3D naming convention
+
+	using cubic2f = basic_cubic<float, 2>;
+	using cubic2d = basic_cubic<double, 2>;
+	using cubic3f = basic_cubic<float, 3>;
+	using cubic3d = basic_cubic<double, 3>;
+
+	using spline2f = basic_spline<float, 2>;
+	using spline2d = basic_spline<double, 2>;
+	using spline3f = basic_spline<float, 3>;
+	using spline3d = basic_spline<double, 3>;
+
+	using arc_length_table2f = basic_arc_length_table<float, 2>;
+	using arc_length_table2d = basic_arc_length_table<double, 2>;
+	using arc_length_table3f = basic_arc_length_table<float, 3>;
+	using arc_length_table3d = basic_arc_length_table<double, 3>;
+
+	using quat_splinef = basic_quat_spline<float>;
+	using quat_splined = basic_quat_spline<double>;
+
+#else
+	// aliases: GLSL naming convention
+
+	using cubic2 = basic_cubic<float, 2>;
+	using dcubic2 = basic_cubic<double, 2>;
+	using cubic3 = basic_cubic<float, 3>;
+	using dcubic3 = basic_cubic<double, 3>;
+
+	using spline2 = basic_spline<float, 2>;
+	using dspline2 = basic_spline<double, 2>;
+	using spline3 = basic_spline<float, 3>;
+	using dspline3 = basic_spline<double, 3>;
+
+	using arc_length_table2 = basic_arc_length_table<float, 2>;
+	using darc_length_table2 = basic_arc_length_table<double, 2>;
+	using arc_length_table3 = basic_arc_length_table<float, 3>;
+	using darc_length_table3 = basic_arc_length_table<double, 3>;
+
+	using quat_spline = basic_quat_spline<float>;
+	using dquat_spline = basic_quat_spline<double>;
+
+#endif
+
+}
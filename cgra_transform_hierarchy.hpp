@@ -0,0 +1,219 @@
+//----------------------------------------------------------------------------
+//
+// CGRA Math Library - Transform Hierarchy
+//
+// Parent-indexed tree of affine local transforms with cached world matrices.
+// Nodes are stored breadth-first, one level after another, so each level
+// only depends on the one before it and can be updated in parallel. Setting
+// a local transform marks the node dirty, and update() only recomputes the
+// world matrices of dirty nodes and their descendants.
+//
+//----------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "cgra_math.hpp"
+#include "cgra_decompose.hpp"
+#include "cgra_parallel.hpp"
+
+namespace cgra {
+
+	namespace detail {
+
+		// a * b for affine matrices (bottom row 0, 0, 0, 1), 36 multiplies instead of 64
+		template <typename T>
+		inline basic_mat<T, 4, 4> affine_mul(const basic_mat<T, 4, 4> &a, const basic_mat<T, 4, 4> &b) {
+			basic_mat<T, 4, 4> r;
+			for (size_t j = 0; j < 4; ++j) {
+				const T x = b[j][0], y = b[j][1], z = b[j][2];
+				r[j][0] = a[0][0] * x + a[1][0] * y + a[2][0] * z;
+				r[j][1] = a[0][1] * x + a[1][1] * y + a[2][1] * z;
+				r[j][2] = a[0][2] * x + a[1][2] * y + a[2][2] * z;
+				r[j][3] = T(0);
+			}
+			r[3][0] += a[3][0];
+			r[3][1] += a[3][1];
+			r[3][2] += a[3][2];
+			r[3][3] = T(1);
+			return r;
+		}
+	}
+
+
+	// tree of affine transforms, world(node) = world(parent) * local(node)
+	// nodes are identified by their index in the parent array the hierarchy was built from;
+	// world_matrices() is in storage (breadth-first) order, see nodes() for the mapping
+	template <typename T>
+	class transform_hierarchy {
+	public:
+		using value_t = T;
+		using mat_t = basic_mat<T, 4, 4>;
+		using vec_t = basic_vec<T, 3>;
+		using index_t = std::uint32_t;
+
+		// parent of a root node
+		static constexpr index_t npos = std::numeric_limits<index_t>::max();
+
+	private:
+		// everything per slot is in breadth-first order
+		std::vector<index_t> m_parent;
+		std::vector<mat_t> m_local;
+		std::vector<mat_t> m_world;
+		std::vector<std::uint8_t> m_dirty;
+
+		// node at each slot and slot of each node
+		std::vector<index_t> m_node;
+		std::vector<index_t> m_slot;
+
+		// slots of level k are [m_level_begin[k], m_level_begin[k + 1])
+		std::vector<index_t> m_level_begin;
+
+		// smallest dirty slot, so update() can skip the clean levels above it
+		index_t m_first_dirty = npos;
+
+		void mark(index_t s) {
+			m_dirty[s] = 1;
+			m_first_dirty = std::min(m_first_dirty, s);
+		}
+
+	public:
+		transform_hierarchy() : m_level_begin(1, 0) { }
+
+		explicit transform_hierarchy(span<const index_t> parents) {
+			build(parents);
+		}
+
+		// rebuild from a parent array, parents[i] is the parent of node i or npos for a root
+		// every local transform is reset to the identity
+		void build(span<const index_t> parents) {
+			const size_t count = parents.size();
+			assert(count < size_t(npos));
+			// children of each node by counting sort
+			std::vector<index_t> child_begin(count + 1, 0), children(count);
+			for (size_t i = 0; i < count; ++i) {
+				assert(parents[i] == npos || parents[i] < count);
+				if (parents[i] != npos) child_begin[parents[i] + 1]++;
+			}
+			for (size_t i = 0; i < count; ++i) child_begin[i + 1] += child_begin[i];
+			std::vector<index_t> fill(child_begin.begin(), child_begin.end() - 1);
+			for (size_t i = 0; i < count; ++i) {
+				if (parents[i] != npos) children[fill[parents[i]]++] = index_t(i);
+			}
+			// breadth-first from the roots, m_node doubles as the queue
+			m_node.clear();
+			m_node.reserve(count);
+			for (size_t i = 0; i < count; ++i) {
+				if (parents[i] == npos) m_node.push_back(index_t(i));
+			}
+			m_level_begin.assign(1, 0);
+			for (size_t b = 0; b < m_node.size(); ) {
+				const size_t e = m_node.size();
+				m_level_begin.push_back(index_t(e));
+				for (size_t s = b; s < e; ++s) {
+					const index_t n = m_node[s];
+					m_node.insert(m_node.end(), children.begin() + child_begin[n], children.begin() + child_begin[n + 1]);
+				}
+				b = e;
+			}
+			// nodes on a cycle are never reached
+			assert(m_node.size() == count);
+			m_slot.assign(count, npos);
+			for (size_t s = 0; s < count; ++s) m_slot[m_node[s]] = index_t(s);
+			m_parent.resize(count);
+			for (size_t s = 0; s < count; ++s) {
+				const index_t p = parents[m_node[s]];
+				m_parent[s] = p == npos ? npos : m_slot[p];
+			}
+			m_local.assign(count, mat_t(T(1)));
+			m_world.assign(count, mat_t(T(1)));
+			m_dirty.assign(count, 0);
+			m_first_dirty = npos;
+		}
+
+		// number of nodes
+		size_t size() const { return m_node.size(); }
+
+		bool empty() const { return m_node.empty(); }
+
+		// number of breadth-first levels (depth of the deepest node + 1)
+		size_t levels() const { return m_level_begin.size() - 1; }
+
+		// storage slot of a node, its index into world_matrices()
+		index_t slot(index_t node) const { return m_slot[node]; }
+
+		// node at each storage slot
+		span<const index_t> nodes() const { return span<const index_t>(m_node); }
+
+		// parent slot of each storage slot, npos for roots; parents always come before their children
+		span<const index_t> parent_slots() const { return span<const index_t>(m_parent); }
+
+		const mat_t & local(index_t node) const { return m_local[m_slot[node]]; }
+
+		// set the local transform of a node, which must be affine
+		void local(index_t node, const mat_t &m) {
+			const index_t s = m_slot[node];
+			m_local[s] = m;
+			mark(s);
+		}
+
+		// set the local transform of a node from translation, unit rotation and scale
+		void local(index_t node, const vec_t &t, const basic_quat<T> &q, const vec_t &s) {
+			local(node, compose_trs(t, q, s));
+		}
+
+		// world transform of a node as of the last update()
+		const mat_t & world(index_t node) const { return m_world[m_slot[node]]; }
+
+		// world transforms in storage order, contiguous for upload
+		span<const mat_t> world_matrices() const { return span<const mat_t>(m_world); }
+
+		// true if update() has work to do
+		bool dirty() const { return m_first_dirty != npos; }
+
+		// recompute the world transforms of dirty nodes and their descendants, one level at a time
+		// returns the number of world transforms recomputed
+		// threads = 0 uses every hardware thread; small levels run on the calling thread
+		size_t update(unsigned threads = 1) {
+			if (m_first_dirty == npos) return 0;
+			const unsigned max_threads = detail::resolve_thread_count(threads);
+			std::vector<size_t> counts(max_threads, 0);
+			const size_t first = size_t(std::upper_bound(m_level_begin.begin(), m_level_begin.end(), m_first_dirty) - m_level_begin.begin()) - 1;
+			for (size_t k = first; k < levels(); ++k) {
+				const size_t b = m_level_begin[k], e = m_level_begin[k + 1];
+				const unsigned nthreads = std::min<unsigned>(max_threads, unsigned((e - b) / 4096 + 1));
+				detail::parallel_for(e - b, nthreads, [&](size_t i0, size_t i1, unsigned t) {
+					size_t n = 0;
+					for (size_t s = b + i0; s < b + i1; ++s) {
+						const index_t p = m_parent[s];
+						// the parent is on the level above, already final
+						if (p == npos) {
+							if (!m_dirty[s]) continue;
+							m_world[s] = m_local[s];
+						} else {
+							if (!(m_dirty[s] | m_dirty[p])) continue;
+							m_dirty[s] = 1;
+							m_world[s] = detail::affine_mul(m_world[p], m_local[s]);
+						}
+						n++;
+					}
+					counts[t] += n;
+				});
+			}
+			std::fill(m_dirty.begin() + m_level_begin[first], m_dirty.end(), std::uint8_t(0));
+			m_first_dirty = npos;
+			size_t total = 0;
+			for (size_t n : counts) total += n;
+			return total;
+		}
+	};
+
+	template <typename T>
+	constexpr typename transform_hierarchy<T>::index_t transform_hierarchy<T>::npos;
+
+}
@@ -0,0 +1,143 @@
+
+# Disassembly counterpart to tests/bench/codegen_bench.cpp
+#
+# Compiles one probe function per operator and size, once through cgra_math
+# and once as a hand-written scalar loop, then compares instruction counts
+# and reports any leftover calls (zip_with/fold recursion that did not fold
+# away). Exits non-zero if any library kernel exceeds the threshold.
+#
+# usage: python scripts/codegen_audit.py [--cxx g++] [--flags "-O2"] [--threshold 1.25] [--max-n 16] [--keep out.s]
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+repo_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+header = '''
+#include <algorithm>
+#include <cgra_math.hpp>
+using namespace cgra;
+// baselines are fully unrolled so static instruction counts are comparable
+#define UNROLL _Pragma("GCC unroll 256")
+template <size_t N> struct raw_vec { float v[N]; };
+template <size_t N> struct raw_mat { float m[N][N]; };
+'''
+
+# (name, lib type, lib result, lib expression, raw type, raw result, raw body)
+vec_kernels = [
+	('vec{n}_add', 'basic_vec<float, {n}>', 'basic_vec<float, {n}>', '*a + *b',
+		'raw_vec<{n}>', 'raw_vec<{n}>', 'for (size_t i = 0; i < {n}; ++i) r->v[i] = a->v[i] + b->v[i];'),
+	('vec{n}_mul_scalar', 'basic_vec<float, {n}>', 'basic_vec<float, {n}>', '*a * 2.f',
+		'raw_vec<{n}>', 'raw_vec<{n}>', 'for (size_t i = 0; i < {n}; ++i) r->v[i] = a->v[i] * 2.f;'),
+	('vec{n}_neg', 'basic_vec<float, {n}>', 'basic_vec<float, {n}>', '-*a',
+		'raw_vec<{n}>', 'raw_vec<{n}>', 'for (size_t i = 0; i < {n}; ++i) r->v[i] = -a->v[i];'),
+	('vec{n}_min', 'basic_vec<float, {n}>', 'basic_vec<float, {n}>', 'min(*a, *b)',
+		'raw_vec<{n}>', 'raw_vec<{n}>', 'for (size_t i = 0; i < {n}; ++i) r->v[i] = std::min(a->v[i], b->v[i]);'),
+	('vec{n}_dot', 'basic_vec<float, {n}>', 'float', 'dot(*a, *b)',
+		'raw_vec<{n}>', 'float', 'float s = 0; for (size_t i = 0; i < {n}; ++i) s += a->v[i] * b->v[i]; *r = s;'),
+]
+
+mat_kernels = [
+	('mat{n}_add', 'basic_mat<float, {n}, {n}>', 'basic_mat<float, {n}, {n}>', '*a + *b',
+		'raw_mat<{n}>', 'raw_mat<{n}>', 'for (size_t j = 0; j < {n}; ++j) for (size_t i = 0; i < {n}; ++i) r->m[j][i] = a->m[j][i] + b->m[j][i];'),
+	('mat{n}_mul_vec', 'basic_mat<float, {n}, {n}>', 'basic_vec<float, {n}>', '*a * (*b)[0]',
+		'raw_mat<{n}>', 'raw_vec<{n}>', 'for (size_t i = 0; i < {n}; ++i) r->v[i] = 0; for (size_t j = 0; j < {n}; ++j) for (size_t i = 0; i < {n}; ++i) r->v[i] += a->m[j][i] * b->m[0][j];'),
+	('mat{n}_mul_mat', 'basic_mat<float, {n}, {n}>', 'basic_mat<float, {n}, {n}>', '*a * *b',
+		'raw_mat<{n}>', 'raw_mat<{n}>', 'for (size_t c = 0; c < {n}; ++c) { for (size_t i = 0; i < {n}; ++i) r->m[c][i] = 0; for (size_t j = 0; j < {n}; ++j) for (size_t i = 0; i < {n}; ++i) r->m[c][i] += a->m[j][i] * b->m[c][j]; }'),
+]
+
+quat_kernels = [
+	('quat_mul', 'quat', 'quat', '*a * *b', 'raw_vec<4>', 'raw_vec<4>',
+		'r->v[0] = a->v[0] * b->v[0] - a->v[1] * b->v[1] - a->v[2] * b->v[2] - a->v[3] * b->v[3]; '
+		'r->v[1] = a->v[0] * b->v[1] + a->v[1] * b->v[0] + a->v[2] * b->v[3] - a->v[3] * b->v[2]; '
+		'r->v[2] = a->v[0] * b->v[2] - a->v[1] * b->v[3] + a->v[2] * b->v[0] + a->v[3] * b->v[1]; '
+		'r->v[3] = a->v[0] * b->v[3] + a->v[1] * b->v[2] - a->v[2] * b->v[1] + a->v[3] * b->v[0];'),
+	('quat_add', 'quat', 'quat', '*a + *b', 'raw_vec<4>', 'raw_vec<4>',
+		'for (size_t i = 0; i < 4; ++i) r->v[i] = a->v[i] + b->v[i];'),
+]
+
+
+def probe_source(kernels):
+	src = [header]
+	for name, lt, lr, lexpr, rt, rr, rbody in kernels:
+		src.append('extern "C" void lib_{0}(const {1} *a, const {1} *b, {2} *r) {{ *r = {3}; }}'.format(name, lt, lr, lexpr))
+		src.append('extern "C" void base_{0}(const {1} *a, const {1} *b, {2} *r) {{ {3} }}'.format(name, rt, rr, rbody.replace('for (', 'UNROLL for (')))
+	# }
+	return '\n'.join(src) + '\n'
+# }
+
+
+def expand(kernels, sizes):
+	out = []
+	for n in sizes:
+		for k in kernels:
+			out.append(tuple(s.replace('{n}', str(n)) for s in k))
+		# }
+	# }
+	return out
+# }
+
+
+def count_instructions(asm):
+	# instruction and call counts per global function in gas output
+	counts = {}
+	current = None
+	for line in asm.splitlines():
+		m = re.match(r'^([A-Za-z_][\w.]*):', line)
+		if m and (m.group(1).startswith('lib_') or m.group(1).startswith('base_')):
+			current = m.group(1)
+			counts[current] = [0, 0]
+			continue
+		# }
+		if current is None: continue
+		s = line.strip()
+		if not s or s.endswith(':') or s.startswith('.') or s.startswith('#'):
+			if s.startswith('.size') or s.startswith('.cfi_endproc'): current = None
+			continue
+		# }
+		counts[current][0] += 1
+		if re.match(r'(call|jmp\s+_Z|bl\s)', s): counts[current][1] += 1
+	# }
+	return counts
+# }
+
+
+def main():
+	parser = argparse.ArgumentParser(description='compare cgra_math operator codegen against hand-written loops')
+	parser.add_argument('--cxx', default=os.environ.get('CXX', 'g++'))
+	parser.add_argument('--flags', default='-O2')
+	parser.add_argument('--threshold', type=float, default=1.25)
+	parser.add_argument('--max-n', type=int, default=16)
+	parser.add_argument('--keep', help='write the generated assembly to this file')
+	args = parser.parse_args()
+
+	sizes = range(2, args.max_n + 1)
+	kernels = expand(vec_kernels, sizes) + expand(mat_kernels, sizes) + quat_kernels
+
+	tmp = tempfile.mkdtemp()
+	src_path = os.path.join(tmp, 'codegen_probe.cpp')
+	asm_path = args.keep or os.path.join(tmp, 'codegen_probe.s')
+	with open(src_path, 'w') as f: f.write(probe_source(kernels))
+	cmd = [args.cxx, '-std=c++1z', '-S', '-fno-asynchronous-unwind-tables', '-I' + repo_dir, src_path, '-o', asm_path] + args.flags.split()
+	subprocess.check_call(cmd)
+	with open(asm_path) as f: counts = count_instructions(f.read())
+
+	print('{0:<20}{1:>10}{2:>10}{3:>8}{4:>7}'.format('kernel', 'cgra', 'baseline', 'ratio', 'calls'))
+	bad = 0
+	for k in kernels:
+		name = k[0]
+		lib, base = counts['lib_' + name], counts['base_' + name]
+		ratio = float(lib[0]) / max(1, base[0])
+		flagged = ratio > args.threshold or lib[1] > base[1]
+		bad += flagged
+		print('{0:<20}{1:>10}{2:>10}{3:>8.2f}{4:>7}{5}'.format(name, lib[0], base[0], ratio, lib[1], '  REGRESSION' if flagged else ''))
+	# }
+	print('{0} kernels, {1} above {2}x baseline or with calls'.format(len(kernels), bad, args.threshold))
+	return 1 if bad else 0
+# }
+
+if __name__ == '__main__': sys.exit(main())
@@ -0,0 +1,144 @@
+
+# Compile-time benchmark for the cgra_math header split
+#
+# Compiles the same small translation units against the full header, the
+# cgra_math_<section>.hpp sub-headers and the full header with
+# CGRA_MATH_EXTERN_TEMPLATES (as users of the cgra_math library would), and
+# reports the best compile time of several runs for each.
+#
+# The 'ctors' suite instead stresses basic_vec construction: many distinct
+# element type, size and argument combinations, so that the cost of
+# constructor overload resolution dominates. Compare it across commits with
+# --ref <git-rev>, which benchmarks the headers from that revision as well.
+#
+# usage: python scripts/compile_time_bench.py [--cxx g++] [--runs 5] [--flags "-O0" "-O2"]
+#        [--suite sections|ctors] [--ref <git-rev>]
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+try:
+	import resource
+except ImportError:
+	resource = None
+
+repo_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# the typical vector math a renderer TU does
+usage = '''
+using namespace cgra;
+vec3 f(vec3 a, vec3 b) { return normalize(cross(a, b)) * dot(a, b) + clamp(a, 0.f, 1.f); }
+vec4 g(const mat4 &m, vec4 v) { return m * v + vec4(1, 2, 3, 4); }
+mat4 h(const mat4 &a, const mat4 &b) { return inverse(a * b) * transpose(a); }
+mat3 k(const mat3 &a) { return inverse(a) * determinant(a); }
+quat q(quat a, quat b) { return slerp(a, b, 0.5f) * a; }
+dvec3 d(dvec3 a, dvec3 b) { return mix(a, b, 0.25) + abs(a - b); }
+ivec2 i(ivec2 a, ivec2 b) { return max(a, b) * 2; }
+'''
+
+section_configs = [
+	('header only, full', '#include <cgra_math.hpp>\n', []),
+	('header only, core', '#include <cgra_math_core.hpp>\n', []),
+	('usage, full', '#include <cgra_math.hpp>\n' + usage, []),
+	('usage, sub-headers', '#include <cgra_math_quat.hpp>\n' + usage, []),
+	('usage, full, extern', '#include <cgra_math.hpp>\n' + usage, ['-DCGRA_MATH_EXTERN_TEMPLATES']),
+	('usage, sub-headers, extern', '#include <cgra_math_quat.hpp>\n' + usage, ['-DCGRA_MATH_EXTERN_TEMPLATES']),
+]
+
+
+# one function per (destination, source, size) for each kind of magic ctor use
+ctor_templates = [
+	'basic_vec<{t},{n}> f{k}(basic_vec<{u},{n}> v) {{ return basic_vec<{t},{n}>(v); }}',
+	'basic_vec<{t},{n}> g{k}({u} a, {u} b, {u} c, {u} d) {{ return basic_vec<{t},{n}>(a, b, c, d); }}',
+	'basic_vec<{t},4> h{k}(basic_vec<{u},{n}> v, {u} s) {{ return basic_vec<{t},4>(v, s, s, s); }}',
+	'basic_vec<{t},{n}> i{k}(basic_vec<{t},{n}> v, {t} s) {{ return basic_vec<{t},{n}>{{s, v}}; }}',
+]
+
+def ctor_usage():
+	types = ['float', 'double', 'int']
+	lines = ['using namespace cgra;']
+	combos = [(t, u, n) for t in types for u in types for n in (2, 3, 4)]
+	for k, (t, u, n) in enumerate(combos):
+		lines += [l.format(t=t, u=u, n=n, k=k) for l in ctor_templates]
+	# }
+	return '\n'.join(lines) + '\n'
+# }
+
+ctor_configs = [
+	('header only, core', '#include <cgra_math_core.hpp>\n', []),
+	('vector ctors, core', '#include <cgra_math_core.hpp>\n' + ctor_usage(), []),
+]
+
+suites = {'sections': section_configs, 'ctors': ctor_configs}
+
+
+def child_cpu_time():
+	if resource is None: return time.time()
+	r = resource.getrusage(resource.RUSAGE_CHILDREN)
+	return r.ru_utime + r.ru_stime
+# }
+
+
+# cpu time (wall time where unavailable) is less sensitive to machine load
+def time_compile(cxx, include_dir, src_path, flags, runs):
+	cmd = [cxx, '-std=c++1z', '-I' + include_dir, '-c', src_path, '-o', os.devnull] + flags
+	best = float('inf')
+	for r in range(runs):
+		t0 = child_cpu_time()
+		subprocess.check_call(cmd)
+		best = min(best, child_cpu_time() - t0)
+	# }
+	return best
+# }
+
+
+# checks out the headers of a git revision into dest
+def export_ref(ref, dest):
+	names = subprocess.check_output(['git', 'ls-tree', '--name-only', ref], cwd=repo_dir).decode().split()
+	for name in names:
+		if name.endswith('.hpp'):
+			with open(os.path.join(dest, name), 'wb') as f:
+				f.write(subprocess.check_output(['git', 'show', ref + ':' + name], cwd=repo_dir))
+			# }
+		# }
+	# }
+# }
+
+
+def main():
+	parser = argparse.ArgumentParser(description='measure compile time of cgra_math configurations')
+	parser.add_argument('--cxx', default=os.environ.get('CXX', 'g++'))
+	parser.add_argument('--runs', type=int, default=5)
+	parser.add_argument('--flags', nargs='*', default=['-O0', '-O2'])
+	parser.add_argument('--suite', choices=sorted(suites), default='sections')
+	parser.add_argument('--ref', help='also benchmark the headers of this git revision')
+	args = parser.parse_args()
+
+	tmp = tempfile.mkdtemp()
+	trees = [('', repo_dir)]
+	if args.ref:
+		ref_dir = os.path.join(tmp, 'ref')
+		os.mkdir(ref_dir)
+		export_ref(args.ref, ref_dir)
+		trees.append((' @' + args.ref, ref_dir))
+	# }
+
+	print('{0:<40}'.format('configuration') + ''.join('{0:>10}'.format(f) for f in args.flags))
+	for name, src, defs in suites[args.suite]:
+		src_path = os.path.join(tmp, 'compile_probe.cpp')
+		with open(src_path, 'w') as f: f.write(src)
+		for tree_name, include_dir in trees:
+			times = [time_compile(args.cxx, include_dir, src_path, flag.split() + defs, args.runs) for flag in args.flags]
+			print('{0:<40}'.format(name + tree_name) + ''.join('{0:>8.0f}ms'.format(t * 1000) for t in times))
+		# }
+	# }
+	shutil.rmtree(tmp)
+	return 0
+# }
+
+if __name__ == '__main__': sys.exit(main())
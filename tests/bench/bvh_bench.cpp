@@ -0,0 +1,114 @@
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_bvh.hpp>
+
+using namespace std;
+using namespace cgra;
+
+namespace {
+
+	using vec3_t = basic_vec<float, 3>;
+	using clock_t_ = std::chrono::steady_clock;
+
+	double seconds_since(clock_t_::time_point t0) {
+		return std::chrono::duration<double>(clock_t_::now() - t0).count();
+	}
+
+	// bumpy uv sphere with 2 * rings * segments triangles
+	std::vector<bvh::triangle> generate_mesh(int rings, int segments, std::vector<vec3_t> &verts) {
+		verts.clear();
+		for (int i = 0; i <= rings; ++i) {
+			const float theta = float(pi) * i / rings;
+			for (int j = 0; j <= segments; ++j) {
+				const float phi = 2 * float(pi) * j / segments;
+				const float r = 1.f + 0.05f * sin(13 * theta) * sin(17 * phi) + 0.02f * sin(61 * theta + 47 * phi);
+				verts.push_back(r * vec3_t{sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi)});
+			}
+		}
+		std::vector<bvh::triangle> tris;
+		for (int i = 0; i < rings; ++i) {
+			for (int j = 0; j < segments; ++j) {
+				const int a = i * (segments + 1) + j;
+				const int b = a + segments + 1;
+				tris.push_back(bvh::triangle{verts[a], verts[b], verts[a + 1]});
+				tris.push_back(bvh::triangle{verts[a + 1], verts[b], verts[b + 1]});
+			}
+		}
+		return tris;
+	}
+
+	// pinhole camera rays covering the mesh
+	std::vector<basic_ray<float, 3>> generate_rays(int res) {
+		std::vector<basic_ray<float, 3>> rays;
+		const vec3_t eye{0.3f, 0.4f, 3.f};
+		for (int y = 0; y < res; ++y) {
+			for (int x = 0; x < res; ++x) {
+				const vec3_t target{(2.f * x / res - 1.f) * 1.2f, (2.f * y / res - 1.f) * 1.2f, 0.f};
+				rays.emplace_back(eye, normalize(target - eye));
+			}
+		}
+		return rays;
+	}
+
+	template <typename TreeT>
+	void bench_rays(const char *name, const TreeT &t, const std::vector<bvh::triangle> &tris, const std::vector<basic_ray<float, 3>> &rays) {
+		size_t hits = 0;
+		const auto t0 = clock_t_::now();
+		for (const auto &r : rays) {
+			if (bvh::intersect(t, tris, r)) hits++;
+		}
+		const double s = seconds_since(t0);
+		cout << "  " << setw(24) << left << name << right << setw(10) << fixed << setprecision(2)
+			<< (rays.size() / s / 1e6) << " Mrays/s  (" << hits << " hits)" << endl;
+	}
+}
+
+// usage: cgra_bvh_bench [rings] [ray resolution]
+int main(int argc, char *argv[]) {
+	const int rings = argc > 1 ? std::atoi(argv[1]) : 256;
+	const int res = argc > 2 ? std::atoi(argv[2]) : 512;
+
+	std::vector<vec3_t> verts;
+	const auto tris = generate_mesh(rings, 2 * rings, verts);
+	const auto rays = generate_rays(res);
+	cout << "mesh: " << tris.size() << " triangles, " << rays.size() << " rays" << endl;
+
+	cout << "build:" << endl;
+	bvh::tree t;
+	for (unsigned threads : {1u, 0u}) {
+		bvh::build_options opts;
+		opts.threads = threads;
+		const auto t0 = clock_t_::now();
+		t = bvh::build(tris, opts);
+		const double s = seconds_since(t0);
+		cout << "  " << setw(24) << left << (threads ? "binned sah, 1 thread" : "binned sah, all threads") << right
+			<< setw(10) << fixed << setprecision(2) << (s * 1000) << " ms  (" << t.nodes.size() << " nodes)" << endl;
+	}
+	auto t0 = clock_t_::now();
+	const auto t4 = bvh::collapse<4>(t);
+	const auto t8 = bvh::collapse<8>(t);
+	cout << "  " << setw(24) << left << "collapse to 4 and 8 wide" << right << setw(10) << (seconds_since(t0) * 1000) << " ms" << endl;
+
+	cout << "ray cast:" << endl;
+	bench_rays("binary", t, tris, rays);
+	bench_rays("4-wide", t4, tris, rays);
+	bench_rays("8-wide", t8, tris, rays);
+
+	cout << "nearest point:" << endl;
+	const auto pt = bvh::build(verts);
+	const int queries = 200000;
+	std::vector<vec3_t> qs;
+	// queries near the surface, as in point cloud registration or projection
+	for (int i = 0; i < queries; ++i) qs.push_back(random<float>(0.9f, 1.1f) * normalize(random<vec3_t>(vec3_t(-1), vec3_t(1))));
+	size_t checksum = 0;
+	t0 = clock_t_::now();
+	for (const auto &q : qs) checksum += bvh::nearest_point(pt, verts, q);
+	const double s = seconds_since(t0);
+	cout << "  " << setw(24) << left << "binary" << right << setw(10) << (queries / s / 1e6) << " Mqueries/s  (" << checksum % 1000 << ")" << endl;
+}
@@ -0,0 +1,235 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <cgra_math.hpp>
+
+using namespace std;
+using namespace cgra;
+
+// Compares the zip_with/fold based operators against hand-written scalar
+// loops over the same data, for vec, mat and quat families and N = 2..16.
+// Any kernel slower than its baseline by more than the threshold is flagged
+// and the exit code is non-zero, so abstraction overhead can be enforced.
+// See scripts/codegen_audit.py for the instruction-level counterpart.
+
+namespace {
+
+	using clock_t_ = std::chrono::steady_clock;
+
+	struct options {
+		double min_time = 0.05;
+		int trials = 5;
+		double threshold = 1.25;
+		size_t working_set = 16 << 10;
+	};
+
+	struct result {
+		std::string name;
+		double ns_lib;
+		double ns_base;
+		double ratio() const { return ns_lib / ns_base; }
+	};
+
+	template <typename T>
+	inline void do_not_optimize(const T &x) {
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(x) : "memory");
+#else
+		static volatile char sink;
+		sink = *reinterpret_cast<const volatile char *>(&x);
+#endif
+	}
+
+	// best time per element of kernel(), which processes n elements
+	template <typename KernelT>
+	double time_ns(const options &opt, size_t n, KernelT kernel) {
+		size_t reps = 1;
+		for (;;) {
+			const auto t0 = clock_t_::now();
+			for (size_t r = 0; r < reps; ++r) kernel();
+			if (std::chrono::duration<double>(clock_t_::now() - t0).count() >= opt.min_time / 4) break;
+			reps *= 2;
+		}
+		double best = std::numeric_limits<double>::infinity();
+		for (int t = 0; t < opt.trials; ++t) {
+			const auto t0 = clock_t_::now();
+			for (size_t r = 0; r < reps; ++r) kernel();
+			best = std::min(best, std::chrono::duration<double>(clock_t_::now() - t0).count());
+		}
+		return best / (double(reps) * n) * 1e9;
+	}
+
+	// baselines are fully unrolled, as a hand-specialised kernel would be
+#if defined(__GNUC__) || defined(__clang__)
+#define CGRA_BENCH_UNROLL _Pragma("GCC unroll 256")
+#else
+#define CGRA_BENCH_UNROLL
+#endif
+
+	// plain aggregate with the same layout as basic_vec<float, N>
+	template <size_t N>
+	struct raw_vec { float v[N]; };
+
+	template <size_t N>
+	struct raw_mat { float m[N][N]; };
+
+	template <typename T>
+	std::vector<T> make_values(size_t n) {
+		std::vector<T> v(n);
+		// fill through bytes so library and raw types share the same values
+		for (auto &x : v) {
+			float *p = reinterpret_cast<float *>(&x);
+			for (size_t i = 0; i < sizeof(T) / sizeof(float); ++i) p[i] = random<float>(-1.f, 1.f);
+		}
+		return v;
+	}
+
+	class audit {
+	private:
+		options m_opt;
+		std::vector<result> m_results;
+
+	public:
+		explicit audit(options opt) : m_opt(opt) { }
+
+		const std::vector<result> & results() const { return m_results; }
+
+		// runs out[i] = f(a[i], b[i]) over library type L and the same bytes as raw type R
+		template <typename L, typename LR, typename R, typename RR, typename LibF, typename BaseF>
+		void compare(std::string name, LibF lib, BaseF base) {
+			const size_t n = std::max<size_t>(1, m_opt.working_set / (3 * sizeof(L)));
+			const auto la = make_values<L>(n), lb = make_values<L>(n);
+			std::vector<R> ra(n), rb(n);
+			std::memcpy(ra.data(), la.data(), n * sizeof(L));
+			std::memcpy(rb.data(), lb.data(), n * sizeof(L));
+			std::vector<LR> lout(n);
+			std::vector<RR> rout(n);
+			const double t_lib = time_ns(m_opt, n, [&] {
+				for (size_t i = 0; i < n; ++i) lout[i] = lib(la[i], lb[i]);
+				do_not_optimize(lout[n - 1]);
+			});
+			const double t_base = time_ns(m_opt, n, [&] {
+				for (size_t i = 0; i < n; ++i) base(ra[i], rb[i], rout[i]);
+				do_not_optimize(rout[n - 1]);
+			});
+			result r{std::move(name), t_lib, t_base};
+			cout << "  " << setw(20) << left << r.name << right << fixed << setprecision(3)
+				<< setw(10) << r.ns_lib << " ns" << setw(10) << r.ns_base << " ns" << setw(9) << setprecision(2) << r.ratio()
+				<< (r.ratio() > m_opt.threshold ? "  REGRESSION" : "") << endl;
+			m_results.push_back(std::move(r));
+		}
+
+		int regressions() const {
+			return int(std::count_if(m_results.begin(), m_results.end(), [&](const result &r) { return r.ratio() > m_opt.threshold; }));
+		}
+	};
+
+
+	template <size_t N>
+	void vec_kernels(audit &a) {
+		using vec_t = basic_vec<float, N>;
+		using raw_t = raw_vec<N>;
+		static_assert(sizeof(vec_t) == sizeof(raw_t), "layout mismatch");
+		const std::string n = std::to_string(N);
+
+		a.compare<vec_t, vec_t, raw_t, raw_t>("vec" + n + " add",
+			[](const vec_t &x, const vec_t &y) { return x + y; },
+			[](const raw_t &x, const raw_t &y, raw_t &r) { CGRA_BENCH_UNROLL for (size_t i = 0; i < N; ++i) r.v[i] = x.v[i] + y.v[i]; });
+		a.compare<vec_t, vec_t, raw_t, raw_t>("vec" + n + " mul scalar",
+			[](const vec_t &x, const vec_t &) { return x * 2.f; },
+			[](const raw_t &x, const raw_t &, raw_t &r) { CGRA_BENCH_UNROLL for (size_t i = 0; i < N; ++i) r.v[i] = x.v[i] * 2.f; });
+		a.compare<vec_t, vec_t, raw_t, raw_t>("vec" + n + " neg",
+			[](const vec_t &x, const vec_t &) { return -x; },
+			[](const raw_t &x, const raw_t &, raw_t &r) { CGRA_BENCH_UNROLL for (size_t i = 0; i < N; ++i) r.v[i] = -x.v[i]; });
+		a.compare<vec_t, vec_t, raw_t, raw_t>("vec" + n + " min",
+			[](const vec_t &x, const vec_t &y) { return min(x, y); },
+			[](const raw_t &x, const raw_t &y, raw_t &r) { CGRA_BENCH_UNROLL for (size_t i = 0; i < N; ++i) r.v[i] = std::min(x.v[i], y.v[i]); });
+		a.compare<vec_t, float, raw_t, float>("vec" + n + " dot",
+			[](const vec_t &x, const vec_t &y) { return dot(x, y); },
+			[](const raw_t &x, const raw_t &y, float &r) { float s = 0; CGRA_BENCH_UNROLL for (size_t i = 0; i < N; ++i) s += x.v[i] * y.v[i]; r = s; });
+	}
+
+	template <size_t N>
+	void mat_kernels(audit &a) {
+		using mat_t = basic_mat<float, N, N>;
+		using raw_t = raw_mat<N>;
+		static_assert(sizeof(mat_t) == sizeof(raw_t), "layout mismatch");
+		const std::string n = std::to_string(N);
+
+		a.compare<mat_t, mat_t, raw_t, raw_t>("mat" + n + " add",
+			[](const mat_t &x, const mat_t &y) { return x + y; },
+			[](const raw_t &x, const raw_t &y, raw_t &r) {
+				CGRA_BENCH_UNROLL for (size_t j = 0; j < N; ++j) CGRA_BENCH_UNROLL for (size_t i = 0; i < N; ++i) r.m[j][i] = x.m[j][i] + y.m[j][i];
+			});
+		a.compare<mat_t, basic_vec<float, N>, raw_t, raw_vec<N>>("mat" + n + " mul vec",
+			[](const mat_t &x, const mat_t &y) { return x * y[0]; },
+			[](const raw_t &x, const raw_t &y, raw_vec<N> &r) {
+				CGRA_BENCH_UNROLL for (size_t i = 0; i < N; ++i) r.v[i] = 0;
+				CGRA_BENCH_UNROLL for (size_t j = 0; j < N; ++j) CGRA_BENCH_UNROLL for (size_t i = 0; i < N; ++i) r.v[i] += x.m[j][i] * y.m[0][j];
+			});
+		a.compare<mat_t, mat_t, raw_t, raw_t>("mat" + n + " mul mat",
+			[](const mat_t &x, const mat_t &y) { return x * y; },
+			[](const raw_t &x, const raw_t &y, raw_t &r) {
+				for (size_t c = 0; c < N; ++c) {
+					CGRA_BENCH_UNROLL for (size_t i = 0; i < N; ++i) r.m[c][i] = 0;
+					CGRA_BENCH_UNROLL for (size_t j = 0; j < N; ++j) CGRA_BENCH_UNROLL for (size_t i = 0; i < N; ++i) r.m[c][i] += x.m[j][i] * y.m[c][j];
+				}
+			});
+	}
+
+	void quat_kernels(audit &a) {
+		using raw_t = raw_vec<4>;
+		a.compare<quat, quat, raw_t, raw_t>("quat mul",
+			[](const quat &p, const quat &q) { return p * q; },
+			[](const raw_t &p, const raw_t &q, raw_t &r) {
+				r.v[0] = p.v[0] * q.v[0] - p.v[1] * q.v[1] - p.v[2] * q.v[2] - p.v[3] * q.v[3];
+				r.v[1] = p.v[0] * q.v[1] + p.v[1] * q.v[0] + p.v[2] * q.v[3] - p.v[3] * q.v[2];
+				r.v[2] = p.v[0] * q.v[2] - p.v[1] * q.v[3] + p.v[2] * q.v[0] + p.v[3] * q.v[1];
+				r.v[3] = p.v[0] * q.v[3] + p.v[1] * q.v[2] - p.v[2] * q.v[1] + p.v[3] * q.v[0];
+			});
+		a.compare<quat, quat, raw_t, raw_t>("quat add",
+			[](const quat &p, const quat &q) { return p + q; },
+			[](const raw_t &p, const raw_t &q, raw_t &r) { CGRA_BENCH_UNROLL for (size_t i = 0; i < 4; ++i) r.v[i] = p.v[i] + q.v[i]; });
+	}
+
+	template <size_t ...Ns>
+	void all_kernels(audit &a, std::index_sequence<Ns...>) {
+		int dummy[]{(vec_kernels<Ns + 2>(a), 0)...};
+		int dummy2[]{(mat_kernels<Ns + 2>(a), 0)...};
+		(void) dummy;
+		(void) dummy2;
+	}
+}
+
+// usage: cgra_codegen_bench [--threshold <ratio>] [--quick]
+int main(int argc, char *argv[]) {
+	options opt;
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "--threshold") && i + 1 < argc) {
+			opt.threshold = std::atof(argv[++i]);
+		} else if (!std::strcmp(argv[i], "--quick")) {
+			opt.min_time = 0.005;
+			opt.trials = 2;
+		} else {
+			cerr << "usage: " << argv[0] << " [--threshold <ratio>] [--quick]" << endl;
+			return 1;
+		}
+	}
+
+	cout << "  " << setw(20) << left << "kernel" << right << setw(13) << "cgra" << setw(13) << "baseline" << setw(9) << "ratio" << endl;
+	audit a(opt);
+	all_kernels(a, std::make_index_sequence<15>());
+	quat_kernels(a);
+
+	const int bad = a.regressions();
+	cout << a.results().size() << " kernels, " << bad << " above " << opt.threshold << "x baseline" << endl;
+	return bad ? 2 : 0;
+}
@@ -0,0 +1,512 @@
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_camera.hpp>
+#include <cgra_memory.hpp>
+#include <cgra_decompose.hpp>
+#include <cgra_df64.hpp>
+#include <cgra_fixed.hpp>
+#include <cgra_geometry.hpp>
+#include <cgra_noise.hpp>
+#include <cgra_spline.hpp>
+#include <cgra_transform_hierarchy.hpp>
+
+using namespace std;
+using namespace cgra;
+
+namespace {
+
+	using clock_t_ = std::chrono::steady_clock;
+
+	struct result {
+		std::string name;
+		size_t working_set;
+		double ns_per_op;
+		double ops_per_sec;
+		double gb_per_sec;
+	};
+
+	struct options {
+		double min_time = 0.1;
+		int trials = 3;
+		std::vector<size_t> working_sets{16 << 10, 1 << 20, 64 << 20};
+		std::string filter;
+	};
+
+	// keeps the compiler from discarding results that are never read
+	template <typename T>
+	inline void do_not_optimize(const T &x) {
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(x) : "memory");
+#else
+		static volatile char sink;
+		sink = *reinterpret_cast<const volatile char *>(&x);
+#endif
+	}
+
+	template <typename T>
+	T make_value() { return random<T>(T(-1), T(1)); }
+
+	// quats are kept unit length so slerp and inverse stay well conditioned
+	template <>
+	quat make_value<quat>() { return random<quat>(); }
+
+	template <>
+	dquat make_value<dquat>() { return random<dquat>(); }
+
+	template <typename T>
+	std::vector<T> make_values(size_t n) {
+		std::vector<T> v(n);
+		for (auto &x : v) x = make_value<T>();
+		return v;
+	}
+
+	// times kernel(n) for enough repetitions to fill min_time, best of trials
+	template <typename KernelT>
+	result run(const options &opt, std::string name, size_t working_set, size_t n, size_t bytes_per_op, KernelT kernel) {
+		size_t reps = 1;
+		for (;;) {
+			const auto t0 = clock_t_::now();
+			for (size_t r = 0; r < reps; ++r) kernel(n);
+			const double s = std::chrono::duration<double>(clock_t_::now() - t0).count();
+			if (s >= opt.min_time / 4 || reps >= (size_t(1) << 30)) break;
+			reps *= 2;
+		}
+		double best = std::numeric_limits<double>::infinity();
+		for (int t = 0; t < opt.trials; ++t) {
+			const auto t0 = clock_t_::now();
+			for (size_t r = 0; r < reps; ++r) kernel(n);
+			best = std::min(best, std::chrono::duration<double>(clock_t_::now() - t0).count());
+		}
+		const double ops = double(reps) * n;
+		return result{std::move(name), working_set, best / ops * 1e9, ops / best, ops * bytes_per_op / best / 1e9};
+	}
+
+	class suite {
+	private:
+		options m_opt;
+		std::vector<result> m_results;
+
+		bool selected(const std::string &name) const {
+			return m_opt.filter.empty() || name.find(m_opt.filter) != std::string::npos;
+		}
+
+		void add(result r) {
+			cerr << "  " << setw(24) << left << r.name << right << setw(10) << r.working_set << " B"
+				<< setw(10) << std::fixed << setprecision(3) << r.ns_per_op << " ns/op"
+				<< setw(12) << setprecision(1) << (r.ops_per_sec / 1e6) << " Mops/s"
+				<< setw(10) << setprecision(2) << r.gb_per_sec << " GB/s" << endl;
+			m_results.push_back(std::move(r));
+		}
+
+	public:
+		explicit suite(options opt) : m_opt(std::move(opt)) { }
+
+		const std::vector<result> & results() const { return m_results; }
+
+		// out[i] = f(a[i])
+		template <typename A, typename F>
+		void unary(const std::string &name, F f) {
+			if (!selected(name)) return;
+			using R = std::decay_t<decltype(f(std::declval<A>()))>;
+			const size_t bytes = sizeof(A) + sizeof(R);
+			for (size_t ws : m_opt.working_sets) {
+				const size_t n = std::max<size_t>(1, ws / bytes);
+				const auto a = make_values<A>(n);
+				std::vector<R> out(n);
+				add(run(m_opt, name, ws, n, bytes, [&](size_t n) {
+					for (size_t i = 0; i < n; ++i) out[i] = f(a[i]);
+					do_not_optimize(out[n - 1]);
+				}));
+			}
+		}
+
+		// out[i] = f(a[i], b[i])
+		template <typename A, typename B, typename F>
+		void binary(const std::string &name, F f) {
+			if (!selected(name)) return;
+			using R = std::decay_t<decltype(f(std::declval<A>(), std::declval<B>()))>;
+			const size_t bytes = sizeof(A) + sizeof(B) + sizeof(R);
+			for (size_t ws : m_opt.working_sets) {
+				const size_t n = std::max<size_t>(1, ws / bytes);
+				const auto a = make_values<A>(n);
+				const auto b = make_values<B>(n);
+				std::vector<R> out(n);
+				add(run(m_opt, name, ws, n, bytes, [&](size_t n) {
+					for (size_t i = 0; i < n; ++i) out[i] = f(a[i], b[i]);
+					do_not_optimize(out[n - 1]);
+				}));
+			}
+		}
+
+		// out[i] = f(), for generators with no input
+		template <typename R, typename F>
+		void generate(const std::string &name, F f) {
+			if (!selected(name)) return;
+			const size_t bytes = sizeof(R);
+			for (size_t ws : m_opt.working_sets) {
+				const size_t n = std::max<size_t>(1, ws / bytes);
+				std::vector<R> out(n);
+				add(run(m_opt, name, ws, n, bytes, [&](size_t n) {
+					for (size_t i = 0; i < n; ++i) out[i] = f();
+					do_not_optimize(out[n - 1]);
+				}));
+			}
+		}
+
+		// a per-frame scratch buffer: buf = f(n) then buf[i] = x, per op
+		// f allocates (and releases the previous frame's buffer) however it likes
+		template <typename R, typename F>
+		void scratch(const std::string &name, F f) {
+			if (!selected(name)) return;
+			const size_t bytes = sizeof(R);
+			for (size_t ws : m_opt.working_sets) {
+				const size_t n = std::max<size_t>(1, ws / bytes);
+				const R x = make_value<R>();
+				add(run(m_opt, name, ws, n, bytes, [&](size_t n) {
+					auto &&buf = f(n);
+					for (size_t i = 0; i < n; ++i) buf[i] = x;
+					do_not_optimize(buf[n - 1]);
+				}));
+			}
+		}
+
+		// setup(n) prepares buffers for n items and returns the kernel(n) to time,
+		// eg a structure-of-arrays batch function
+		template <typename SetupF>
+		void bulk(const std::string &name, size_t bytes, SetupF setup) {
+			if (!selected(name)) return;
+			for (size_t ws : m_opt.working_sets) {
+				const size_t n = std::max<size_t>(1, ws / bytes);
+				auto kernel = setup(n);
+				add(run(m_opt, name, ws, n, bytes, kernel));
+			}
+		}
+
+		void write_json(std::ostream &out) const {
+			out << "{\n";
+#ifdef __VERSION__
+			out << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+#endif
+			out << "  \"benchmarks\": [\n";
+			for (size_t i = 0; i < m_results.size(); ++i) {
+				const auto &r = m_results[i];
+				out << "    {\"name\": \"" << r.name << "\", \"working_set\": " << r.working_set
+					<< ", \"ns_per_op\": " << setprecision(6) << r.ns_per_op
+					<< ", \"ops_per_sec\": " << r.ops_per_sec
+					<< ", \"gb_per_sec\": " << r.gb_per_sec << "}"
+					<< (i + 1 < m_results.size() ? ",\n" : "\n");
+			}
+			out << "  ]\n}\n";
+		}
+	};
+
+
+	template <typename T>
+	void vec_benchmarks(suite &s, const std::string &t) {
+		s.binary<basic_vec<T, 2>, basic_vec<T, 2>>("vec2" + t + " add", [](const auto &a, const auto &b) { return a + b; });
+		s.binary<basic_vec<T, 3>, basic_vec<T, 3>>("vec3" + t + " add", [](const auto &a, const auto &b) { return a + b; });
+		s.binary<basic_vec<T, 4>, basic_vec<T, 4>>("vec4" + t + " add", [](const auto &a, const auto &b) { return a + b; });
+		s.binary<basic_vec<T, 4>, basic_vec<T, 4>>("vec4" + t + " mul", [](const auto &a, const auto &b) { return a * b; });
+		s.binary<basic_vec<T, 3>, basic_vec<T, 3>>("vec3" + t + " dot", [](const auto &a, const auto &b) { return dot(a, b); });
+		s.binary<basic_vec<T, 4>, basic_vec<T, 4>>("vec4" + t + " dot", [](const auto &a, const auto &b) { return dot(a, b); });
+		s.binary<basic_vec<T, 3>, basic_vec<T, 3>>("vec3" + t + " cross", [](const auto &a, const auto &b) { return cross(a, b); });
+		s.unary<basic_vec<T, 3>>("vec3" + t + " normalize", [](const auto &a) { return normalize(a); });
+		s.unary<basic_vec<T, 4>>("vec4" + t + " normalize", [](const auto &a) { return normalize(a); });
+	}
+
+	template <typename T>
+	void mat_benchmarks(suite &s, const std::string &t) {
+		s.binary<basic_mat<T, 3, 3>, basic_mat<T, 3, 3>>("mat3" + t + " mul mat3", [](const auto &a, const auto &b) { return a * b; });
+		s.binary<basic_mat<T, 4, 4>, basic_mat<T, 4, 4>>("mat4" + t + " mul mat4", [](const auto &a, const auto &b) { return a * b; });
+		s.binary<basic_mat<T, 3, 3>, basic_vec<T, 3>>("mat3" + t + " mul vec3", [](const auto &a, const auto &b) { return a * b; });
+		s.binary<basic_mat<T, 4, 4>, basic_vec<T, 4>>("mat4" + t + " mul vec4", [](const auto &a, const auto &b) { return a * b; });
+		s.unary<basic_mat<T, 2, 2>>("mat2" + t + " determinant", [](const auto &a) { return determinant(a); });
+		s.unary<basic_mat<T, 3, 3>>("mat3" + t + " determinant", [](const auto &a) { return determinant(a); });
+		s.unary<basic_mat<T, 4, 4>>("mat4" + t + " determinant", [](const auto &a) { return determinant(a); });
+		s.unary<basic_mat<T, 2, 2>>("mat2" + t + " inverse", [](const auto &a) { return inverse(a); });
+		s.unary<basic_mat<T, 3, 3>>("mat3" + t + " inverse", [](const auto &a) { return inverse(a); });
+		s.unary<basic_mat<T, 4, 4>>("mat4" + t + " inverse", [](const auto &a) { return inverse(a); });
+		s.binary<basic_vec<T, 3>, basic_vec<T, 3>>("lookat" + t, [](const auto &a, const auto &b) { return lookat(a, b, basic_vec<T, 3>(0, 1, 0)); });
+		s.bulk("view_projection_batch" + t, sizeof(basic_mat<T, 4, 4>), [](size_t n) {
+			auto v = std::make_shared<std::vector<basic_mat<T, 4, 4>>>(make_values<basic_mat<T, 4, 4>>(n));
+			auto p = std::make_shared<std::vector<basic_mat<T, 4, 4>>>(1, perspective(T(1), T(1.5), T(0.1), T(100)));
+			auto out = std::make_shared<std::vector<basic_mat<T, 4, 4>>>(n);
+			return [=](size_t) {
+				view_projection_batch<T>(*v, *p, *out);
+				do_not_optimize(out->back());
+			};
+		});
+	}
+
+	template <typename T>
+	void quat_benchmarks(suite &s, const std::string &t) {
+		s.binary<basic_quat<T>, basic_quat<T>>("quat" + t + " mul", [](const auto &a, const auto &b) { return a * b; });
+		s.binary<basic_quat<T>, basic_quat<T>>("quat" + t + " slerp", [](const auto &a, const auto &b) { return slerp(a, b, T(0.3)); });
+		s.binary<basic_quat<T>, basic_vec<T, 3>>("quat" + t + " mul vec3", [](const auto &a, const auto &b) { return a * b; });
+		s.binary<basic_quat<T>, basic_vec<T, 3>>("quat" + t + " rotate_unit", [](const auto &a, const auto &b) { return rotate_unit(a, b); });
+		using vec_t = basic_vec<T, 3>;
+		s.bulk("quat" + t + " rotate_batch vec3", sizeof(vec_t), [](size_t n) {
+			const auto q = make_value<basic_quat<T>>();
+			auto v = std::make_shared<std::vector<vec_t>>(make_values<vec_t>(n));
+			return [=](size_t) {
+				rotate_batch<T>(q, *v, *v);
+				do_not_optimize(v->back());
+			};
+		});
+		s.bulk("quat" + t + " rotate_batch soa", sizeof(vec_t), [](size_t n) {
+			const auto q = make_value<basic_quat<T>>();
+			auto x = std::make_shared<std::vector<T>>(make_values<T>(n));
+			auto y = std::make_shared<std::vector<T>>(make_values<T>(n));
+			auto z = std::make_shared<std::vector<T>>(make_values<T>(n));
+			return [=](size_t) {
+				rotate_batch<T>(q, *x, *y, *z, *x, *y, *z);
+				do_not_optimize(x->back());
+			};
+		});
+	}
+
+	template <typename T>
+	void random_benchmarks(suite &s, const std::string &t) {
+		s.generate<T>("random" + t, [] { return random<T>(T(-1), T(1)); });
+		s.generate<basic_vec<T, 3>>("random vec3" + t, [] { return random<basic_vec<T, 3>>(basic_vec<T, 3>(-1), basic_vec<T, 3>(1)); });
+		s.generate<basic_quat<T>>("random quat" + t, [] { return random<basic_quat<T>>(); });
+	}
+
+	template <typename T>
+	void hash_benchmarks(suite &s, const std::string &t) {
+		s.unary<basic_vec<T, 3>>("hash vec3" + t, [](const auto &a) { return std::hash<basic_vec<T, 3>>{}(a); });
+		s.unary<basic_mat<T, 4, 4>>("hash mat4" + t, [](const auto &a) { return std::hash<basic_mat<T, 4, 4>>{}(a); });
+		s.unary<basic_quat<T>>("hash quat" + t, [](const auto &a) { return std::hash<basic_quat<T>>{}(a); });
+	}
+
+	template <typename T>
+	void format_benchmarks(suite &s, const std::string &t) {
+		std::ostringstream out;
+		s.unary<basic_mat<T, 4, 4>>("format mat4" + t, [&](const auto &a) {
+			out.seekp(0);
+			out << a;
+			return out.tellp();
+		});
+		s.unary<basic_mat<T, 4, 4>>("format mat4" + t + " compact", [&](const auto &a) {
+			out.seekp(0);
+			out << compact << a << nocompact;
+			return out.tellp();
+		});
+	}
+
+	template <typename T>
+	void noise_benchmarks(suite &s, const std::string &t) {
+		s.unary<basic_vec<T, 2>>("perlin vec2" + t, [](const auto &a) { return perlin(a * T(8)); });
+		s.unary<basic_vec<T, 3>>("perlin vec3" + t, [](const auto &a) { return perlin(a * T(8)); });
+		s.unary<basic_vec<T, 3>>("simplex vec3" + t, [](const auto &a) { return simplex(a * T(8)); });
+		s.unary<basic_vec<T, 4>>("simplex vec4" + t, [](const auto &a) { return simplex(a * T(8)); });
+		s.unary<basic_vec<T, 3>>("simplex_grad vec3" + t, [](const auto &a) { return simplex_grad(a * T(8)).value; });
+		s.unary<basic_vec<T, 3>>("worley vec3" + t, [](const auto &a) { return worley(a * T(8)); });
+		s.bulk("simplex_batch vec3" + t, 4 * sizeof(T), [](size_t n) {
+			auto x = std::make_shared<std::vector<T>>(make_values<T>(n));
+			auto y = std::make_shared<std::vector<T>>(make_values<T>(n));
+			auto z = std::make_shared<std::vector<T>>(make_values<T>(n));
+			auto out = std::make_shared<std::vector<T>>(n);
+			return [=](size_t) {
+				simplex_batch<T>(*x, *y, *z, *out);
+				do_not_optimize(out->back());
+			};
+		});
+		s.bulk("perlin_batch vec3" + t, 4 * sizeof(T), [](size_t n) {
+			auto x = std::make_shared<std::vector<T>>(make_values<T>(n));
+			auto y = std::make_shared<std::vector<T>>(make_values<T>(n));
+			auto z = std::make_shared<std::vector<T>>(make_values<T>(n));
+			auto out = std::make_shared<std::vector<T>>(n);
+			return [=](size_t) {
+				perlin_batch<T>(*x, *y, *z, *out);
+				do_not_optimize(out->back());
+			};
+		});
+	}
+
+	template <typename T>
+	void spline_benchmarks(suite &s, const std::string &t) {
+		using vec_t = basic_vec<T, 3>;
+		auto make_spline = [] {
+			const auto pts = make_values<vec_t>(64);
+			return basic_spline<T, 3>::catmull_rom(pts);
+		};
+		s.bulk("spline eval vec3" + t, sizeof(vec_t), [=](size_t n) {
+			auto sp = std::make_shared<basic_spline<T, 3>>(make_spline());
+			auto out = std::make_shared<std::vector<vec_t>>(n);
+			return [=](size_t) {
+				const T h = n > 1 ? T(sp->size()) / T(n - 1) : T(0);
+				for (size_t i = 0; i < n; ++i) (*out)[i] = (*sp)(T(i) * h);
+				do_not_optimize(out->back());
+			};
+		});
+		s.bulk("spline sample_n vec3" + t, sizeof(vec_t), [=](size_t n) {
+			auto sp = std::make_shared<basic_spline<T, 3>>(make_spline());
+			auto out = std::make_shared<std::vector<vec_t>>(n);
+			return [=](size_t) {
+				sample_n(*sp, n, span<vec_t>(*out));
+				do_not_optimize(out->back());
+			};
+		});
+	}
+
+	template <typename T>
+	void decompose_benchmarks(suite &s, const std::string &t) {
+		using mat_t = basic_mat<T, 3, 3>;
+		s.unary<mat_t>("svd mat3" + t, [](const auto &a) { return svd(a).sigma; });
+		s.unary<mat_t>("polar mat3" + t, [](const auto &a) { return polar(a).r; });
+		s.bulk("svd_batch mat3" + t, sizeof(mat_t), [](size_t n) {
+			auto a = std::make_shared<std::vector<mat_t>>(make_values<mat_t>(n));
+			auto u = std::make_shared<std::vector<mat_t>>(n);
+			auto v = std::make_shared<std::vector<mat_t>>(n);
+			auto sigma = std::make_shared<std::vector<basic_vec<T, 3>>>(n);
+			return [=](size_t) {
+				svd_batch<T>(*a, *u, *sigma, *v);
+				do_not_optimize(sigma->back());
+			};
+		});
+		using mat4_t = basic_mat<T, 4, 4>;
+		s.unary<mat4_t>("decompose_trs mat4" + t, [](const auto &m) { return decompose_trs(m).rotation; });
+		s.bulk("decompose_trs_batch mat4" + t, sizeof(mat4_t), [](size_t n) {
+			auto m = std::make_shared<std::vector<mat4_t>>(make_values<mat4_t>(n));
+			auto d = std::make_shared<std::vector<trs_result<T>>>(n);
+			return [=](size_t) {
+				decompose_trs_batch<T>(*m, *d);
+				do_not_optimize(d->back());
+			};
+		});
+	}
+
+	// random trees, touching every node or 5% of them before each update
+	// the partial case touches the newer half of the nodes, which are mostly leaves
+	template <typename T>
+	void hierarchy_benchmarks(suite &s, const std::string &t) {
+		using hierarchy_t = transform_hierarchy<T>;
+		using index_t = typename hierarchy_t::index_t;
+		for (bool partial : {false, true}) {
+			s.bulk(std::string("transform_hierarchy update ") + (partial ? "5%" : "all") + t, sizeof(basic_mat<T, 4, 4>), [partial](size_t n) {
+				std::vector<index_t> parents(n, hierarchy_t::npos);
+				for (size_t i = 1; i < n; ++i) parents[i] = index_t(random<int>(0, int(i) - 1));
+				auto h = std::make_shared<hierarchy_t>(parents);
+				const auto m = make_value<basic_mat<T, 4, 4>>();
+				const size_t first = partial ? n / 2 : 0, step = partial ? 10 : 1;
+				return [=](size_t) {
+					for (size_t i = first; i < n; i += step) h->local(index_t(i), m);
+					do_not_optimize(h->update());
+				};
+			});
+		}
+	}
+
+	void df64_benchmarks(suite &s) {
+		s.bulk("df64 camera_relative_batch", sizeof(dfvec3), [](size_t n) {
+			auto p = std::make_shared<std::vector<dfvec3>>(n);
+			for (auto &x : *p) x = dfvec3(make_value<dvec3>() * 6.4e6);
+			auto out = std::make_shared<std::vector<vec3>>(n);
+			const dfvec3 eye(dvec3(6.4e6, 0, 0));
+			return [=](size_t) {
+				camera_relative_batch(*p, eye, *out);
+				do_not_optimize(out->back());
+			};
+		});
+	}
+
+	void fixed_benchmarks(suite &s) {
+		using fx = cgra::fixed<16, 16>;
+		const auto to_fixed = [](float x) { return fx::from_raw(std::int32_t(x * 65536.f)); };
+		s.unary<float>("fixed sin", [=](float a) { return sin(to_fixed(a)); });
+		s.unary<float>("fixed sqrt", [=](float a) { return sqrt(to_fixed(std::abs(a))); });
+		s.binary<float, float>("fixed atan2", [=](float a, float b) { return atan(to_fixed(a), to_fixed(b)); });
+		s.binary<vec3, vec3>("xvec3 dot", [=](const vec3 &a, const vec3 &b) {
+			return dot(xvec3(to_fixed(a.x), to_fixed(a.y), to_fixed(a.z)), xvec3(to_fixed(b.x), to_fixed(b.y), to_fixed(b.z)));
+		});
+		s.bulk("fixed dot_batch", 7 * sizeof(fx), [=](size_t n) {
+			auto v = std::make_shared<std::vector<fx>>(7 * n);
+			for (auto &x : *v) x = to_fixed(make_value<float>());
+			return [=](size_t) {
+				const fx *p = v->data();
+				dot_batch<fx>({p, n}, {p + n, n}, {p + 2 * n, n}, {p + 3 * n, n}, {p + 4 * n, n}, {p + 5 * n, n}, {v->data() + 6 * n, n});
+				do_not_optimize(v->back());
+			};
+		});
+	}
+
+	template <typename T>
+	void reduction_benchmarks(suite &s, const std::string &t) {
+		using vec_t = basic_vec<T, 64>;
+		s.unary<vec_t>("sum64" + t + " sequential", [](const auto &a) { return sum(a, reduction::sequential()); });
+		s.unary<vec_t>("sum64" + t + " pairwise", [](const auto &a) { return sum(a, reduction::pairwise()); });
+		s.unary<vec_t>("sum64" + t + " kahan", [](const auto &a) { return sum(a, reduction::kahan()); });
+		s.binary<vec_t, vec_t>("dot64" + t + " pairwise", [](const auto &a, const auto &b) { return dot(a, b, reduction::pairwise()); });
+	}
+
+	template <typename T>
+	void scratch_benchmarks(suite &s, const std::string &t) {
+		s.scratch<T>("scratch vector" + t, [](size_t n) { return std::vector<T>(n); });
+		frame_arena arena(1);
+		s.scratch<T>("scratch arena" + t, [&](size_t n) {
+			arena.reset();
+			return arena.alloc<T>(n);
+		});
+	}
+}
+
+// usage: cgra_math_bench [--json <file>] [--filter <substring>] [--quick]
+int main(int argc, char *argv[]) {
+	options opt;
+	std::string json_path;
+	for (int i = 1; i < argc; ++i) {
+		if (!std::strcmp(argv[i], "--json") && i + 1 < argc) {
+			json_path = argv[++i];
+		} else if (!std::strcmp(argv[i], "--filter") && i + 1 < argc) {
+			opt.filter = argv[++i];
+		} else if (!std::strcmp(argv[i], "--quick")) {
+			opt.min_time = 0.01;
+			opt.trials = 1;
+		} else {
+			cerr << "usage: " << argv[0] << " [--json <file>] [--filter <substring>] [--quick]" << endl;
+			return 1;
+		}
+	}
+
+	suite s(opt);
+	vec_benchmarks<float>(s, "");
+	vec_benchmarks<double>(s, "d");
+	mat_benchmarks<float>(s, "");
+	mat_benchmarks<double>(s, "d");
+	quat_benchmarks<float>(s, "");
+	quat_benchmarks<double>(s, "d");
+	random_benchmarks<float>(s, "");
+	hash_benchmarks<float>(s, "");
+	format_benchmarks<float>(s, "");
+	noise_benchmarks<float>(s, "");
+	spline_benchmarks<float>(s, "");
+	decompose_benchmarks<float>(s, "");
+	hierarchy_benchmarks<float>(s, "");
+	df64_benchmarks(s);
+	fixed_benchmarks(s);
+	reduction_benchmarks<float>(s, "");
+	reduction_benchmarks<double>(s, "d");
+	scratch_benchmarks<basic_mat<float, 4, 4>>(s, " mat4");
+	scratch_benchmarks<basic_vec<float, 3>>(s, " vec3");
+
+	if (json_path == "-") {
+		s.write_json(cout);
+	} else if (!json_path.empty()) {
+		std::ofstream out(json_path);
+		s.write_json(out);
+	}
+}
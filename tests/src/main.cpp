@@ -30,6 +30,23 @@ void rotation_angle() {
 
 int main() {
 	test::run_basic_vec_tests();
+	test::run_transform_tests();
+	test::run_spatial_hash_tests();
+	test::run_geometry_tests();
+	test::run_bvh_tests();
+	test::run_sections_tests();
+	test::run_memory_tests();
+	test::run_view_tests();
+	test::run_binary_tests();
+	test::run_io_tests();
+	test::run_noise_tests();
+	test::run_spline_tests();
+	test::run_decompose_tests();
+	test::run_transform_hierarchy_tests();
+	test::run_camera_tests();
+	test::run_df64_tests();
+	test::run_reduction_tests();
+	test::run_fixed_tests();
 
 	using vec2x3 = basic_vec<basic_vec<float, 3>, 2>;
 
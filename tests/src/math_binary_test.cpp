@@ -0,0 +1,126 @@
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_binary.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 100;
+
+	const std::string test_path = "cgra_math_binary_test.bin";
+
+
+	// what the streaming writer writes, the mapped file reads back bit-exact and aligned
+	template <typename ElemT>
+	float write_map_roundtrip() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			vector<ElemT> es(size_t(random<int>(0, 500)));
+			for (auto &e : es) e = random<ElemT>();
+			{
+				binary_writer<ElemT> w(test_path);
+				const size_t half = es.size() / 2;
+				for (size_t j = 0; j < half; j++) w.write(es[j]);
+				w.write(span<const ElemT>(es).subspan(half, es.size() - half));
+			}
+			binary_file f(test_path);
+			auto s = f.elements<ElemT>();
+			if (s.size() != es.size() || f.header().count != es.size()) {
+				fail_count++;
+				continue;
+			}
+			if (reinterpret_cast<uintptr_t>(s.data()) % binary_header::data_alignment) fail_count++;
+			for (size_t j = 0; j < es.size(); j++) {
+				if (std::memcmp(&s[j], &es[j], sizeof(ElemT)) != 0) {
+					fail_count++;
+					break;
+				}
+			}
+		}
+		std::remove(test_path.c_str());
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// a mismatched element type or damaged file is rejected
+	float rejects_bad_files() {
+		int fail_count = 0;
+		auto expect_error = [&](auto f) {
+			try {
+				f();
+				fail_count++;
+			} catch (binary_format_error &) { }
+		};
+		write_binary(test_path, span<const vec3>(vector<vec3>(10, vec3(1))));
+		{
+			binary_file f(test_path);
+			expect_error([&] { f.elements<vec4>(); });
+			expect_error([&] { f.elements<dvec3>(); });
+			expect_error([&] { f.elements<mat3>(); });
+		}
+		{
+			// truncate the data
+			auto bytes = vector<char>(64 + 10 * sizeof(vec3) - 1);
+			ifstream(test_path, ios::binary).read(bytes.data(), streamsize(bytes.size()));
+			ofstream(test_path, ios::binary | ios::trunc).write(bytes.data(), streamsize(bytes.size()));
+			expect_error([&] { binary_file f(test_path); });
+			bytes[0] = 'X';
+			ofstream(test_path, ios::binary | ios::trunc).write(bytes.data(), streamsize(bytes.size()));
+			expect_error([&] { binary_file f(test_path); });
+		}
+		expect_error([&] { binary_file f(test_path + ".missing"); });
+		std::remove(test_path.c_str());
+		return float(fail_count);
+	}
+
+
+	// files of the other byte order are rejected by the mapping but converted by read_binary
+	float read_other_endian() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			vector<quat> qs(size_t(random<int>(1, 50)));
+			for (auto &q : qs) q = random<quat>();
+			binary_header h = detail::make_binary_header<quat>(qs.size());
+			detail::byteswap_header(h);
+			std::ostringstream out;
+			out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+			for (const auto &q : qs) {
+				for (float x : {q.w, q.x, q.y, q.z}) {
+					x = detail::byteswap(x);
+					out.write(reinterpret_cast<const char *>(&x), sizeof(x));
+				}
+			}
+			std::istringstream in(out.str());
+			const vector<quat> r = read_binary<quat>(in);
+			if (r.size() != qs.size()) {
+				fail_count++;
+				continue;
+			}
+			for (size_t j = 0; j < qs.size(); j++) {
+				if (std::memcmp(&r[j], &qs[j], sizeof(quat)) != 0) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+}
+
+
+void test::run_binary_tests() {
+	ouput_test("binary roundtrip<vec3>", write_map_roundtrip<vec3>());
+	ouput_test("binary roundtrip<dmat4>", write_map_roundtrip<dmat4>());
+	ouput_test("binary roundtrip<quat>", write_map_roundtrip<quat>());
+	ouput_test("binary roundtrip<ivec2>", write_map_roundtrip<ivec2>());
+	ouput_test("binary rejects_bad_files", rejects_bad_files());
+	ouput_test("binary read_other_endian", read_other_endian());
+}
@@ -0,0 +1,166 @@
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_bvh.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 200;
+	constexpr int num_prims = 3000;
+
+	using vec3_t = basic_vec<float, 3>;
+
+
+	std::vector<bvh::triangle> random_triangles(int count) {
+		std::vector<bvh::triangle> tris;
+		for (int i = 0; i < count; ++i) {
+			const vec3_t c = random<vec3_t>(vec3_t(-10), vec3_t(10));
+			tris.push_back(bvh::triangle{
+				c + random<vec3_t>(vec3_t(-0.5f), vec3_t(0.5f)),
+				c + random<vec3_t>(vec3_t(-0.5f), vec3_t(0.5f)),
+				c + random<vec3_t>(vec3_t(-0.5f), vec3_t(0.5f))
+			});
+		}
+		return tris;
+	}
+
+	basic_ray<float, 3> random_ray() {
+		return basic_ray<float, 3>{random<vec3_t>(vec3_t(-15), vec3_t(15)), random<vec3_t>(vec3_t(-1), vec3_t(1))};
+	}
+
+	bvh::hit brute_force_intersect(const std::vector<bvh::triangle> &tris, const basic_ray<float, 3> &r) {
+		bvh::hit h;
+		for (size_t i = 0; i < tris.size(); ++i) {
+			bvh::detail::intersect_triangle(r, tris[i], bvh::index_t(i), h);
+		}
+		return h;
+	}
+
+
+	template <typename TreeT>
+	float ray_cast_brute_force(const std::vector<bvh::triangle> &tris, const TreeT &t) {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto r = random_ray();
+			const auto expected = brute_force_intersect(tris, r);
+			const auto h = bvh::intersect(t, tris, r);
+			if (h.prim != expected.prim || (h && !test_equal(h.t, expected.t))) fail_count++;
+			if (bvh::occluded(t, tris.data(), r) != bool(expected)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename TreeT>
+	float overlap_brute_force(const std::vector<basic_aabb<float, 3>> &bounds, const TreeT &t) {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto box = inflate(basic_aabb<float, 3>{random<vec3_t>(vec3_t(-10), vec3_t(10))}, random<float>(0.f, 3.f));
+			std::vector<bvh::index_t> expected, result;
+			for (size_t j = 0; j < bounds.size(); ++j) {
+				if (overlaps(bounds[j], box)) expected.push_back(bvh::index_t(j));
+			}
+			bvh::overlap(t, bounds.data(), box, result);
+			std::sort(result.begin(), result.end());
+			if (result != expected) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	float parallel_build_matches_serial() {
+		const auto tris = random_triangles(100000);
+		bvh::build_options serial, parallel;
+		serial.threads = 1;
+		parallel.threads = 4;
+		const auto a = bvh::build(tris, serial);
+		const auto b = bvh::build(tris, parallel);
+		int fail_count = 0;
+		if (a.nodes.size() != b.nodes.size()) fail_count = max_iter;
+		for (int i = 0; i < max_iter && !fail_count; ++i) {
+			const auto r = random_ray();
+			if (bvh::intersect(a, tris, r).prim != bvh::intersect(b, tris, r).prim) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	float nearest_point_brute_force() {
+		std::vector<vec3_t> points;
+		for (int i = 0; i < num_prims; ++i) points.push_back(random<vec3_t>(vec3_t(-10), vec3_t(10)));
+		const auto t = bvh::build(points);
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec3_t q = random<vec3_t>(vec3_t(-12), vec3_t(12));
+			float best = std::numeric_limits<float>::infinity();
+			for (const auto &p : points) best = std::min(best, dot(p - q, p - q));
+			const auto n = bvh::nearest_point(t, points, q);
+			if (n == bvh::npos || !test_equal(dot(points[n] - q, points[n] - q), best)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	int tree_depth(const bvh::tree &t, bvh::index_t ni = 0) {
+		const bvh::node &n = t.nodes[ni];
+		if (n.is_leaf()) return 0;
+		return 1 + std::max(tree_depth(t, n.left_first), tree_depth(t, n.left_first + 1));
+	}
+
+	// points spaced by powers of two with two bins make every SAH split peel off the farthest
+	// few, which used to grow the tree past max_depth; queries must stay correct as well
+	float skewed_build_depth() {
+		std::vector<vec3_t> points;
+		for (int i = -120; i < 120; ++i) points.push_back(vec3_t(std::ldexp(1.f, i)));
+		bvh::build_options opts;
+		opts.bins = 2;
+		const auto t = bvh::build(points, opts);
+		int fail_count = 0;
+		if (tree_depth(t) > bvh::max_depth) fail_count += max_iter;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec3_t q = vec3_t(std::ldexp(random<float>(1, 2), random<int>(-120, 120)));
+			float best = std::numeric_limits<float>::infinity();
+			for (const auto &p : points) best = std::min(best, dot(p - q, p - q));
+			const auto n = bvh::nearest_point(t, points, q);
+			if (n == bvh::npos || !test_equal(dot(points[n] - q, points[n] - q), best)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+}
+
+
+void test::run_bvh_tests() {
+	const auto tris = random_triangles(num_prims);
+	std::vector<basic_aabb<float, 3>> bounds;
+	for (const auto &tri : tris) bounds.push_back(tri.bounds());
+
+	bvh::build_options serial;
+	serial.threads = 1;
+	const auto t = bvh::build(tris, serial);
+	bvh::build_options parallel;
+	parallel.threads = 4;
+	const auto tp = bvh::build(tris, parallel);
+
+	ouput_test("bvh ray_cast binary", ray_cast_brute_force(tris, t));
+	ouput_test("bvh ray_cast binary parallel build", ray_cast_brute_force(tris, tp));
+	ouput_test("bvh parallel_build_matches_serial", parallel_build_matches_serial());
+	ouput_test("bvh ray_cast 4-wide", ray_cast_brute_force(tris, bvh::collapse<4>(t)));
+	ouput_test("bvh ray_cast 8-wide", ray_cast_brute_force(tris, bvh::collapse<8>(t)));
+	ouput_test("bvh overlap binary", overlap_brute_force(bounds, t));
+	ouput_test("bvh overlap 8-wide", overlap_brute_force(bounds, bvh::collapse<8>(t)));
+	ouput_test("bvh nearest_point", nearest_point_brute_force());
+	ouput_test("bvh skewed_build_depth", skewed_build_depth());
+}
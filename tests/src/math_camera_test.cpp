@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_camera.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+
+	template <typename T>
+	T max_diff(const basic_mat<T, 4, 4> &a, const basic_mat<T, 4, 4> &b) {
+		T d = 0;
+		for (size_t j = 0; j < 4; ++j) {
+			for (size_t i = 0; i < 4; ++i) d = std::max(d, std::abs(a[j][i] - b[j][i]));
+		}
+		return d;
+	}
+
+	dvec3 random_point() {
+		return random<dvec3>(dvec3(-10), dvec3(10));
+	}
+
+
+	// the closed form lookat is the inverse of the camera frame, and puts focus on the -z axis
+	float lookat_inverts_frame() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const dvec3 eye = random_point(), focus = random_point(), up = normalize(random_point());
+			const dmat4 v = lookat(eye, focus, up);
+			const dvec3 vz = normalize(eye - focus);
+			const dvec3 vx = normalize(cross(up, vz));
+			dmat4 frame{dvec4(vx, 0), dvec4(cross(vz, vx), 0), dvec4(vz, 0), dvec4(eye, 1)};
+			if (max_diff(v, inverse(frame)) > 1e-9) fail_count++;
+			const dvec4 f = v * dvec4(focus, 1);
+			if (std::abs(f.x) > 1e-9 || std::abs(f.y) > 1e-9 || std::abs(f.z + length(focus - eye)) > 1e-9) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// batches match the scalar builders, including one-element spans used for every output
+	float batches_match_scalar() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			const size_t n = size_t(random<int>(1, 100));
+			std::vector<dvec3> eye(n), focus(n);
+			std::vector<double> fovy(n), aspect(n);
+			for (size_t k = 0; k < n; ++k) {
+				eye[k] = random_point();
+				focus[k] = random_point();
+				fovy[k] = random<double>(0.2, 2.5);
+				aspect[k] = random<double>(0.5, 2.0);
+			}
+			const std::vector<dvec3> up{dvec3(0, 1, 0)};
+			const std::vector<double> znear{0.1}, zfar{100.0};
+			std::vector<dmat4> views(n), projs(n), vps(n);
+			lookat_batch<double>(eye, focus, up, views);
+			perspective_batch<double>(fovy, aspect, znear, zfar, projs, clip_depth::reversed);
+			view_projection_batch<double>(views, projs, vps);
+			for (size_t k = 0; k < n; ++k) {
+				const dmat4 v = lookat(eye[k], focus[k], up[0]);
+				const dmat4 p = perspective(fovy[k], aspect[k], 0.1, 100.0, clip_depth::reversed);
+				if (max_diff(views[k], v) > 0 || max_diff(projs[k], p) > 0 || max_diff(vps[k], p * v) > 1e-12 * 100) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+
+
+	// each cube face view matches lookat down that axis, and the six faces cover every direction once
+	float cube_faces_match_lookat() {
+		int fail_count = 0;
+		const dvec3 dirs[6] {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+		const dvec3 ups[6] {{0, -1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}, {0, -1, 0}, {0, -1, 0}};
+		const dmat4 proj = cube_face_projection(0.1, 100.0);
+		for (int i = 0; i < max_iter / 10; ++i) {
+			const dvec3 eye = random_point();
+			const auto views = cube_face_views(eye);
+			std::vector<dmat4> batch(12);
+			const std::vector<dvec3> eyes{eye, eye};
+			cube_face_views_batch<double>(eyes, batch);
+			for (size_t f = 0; f < 6; ++f) {
+				if (max_diff(views[f], lookat(eye, eye + dirs[f], ups[f])) > 1e-12 * 100) fail_count++;
+				if (max_diff(batch[f], views[f]) > 0 || max_diff(batch[6 + f], views[f]) > 0) fail_count++;
+			}
+			const dvec3 d = normalize(random_point());
+			int inside = 0;
+			for (size_t f = 0; f < 6; ++f) {
+				const dvec4 c = proj * views[f] * dvec4(eye + d, 1);
+				if (c.w > 0 && std::abs(c.x) < c.w && std::abs(c.y) < c.w) inside++;
+			}
+			if (inside != 1) fail_count++;
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+
+
+	// splits run from near to far, and lambda 0 and 1 give the uniform and logarithmic schemes
+	float cascade_splits_blend() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const double n = random<double>(0.01, 1.0), f = n * random<double>(2.0, 10000.0);
+			std::vector<double> s(size_t(random<int>(2, 8))), u(s.size()), l(s.size());
+			const size_t c = s.size() - 1;
+			cascade_splits(n, f, random<double>(0.0, 1.0), span<double>(s));
+			cascade_splits(n, f, 0.0, span<double>(u));
+			cascade_splits(n, f, 1.0, span<double>(l));
+			if (s.front() != n || s.back() != f) fail_count++;
+			for (size_t k = 0; k < c; ++k) {
+				if (!(s[k] < s[k + 1])) fail_count++;
+				if (!(l[k] <= s[k] + 1e-9 * f && s[k] <= u[k] + 1e-9 * f)) fail_count++;
+			}
+			for (size_t k = 0; k <= c; ++k) {
+				if (std::abs(u[k] - (n + (f - n) * double(k) / double(c))) > 1e-9 * f) fail_count++;
+				if (std::abs(l[k] - n * std::pow(f / n, double(k) / double(c))) > 1e-9 * f) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+}
+
+
+void test::run_camera_tests() {
+	ouput_test("camera lookat_inverts_frame", lookat_inverts_frame());
+	ouput_test("camera batches_match_scalar", batches_match_scalar());
+	ouput_test("camera cube_faces_match_lookat", cube_faces_match_lookat());
+	ouput_test("camera cascade_splits_blend", cascade_splits_blend());
+}
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_decompose.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+
+	template <typename T>
+	T tolerance() {
+		return sizeof(T) > 4 ? T(1e-12) : T(1e-4);
+	}
+
+	template <typename T, size_t N>
+	T max_diff(const basic_mat<T, N, N> &a, const basic_mat<T, N, N> &b) {
+		T d = 0;
+		for (size_t j = 0; j < N; ++j) {
+			for (size_t i = 0; i < N; ++i) {
+				const T x = std::abs(a[j][i] - b[j][i]);
+				if (!(x <= d)) d = x;
+			}
+		}
+		return d;
+	}
+
+	template <typename T, size_t N>
+	basic_mat<T, N, N> diagonal(const basic_vec<T, N> &v) {
+		basic_mat<T, N, N> m(T(0));
+		for (size_t i = 0; i < N; ++i) m[i][i] = v[i];
+		return m;
+	}
+
+	template <typename T, size_t N>
+	bool is_rotation(const basic_mat<T, N, N> &m) {
+		return max_diff(m * transpose(m), basic_mat<T, N, N>(T(1))) <= tolerance<T>() && determinant(m) > T(0);
+	}
+
+	// random matrices, every few of them singular or with negative determinant
+	template <typename T, size_t N>
+	basic_mat<T, N, N> random_matrix(int i) {
+		basic_mat<T, N, N> m;
+		for (size_t j = 0; j < N; ++j) {
+			for (size_t k = 0; k < N; ++k) m[j][k] = random<T>(T(-1), T(1));
+		}
+		if (i % 4 == 1) m[N - 1] = m[0] * T(2);
+		if (i % 4 == 2) m[0] = -m[0];
+		return m;
+	}
+
+
+	template <typename T, size_t N>
+	float qr_reconstructs() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto a = random_matrix<T, N>(i);
+			const auto d = qr(a);
+			if (max_diff(d.q * d.r, a) > tolerance<T>()) fail_count++;
+			if (max_diff(d.q * transpose(d.q), basic_mat<T, N, N>(T(1))) > tolerance<T>()) fail_count++;
+			for (size_t j = 0; j < N; ++j) {
+				for (size_t k = j + 1; k < N; ++k) {
+					if (d.r[j][k] != T(0)) fail_count++;
+				}
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T, size_t N>
+	float eigen_reconstructs() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto m = random_matrix<T, N>(i);
+			const auto a = m + transpose(m);
+			const auto d = eigen_symmetric(a);
+			if (max_diff(d.vectors * diagonal(d.values) * transpose(d.vectors), a) > tolerance<T>() * 10) fail_count++;
+			if (max_diff(d.vectors * transpose(d.vectors), basic_mat<T, N, N>(T(1))) > tolerance<T>()) fail_count++;
+			for (size_t k = 0; k + 1 < N; ++k) {
+				if (d.values[k] < d.values[k + 1]) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// u and v are rotations, sigma is sorted and only its last entry may be negative
+	template <typename T, size_t N>
+	float svd_reconstructs() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto a = random_matrix<T, N>(i);
+			const auto d = svd(a);
+			if (max_diff(d.u * diagonal(d.sigma) * transpose(d.v), a) > tolerance<T>() * 10) fail_count++;
+			if (!is_rotation(d.u) || !is_rotation(d.v)) fail_count++;
+			for (size_t k = 0; k + 1 < N; ++k) {
+				if (d.sigma[k] < T(0) || d.sigma[k] < std::abs(d.sigma[k + 1]) - tolerance<T>()) fail_count++;
+			}
+			if (d.sigma[N - 1] < -tolerance<T>() && determinant(a) > T(0)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T, size_t N>
+	float polar_reconstructs() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto a = random_matrix<T, N>(i);
+			const auto d = polar(a);
+			if (max_diff(d.r * d.s, a) > tolerance<T>() * 10) fail_count++;
+			if (!is_rotation(d.r)) fail_count++;
+			if (max_diff(d.s, transpose(d.s)) > tolerance<T>()) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// the lane-blocked batches agree with the scalar functions, including partial blocks
+	template <typename T>
+	float batch_matches_scalar() {
+		using mat_t = basic_mat<T, 3, 3>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 100; ++i) {
+			const size_t n = size_t(random<int>(1, 200));
+			std::vector<mat_t> a(n), u(n), v(n), r(n), s(n);
+			std::vector<basic_vec<T, 3>> sigma(n);
+			for (size_t k = 0; k < n; ++k) a[k] = random_matrix<T, 3>(int(k));
+			svd_batch<T>(a, u, sigma, v, i % 2 ? 0 : 1);
+			polar_batch<T>(a, r, s);
+			for (size_t k = 0; k < n; ++k) {
+				const auto d = svd(a[k]);
+				const auto p = polar(a[k]);
+				const T tol = tolerance<T>();
+				if (max_diff(u[k], d.u) > tol || max_diff(v[k], d.v) > tol || max_diff(diagonal(sigma[k]), diagonal(d.sigma)) > tol) fail_count++;
+				if (max_diff(r[k], p.r) > tol || max_diff(s[k], p.s) > tol) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T>
+	basic_quat<T> random_rotation() {
+		return normalize(basic_quat<T>(random<T>(T(-1), T(1)), random<T>(T(-1), T(1)), random<T>(T(-1), T(1)), random<T>(T(-1), T(1))));
+	}
+
+	template <typename T>
+	bool same_rotation(const basic_quat<T> &a, const basic_quat<T> &b) {
+		return std::abs(std::abs(dot(a, b)) - T(1)) <= tolerance<T>();
+	}
+
+
+	// quat_from_matrix inverts rotate3, including rotations near 180 degrees where w is small
+	template <typename T>
+	float quat_from_matrix_inverts() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			basic_quat<T> q = random_rotation<T>();
+			if (i % 4 == 1) q.w = T(0);
+			if (i % 4 == 2) q.w = T(1e-3);
+			q = normalize(q);
+			const auto p = quat_from_matrix(rotate3(q));
+			if (!same_rotation(p, q) || p.w < T(0)) fail_count++;
+			if (!same_rotation(quat_from_matrix(basic_mat<T, 3, 3>(q)), q)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// compose_trs matches the product of its parts and decompose_trs recovers them
+	template <typename T>
+	float trs_round_trip() {
+		using vec_t = basic_vec<T, 3>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec_t t = random<vec_t>(vec_t(-10), vec_t(10));
+			const basic_quat<T> q = random_rotation<T>();
+			vec_t s = random<vec_t>(vec_t(T(0.1)), vec_t(T(4)));
+			if (i % 4 == 1) s[0] = -s[0];
+			const auto m = compose_trs(t, q, s);
+			if (max_diff(m, translate3(t) * rotate3(q) * scale3(s)) > tolerance<T>() * 10) fail_count++;
+			const auto d = decompose_trs(m);
+			if (max_diff(compose_trs(d), m) > tolerance<T>() * 10) fail_count++;
+			if (length(d.translation - t) > tolerance<T>()) fail_count++;
+			if (i % 4 != 1 && (length(d.scale - s) > tolerance<T>() * 10 || !same_rotation(d.rotation, q))) fail_count++;
+			// a zero scale still gives a unit rotation and reconstructs the matrix
+			vec_t z = s;
+			z[i % 3] = T(0);
+			const auto dz = decompose_trs(compose_trs(t, q, z));
+			if (std::abs(abs(dz.rotation) - T(1)) > tolerance<T>() || max_diff(compose_trs(dz), compose_trs(t, q, z)) > tolerance<T>() * 10) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T>
+	float trs_batch_matches_scalar() {
+		using mat_t = basic_mat<T, 4, 4>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 100; ++i) {
+			const size_t n = size_t(random<int>(1, 200));
+			std::vector<mat_t> m(n), c(n), r(n);
+			std::vector<trs_result<T>> d(n);
+			std::vector<basic_quat<T>> q(n);
+			for (size_t k = 0; k < n; ++k) {
+				m[k] = compose_trs(random<basic_vec<T, 3>>(basic_vec<T, 3>(-10), basic_vec<T, 3>(10)), random_rotation<T>(), random<basic_vec<T, 3>>(basic_vec<T, 3>(T(0.1)), basic_vec<T, 3>(T(4))));
+				r[k] = rotate3(random_rotation<T>());
+			}
+			decompose_trs_batch<T>(m, d, i % 2 ? 0 : 1);
+			compose_trs_batch<T>(d, c);
+			quat_from_matrix_batch<T, 4>(r, q);
+			for (size_t k = 0; k < n; ++k) {
+				const auto e = decompose_trs(m[k]);
+				if (length(d[k].translation - e.translation) > tolerance<T>() || length(d[k].scale - e.scale) > tolerance<T>() || !same_rotation(d[k].rotation, e.rotation)) fail_count++;
+				if (max_diff(c[k], compose_trs(e)) > tolerance<T>()) fail_count++;
+				if (!same_rotation(q[k], quat_from_matrix(r[k]))) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// the (w, xyz) constructor keeps every component
+	float quat_vector_ctor() {
+		const dquat q(1, dvec3(2, 3, 4));
+		return (q.w == 1 && q.x == 2 && q.y == 3 && q.z == 4) ? 0.f : 1.f;
+	}
+}
+
+
+void test::run_decompose_tests() {
+	ouput_test("decompose qr<float, 3>", qr_reconstructs<float, 3>());
+	ouput_test("decompose qr<double, 4>", qr_reconstructs<double, 4>());
+	ouput_test("decompose eigen_symmetric<float, 3>", eigen_reconstructs<float, 3>());
+	ouput_test("decompose eigen_symmetric<double, 2>", eigen_reconstructs<double, 2>());
+	ouput_test("decompose eigen_symmetric<double, 4>", eigen_reconstructs<double, 4>());
+	ouput_test("decompose svd<float, 3>", svd_reconstructs<float, 3>());
+	ouput_test("decompose svd<double, 3>", svd_reconstructs<double, 3>());
+	ouput_test("decompose svd<double, 2>", svd_reconstructs<double, 2>());
+	ouput_test("decompose svd<float, 4>", svd_reconstructs<float, 4>());
+	ouput_test("decompose polar<float, 3>", polar_reconstructs<float, 3>());
+	ouput_test("decompose polar<double, 4>", polar_reconstructs<double, 4>());
+	ouput_test("decompose batch_matches_scalar<float>", batch_matches_scalar<float>());
+	ouput_test("decompose batch_matches_scalar<double>", batch_matches_scalar<double>());
+	ouput_test("quat quat_from_matrix<float>", quat_from_matrix_inverts<float>());
+	ouput_test("quat quat_from_matrix<double>", quat_from_matrix_inverts<double>());
+	ouput_test("quat vector_ctor", quat_vector_ctor());
+	ouput_test("decompose trs_round_trip<float>", trs_round_trip<float>());
+	ouput_test("decompose trs_round_trip<double>", trs_round_trip<double>());
+	ouput_test("decompose trs_batch_matches_scalar<float>", trs_batch_matches_scalar<float>());
+	ouput_test("decompose trs_batch_matches_scalar<double>", trs_batch_matches_scalar<double>());
+}
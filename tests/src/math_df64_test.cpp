@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_df64.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+	// df64 carries 48 bits of significand, allow a few ulps of that
+	const double df64_tol = std::ldexp(1.0, -44);
+
+
+	double random_double() {
+		return random<double>(-1.0, 1.0) * std::pow(10.0, random<double>(-3.0, 3.0));
+	}
+
+	bool near(double a, double b) {
+		return std::abs(a - b) <= df64_tol * std::max(std::abs(b), 1e-30);
+	}
+
+
+	// two_sum and two_prod are exact, which double can check for floats of similar magnitude
+	float error_free_transforms() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const float a = float(random_double()), b = float(random_double());
+			const df64 s = two_sum(a, b), p = two_prod(a, b);
+			if (double(s.hi) + double(s.lo) != double(a) + double(b) || s.hi != a + b) fail_count++;
+			if (double(p.hi) + double(p.lo) != double(a) * double(b) || p.hi != a * b) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// arithmetic keeps about 48 bits, far more than float
+	float arithmetic_matches_double() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const double x = random_double(), y = random_double();
+			const df64 a(x), b(y);
+			if (!near(double(a), x) || !near(double(b), y)) fail_count++;
+			// sums can cancel, so their error is relative to the inputs
+			if (std::abs(double(a + b) - (x + y)) > df64_tol * (std::abs(x) + std::abs(y))) fail_count++;
+			if (std::abs(double(a - b) - (x - y)) > df64_tol * (std::abs(x) + std::abs(y))) fail_count++;
+			if (!near(double(a * b), x * y) || !near(double(a / b), x / y)) fail_count++;
+			if (!near(double(sqrt(abs(a))), std::sqrt(std::abs(x)))) fail_count++;
+			if ((a < b) != (x < y) || (a == b) != (x == y)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// basic_vec<df64, N> works through scalar_traits like any other scalar
+	float vectors_match_double() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const dvec3 x(random_double(), random_double(), random_double());
+			const dvec3 y(random_double(), random_double(), random_double());
+			const dfvec3 a(x), b(y);
+			if (!near(double(length(a)), length(x))) fail_count++;
+			if (std::abs(double(dot(a, b)) - dot(x, y)) > df64_tol * 4 * length(x) * length(y)) fail_count++;
+			if (length(dvec3(normalize(a)) - normalize(x)) > df64_tol * 4) fail_count++;
+			if (length(dvec3(cross(a, b)) - cross(x, y)) > df64_tol * 4 * length(x) * length(y)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// points on a planet near the eye keep float precision relative to it, to within the
+	// ~2e-8 spacing of df64 at planetary radius, where subtracting float positions
+	// would lose everything below half a metre
+	float camera_relative_precision() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			const dvec3 eye = normalize(dvec3(random_double(), random_double(), random_double())) * 6.4e6;
+			const dfvec3 deye(eye);
+			std::vector<dvec3> p(size_t(random<int>(1, 40000)));
+			std::vector<dfvec3> dp(p.size());
+			for (size_t k = 0; k < p.size(); ++k) {
+				p[k] = eye + dvec3(random_double(), random_double(), random_double());
+				dp[k] = dfvec3(p[k]);
+			}
+			std::vector<vec3> out(p.size());
+			camera_relative_batch(dp, deye, out, i % 2 ? 0 : 1);
+			for (size_t k = 0; k < p.size(); ++k) {
+				const dvec3 d = p[k] - eye;
+				const double tol = 1e-7 * length(d) + 1e-7;
+				if (length(dvec3(out[k]) - d) > tol || length(dvec3(camera_relative(dp[k], deye)) - d) > tol) {
+					fail_count++;
+					break;
+				}
+			}
+			const mat4 m = camera_relative(mat3(1.f), dp[0], deye);
+			if (length(dvec3(m[3].x, m[3].y, m[3].z) - (p[0] - eye)) > 1e-7 * length(p[0] - eye) + 1e-7) fail_count++;
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+}
+
+
+void test::run_df64_tests() {
+	ouput_test("df64 error_free_transforms", error_free_transforms());
+	ouput_test("df64 arithmetic_matches_double", arithmetic_matches_double());
+	ouput_test("df64 vectors_match_double", vectors_match_double());
+	ouput_test("df64 camera_relative_precision", camera_relative_precision());
+}
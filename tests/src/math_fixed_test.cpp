@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_fixed.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+	using fx = cgra::fixed<16, 16>;
+
+	const double ulp = std::ldexp(1.0, -16);
+
+
+	fx random_fixed(double range) {
+		return fx::from_raw(std::int32_t(std::ldexp(random<double>(-range, range), 16)));
+	}
+
+	xvec3 random_xvec3(double range) {
+		return xvec3(random_fixed(range), random_fixed(range), random_fixed(range));
+	}
+
+
+	// operators are exact or correctly rounded against double
+	float arithmetic_matches_double() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const fx a = random_fixed(100), b = random_fixed(100);
+			const double x = double(a), y = double(b);
+			if (double(a + b) != x + y || double(a - b) != x - y || double(-a) != -x) fail_count++;
+			if (std::abs(double(a * b) - x * y) > ulp / 2) fail_count++;
+			if (std::abs(double(a / b) - x / y) >= ulp) fail_count++;
+			if (double(floor(a)) != std::floor(x) || double(abs(a)) != std::abs(x)) fail_count++;
+			if ((a < b) != (x < y) || (a == b) != (x == y) || double(min(a, b)) != std::min(x, y)) fail_count++;
+			if (double(fx(int(x))) != double(int(x))) fail_count++;
+		}
+		// division saturates rather than trapping
+		if (fx(1) / fx(0) != fx::from_raw(INT32_MAX) || fx(-1) / fx(0) != fx::from_raw(INT32_MIN)) fail_count++;
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// sqrt is the correctly rounded integer square root, and the table functions are close to libm
+	float functions_match_double() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const fx a = random_fixed(1000), b = random_fixed(1000);
+			const double x = double(a), y = double(b);
+			if (std::abs(double(sqrt(abs(a))) - std::sqrt(std::abs(x))) > ulp / 2) fail_count++;
+			if (std::abs(double(sin(a)) - std::sin(x)) > 1e-5 + ulp) fail_count++;
+			if (std::abs(double(cos(a)) - std::cos(x)) > 1e-5 + ulp) fail_count++;
+			if (std::abs(double(atan(a)) - std::atan(x)) > 3e-6 + ulp) fail_count++;
+			if (std::abs(double(atan(a, b)) - std::atan2(x, y)) > 3e-6 + ulp) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// one-argument atan agrees with atan(x, 1), and works without room for pi
+	float atan_two_integer_bits() {
+		using fx2 = cgra::fixed<2, 30>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const fx a = random_fixed(1000);
+			if (atan(a) != atan(a, fx(1))) fail_count++;
+			const fx2 b = fx2::from_raw(std::int32_t(std::ldexp(random<double>(-1.99, 1.99), 30)));
+			if (std::abs(double(atan(b)) - std::atan(double(b))) > 3e-6 + std::ldexp(1.0, -30)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// a fixed sequence of operations gives the same bits on every machine, checked against
+	// a recorded checksum; any change to rounding or the tables changes it
+	float results_are_deterministic() {
+		fx x(1), v(0);
+		const fx dt = fx(1) / fx(60);
+		std::uint32_t check = 0;
+		for (int i = 0; i < 10000; ++i) {
+			v += (sin(x * fx(3)) - cos(x) * fx(2) + atan(v, x)) * dt;
+			x += v * dt + sqrt(abs(x)) / fx(64);
+			check = check * 31 + std::uint32_t(x.raw) + std::uint32_t(v.raw);
+		}
+		return check == 0xE05340D3u ? 0.f : 1.f;
+	}
+
+
+	// vectors, matrices and quaternions of fixed work like their float counterparts
+	float linear_algebra_matches_double() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const xvec3 a = random_xvec3(10), b = random_xvec3(10);
+			const dvec3 da(a), db(b);
+			if (std::abs(double(dot(a, b)) - dot(da, db)) > 3 * ulp) fail_count++;
+			if (length(dvec3(cross(a, b)) - cross(da, db)) > 6 * ulp) fail_count++;
+			if (std::abs(double(length(a)) - length(da)) > 2 * ulp) fail_count++;
+			const dvec3 axis = normalize(dvec3(random<dvec3>(dvec3(-1), dvec3(1))) + dvec3(0, 0, 2));
+			const double angle = random<double>(-3, 3);
+			const basic_quat<fx> q = axisangle(xvec3(axis), fx(angle));
+			if (length(dvec3(q * a) - axisangle(axis, angle) * da) > 1e-3) fail_count++;
+			const basic_mat<fx, 3, 3> m = basic_mat<fx, 3, 3>(q) * fx(2);
+			const basic_mat<fx, 3, 3> r = inverse(m) * m;
+			for (size_t j = 0; j < 3; ++j) {
+				if (length(dvec3(r[j]) - dvec3(basic_mat<double, 3, 3>(1)[j])) > 1e-3) fail_count++;
+			}
+		}
+		try {
+			inverse(basic_mat<fx, 3, 3>(fx(0)));
+			fail_count++;
+		} catch (singular_matrix_error &) { }
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// the SoA batches give the same bits as the scalar operators
+	float batches_match_scalar() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			const size_t n = size_t(random<int>(1, 1000));
+			std::vector<fx> ax(n), ay(n), az(n), bx(n), by(n), bz(n), out(n), madd(n);
+			for (size_t k = 0; k < n; ++k) {
+				ax[k] = random_fixed(100);
+				ay[k] = random_fixed(100);
+				az[k] = random_fixed(100);
+				bx[k] = random_fixed(100);
+				by[k] = random_fixed(100);
+				bz[k] = random_fixed(100);
+			}
+			const fx s = random_fixed(10);
+			dot_batch<fx>(ax, ay, az, bx, by, bz, out);
+			mul_add_batch<fx>(ax, s, bx, madd);
+			for (size_t k = 0; k < n; ++k) {
+				if (out[k] != dot(xvec3(ax[k], ay[k], az[k]), xvec3(bx[k], by[k], bz[k]))) fail_count++;
+				if (madd[k] != ax[k] * s + bx[k]) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+}
+
+
+void test::run_fixed_tests() {
+	ouput_test("fixed arithmetic_matches_double", arithmetic_matches_double());
+	ouput_test("fixed functions_match_double", functions_match_double());
+	ouput_test("fixed atan_two_integer_bits", atan_two_integer_bits());
+	ouput_test("fixed results_are_deterministic", results_are_deterministic());
+	ouput_test("fixed linear_algebra_matches_double", linear_algebra_matches_double());
+	ouput_test("fixed batches_match_scalar", batches_match_scalar());
+}
@@ -0,0 +1,298 @@
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_geometry.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+
+	template <typename T, size_t N>
+	basic_aabb<T, N> random_aabb() {
+		using vec_t = basic_vec<T, N>;
+		const vec_t a = random<vec_t>(vec_t(-10), vec_t(10));
+		const vec_t b = random<vec_t>(vec_t(-10), vec_t(10));
+		return basic_aabb<T, N>{min(a, b), max(a, b)};
+	}
+
+
+	template <typename T, size_t N>
+	float aabb_merge_contains() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto a = random_aabb<T, N>();
+			const auto b = random_aabb<T, N>();
+			const auto m = merge(a, b);
+			if (!contains(m, a) || !contains(m, b)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T, size_t N>
+	float aabb_intersection_overlaps() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto a = random_aabb<T, N>();
+			const auto b = random_aabb<T, N>();
+			const auto c = intersection(a, b);
+			if (overlaps(a, b) == c.empty()) fail_count++;
+			else if (!c.empty() && (!contains(a, c) || !contains(b, c))) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T>
+	float aabb_transform_corners() {
+		using vec_t = basic_vec<T, 3>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto b = random_aabb<T, 3>();
+			const auto m = translate3(random<vec_t>(vec_t(-5), vec_t(5)))
+				* rotate3(random<basic_quat<T>>())
+				* scale3(random<vec_t>(vec_t(0.1), vec_t(3)));
+			// the transformed box is exactly the bounds of the transformed corners
+			basic_aabb<T, 3> expected;
+			for (int c = 0; c < 8; ++c) {
+				const vec_t p{(c & 1) ? b.upper.x : b.lower.x, (c & 2) ? b.upper.y : b.lower.y, (c & 4) ? b.upper.z : b.lower.z};
+				expected = expand(expected, vec_t(m * basic_vec<T, 4>(p, 1)));
+			}
+			const auto r = transform(m, b);
+			if (!test_equal(r.lower, expected.lower, 1000) || !test_equal(r.upper, expected.upper, 1000)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T, size_t N>
+	float ray_slab_sampling() {
+		using vec_t = basic_vec<T, N>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto b = random_aabb<T, N>();
+			const basic_ray<T, N> r{random<vec_t>(vec_t(-20), vec_t(20)), random<vec_t>(vec_t(-1), vec_t(1))};
+			T t0 = 0, t1 = 100;
+			const bool hit = intersect(r, b, t0, t1);
+			// points strictly inside the reported interval must be inside the box
+			if (hit && !contains(inflate(b, T(1e-3)), r.at((t0 + t1) / 2))) fail_count++;
+			// a miss means no sampled point along the ray is inside the box
+			if (!hit) {
+				for (int s = 0; s <= 200; ++s) {
+					if (contains(b, r.at(T(s) / 2))) {
+						fail_count++;
+						break;
+					}
+				}
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T, size_t W>
+	float ray_packet_matches_scalar() {
+		using vec_t = basic_vec<T, 3>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			basic_aabb_packet<T, 3, W> p;
+			std::vector<basic_aabb<T, 3>> boxes;
+			// leave the last lane empty
+			for (size_t l = 0; l + 1 < W; ++l) {
+				boxes.push_back(random_aabb<T, 3>());
+				p.set(l, boxes.back());
+			}
+			const basic_ray<T, 3> r{random<vec_t>(vec_t(-20), vec_t(20)), random<vec_t>(vec_t(-1), vec_t(1))};
+			T tnear[W];
+			const unsigned mask = intersect(r, p, T(0), T(100), tnear);
+			unsigned expected = 0;
+			for (size_t l = 0; l < boxes.size(); ++l) {
+				T t0 = 0, t1 = 100;
+				if (intersect(r, boxes[l], t0, t1)) {
+					expected |= 1u << l;
+					if (!test_equal(t0, tnear[l])) fail_count++;
+				}
+			}
+			if (mask != expected) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// random view-projection matrix, perspective or orthographic
+	template <typename T>
+	basic_mat<T, 4, 4> random_view_proj(bool ortho, clip_depth depth = clip_depth::negative_one_to_one) {
+		using vec_t = basic_vec<T, 3>;
+		const auto view = lookat(random<vec_t>(vec_t(-5), vec_t(5)), random<vec_t>(vec_t(-1), vec_t(1)), vec_t(0, 1, 0));
+		if (ortho) return orthographic(T(-4), T(4), T(-3), T(3), T(0.5), T(20), depth) * view;
+		return perspective(random<T>(T(0.5), T(1.5)), random<T>(T(0.5), T(2)), T(0.1), T(50), depth) * view;
+	}
+
+	// clip space containment, with a tolerance band where the result is ignored
+	template <typename T>
+	int clip_contains(const basic_mat<T, 4, 4> &m, const basic_vec<T, 3> &p, clip_depth depth) {
+		const auto c = m * basic_vec<T, 4>(p, 1);
+		const T dz = depth == clip_depth::negative_one_to_one ? c.w - abs(c.z) : min(c.z, c.w - c.z);
+		const T d = min(c.w - abs(c.x), min(c.w - abs(c.y), dz));
+		if (abs(d) < T(1e-3) * abs(c.w)) return -1;
+		return d > 0;
+	}
+
+
+	template <typename T>
+	float frustum_points_match_clip(bool ortho, clip_depth depth = clip_depth::negative_one_to_one) {
+		using vec_t = basic_vec<T, 3>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			const auto m = random_view_proj<T>(ortho, depth);
+			const auto f = frustum_from_matrix(m, depth);
+			std::vector<T> x, y, z, r;
+			for (int j = 0; j < 101; ++j) {
+				const vec_t p = random<vec_t>(vec_t(-20), vec_t(20));
+				x.push_back(p.x);
+				y.push_back(p.y);
+				z.push_back(p.z);
+				r.push_back(0);
+			}
+			std::vector<std::uint32_t> vis(4);
+			cull_spheres(f, x, y, z, r, vis);
+			for (size_t j = 0; j < x.size(); ++j) {
+				const int expected = clip_contains(m, vec_t{x[j], y[j], z[j]}, depth);
+				const bool v = (vis[j / 32] >> (j % 32)) & 1u;
+				if (expected >= 0 && v != bool(expected)) {
+					fail_count++;
+					break;
+				}
+			}
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+
+
+	template <typename T>
+	float cull_aabbs_matches_scalar(unsigned threads) {
+		using vec_t = basic_vec<T, 3>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 100; ++i) {
+			const auto f = frustum_from_matrix(random_view_proj<T>(i % 2));
+			const size_t count = 20000 + i;
+			std::vector<basic_aabb<T, 3>> boxes;
+			std::vector<T> cx, cy, cz, ex, ey, ez;
+			for (size_t j = 0; j < count; ++j) {
+				const vec_t c = random<vec_t>(vec_t(-30), vec_t(30));
+				const vec_t e = random<vec_t>(vec_t(0), vec_t(2));
+				boxes.push_back(basic_aabb<T, 3>{c - e, c + e});
+				cx.push_back(c.x); cy.push_back(c.y); cz.push_back(c.z);
+				ex.push_back(e.x); ey.push_back(e.y); ez.push_back(e.z);
+			}
+			std::vector<std::uint32_t> vis((count + 31) / 32);
+			cull_aabbs(f, cx, cy, cz, ex, ey, ez, vis, threads);
+			for (size_t j = 0; j < count; ++j) {
+				const bool v = (vis[j / 32] >> (j % 32)) & 1u;
+				if (v != overlaps(f, boxes[j])) {
+					fail_count++;
+					break;
+				}
+			}
+		}
+		float fail_fract = float(fail_count) / (max_iter / 100);
+		return fail_fract;
+	}
+
+
+	// q * v, rotate_unit and the matrix of q all agree, for basic_vec and std::array
+	template <typename T>
+	float quat_rotate_agrees(T tol) {
+		using vec_t = basic_vec<T, 3>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto u = normalize(random<basic_quat<T>>());
+			const auto q = u * random<T>(T(0.5), T(2));
+			const vec_t v = random<vec_t>(vec_t(-10), vec_t(10));
+			const vec_t a = q * v;
+			if (length(a - basic_mat<T, 3, 3>(u) * v) > tol) fail_count++;
+			if (length(rotate_unit(u, v) - a) > tol) fail_count++;
+			const std::array<T, 3> w{{v.x, v.y, v.z}};
+			if (length(q * w - a) > tol || length(rotate_unit(u, w) - a) > tol) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T>
+	float rotate_batch_matches_scalar(unsigned threads) {
+		using vec_t = basic_vec<T, 3>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 100; ++i) {
+			const auto q = random<basic_quat<T>>() * random<T>(T(0.5), T(2));
+			const size_t count = size_t(random<int>(1, 40000));
+			std::vector<vec_t> v(count), a(count), c(count);
+			std::vector<basic_quat<T>> qs(count);
+			std::vector<T> x(count), y(count), z(count);
+			for (size_t j = 0; j < count; ++j) {
+				v[j] = random<vec_t>(vec_t(-10), vec_t(10));
+				x[j] = v[j].x; y[j] = v[j].y; z[j] = v[j].z;
+				qs[j] = normalize(random<basic_quat<T>>());
+			}
+			rotate_batch<T>(q, v, a, threads);
+			rotate_batch<T>(qs, v, c, threads);
+			// in place
+			rotate_batch<T>(q, x, y, z, x, y, z, threads);
+			for (size_t j = 0; j < count; ++j) {
+				const vec_t e = q * v[j];
+				const T tol = T(1e-4) * std::max(T(1), length(e));
+				if (length(a[j] - e) > tol || length(vec_t(x[j], y[j], z[j]) - e) > tol || length(c[j] - qs[j] * v[j]) > tol) {
+					fail_count++;
+					break;
+				}
+			}
+		}
+		float fail_fract = float(fail_count) / (max_iter / 100);
+		return fail_fract;
+	}
+}
+
+
+void test::run_geometry_tests() {
+	ouput_test("aabb merge_contains<float, 2>", aabb_merge_contains<float, 2>());
+	ouput_test("aabb merge_contains<float, 3>", aabb_merge_contains<float, 3>());
+	ouput_test("aabb intersection_overlaps<float, 2>", aabb_intersection_overlaps<float, 2>());
+	ouput_test("aabb intersection_overlaps<float, 3>", aabb_intersection_overlaps<float, 3>());
+	ouput_test("aabb transform_corners<float>", aabb_transform_corners<float>());
+	ouput_test("aabb transform_corners<double>", aabb_transform_corners<double>());
+	ouput_test("ray slab_sampling<float, 2>", ray_slab_sampling<float, 2>());
+	ouput_test("ray slab_sampling<float, 3>", ray_slab_sampling<float, 3>());
+	ouput_test("ray packet_matches_scalar<float, 4>", ray_packet_matches_scalar<float, 4>());
+	ouput_test("ray packet_matches_scalar<float, 8>", ray_packet_matches_scalar<float, 8>());
+	ouput_test("ray packet_matches_scalar<float, 3>", ray_packet_matches_scalar<float, 3>());
+	ouput_test("ray packet_matches_scalar<double, 6>", ray_packet_matches_scalar<double, 6>());
+	ouput_test("frustum perspective points_match_clip<float>", frustum_points_match_clip<float>(false));
+	ouput_test("frustum perspective points_match_clip<double>", frustum_points_match_clip<double>(false));
+	ouput_test("frustum orthographic points_match_clip<float>", frustum_points_match_clip<float>(true));
+	ouput_test("frustum perspective zero_to_one points_match_clip<float>", frustum_points_match_clip<float>(false, clip_depth::zero_to_one));
+	ouput_test("frustum perspective reversed points_match_clip<float>", frustum_points_match_clip<float>(false, clip_depth::reversed));
+	ouput_test("frustum orthographic reversed points_match_clip<float>", frustum_points_match_clip<float>(true, clip_depth::reversed));
+	ouput_test("frustum cull_aabbs_matches_scalar<float>", cull_aabbs_matches_scalar<float>(1));
+	ouput_test("frustum cull_aabbs_matches_scalar parallel<float>", cull_aabbs_matches_scalar<float>(4));
+	ouput_test("quat rotate_agrees<float>", quat_rotate_agrees<float>(1e-4f));
+	ouput_test("quat rotate_agrees<double>", quat_rotate_agrees<double>(1e-10));
+	ouput_test("points rotate_batch_matches_scalar<float>", rotate_batch_matches_scalar<float>(1));
+	ouput_test("points rotate_batch_matches_scalar parallel<double>", rotate_batch_matches_scalar<double>(4));
+}
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include <cgra_math.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+	template <typename T>
+	bool bit_equal(const T &a, const T &b) {
+		return std::memcmp(&a, &b, sizeof(T)) == 0;
+	}
+
+
+	// operator>> reads back what operator<< writes (at full precision)
+	template <typename ElemT>
+	float stream_roundtrip() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const ElemT a = random<ElemT>();
+			std::ostringstream out;
+			out.precision(std::numeric_limits<double>::max_digits10);
+			out << a << ' ' << a;
+			std::istringstream in(out.str());
+			ElemT b, c;
+			if (!(in >> b >> c) || !bit_equal(a, b) || !bit_equal(a, c)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// the multi-line matrix layout as operator<< wrote it before it was allocation-free
+	template <typename T, size_t Cols, size_t Rows>
+	std::string reference_mat_format(const basic_mat<T, Cols, Rows> &m, std::streamsize precision) {
+		std::ostringstream out;
+		out.precision(precision);
+		size_t maxwidths[Cols];
+		std::ostringstream tempss;
+		tempss.precision(precision);
+		for (size_t i = 0; i < Cols; ++i) {
+			maxwidths[i] = 0;
+			for (size_t j = 0; j < Rows; ++j) {
+				tempss.str("");
+				tempss << m[i][j];
+				maxwidths[i] = std::max(maxwidths[i], tempss.str().size());
+			}
+		}
+		for (size_t i = 0; i < Rows; ++i) {
+			out << (Rows == 1 ? "[ " : i == 0 ? "/ " : i + 1 == Rows ? "\\ " : "| ");
+			for (size_t j = 0; j < Cols; ++j) {
+				out.width(maxwidths[j]);
+				out << m[j][i];
+				if (j + 1 < Cols) out << ", ";
+			}
+			out << (Rows == 1 ? " ]" : i == 0 ? " \\" : i + 1 == Rows ? " /" : " |");
+			if (i + 1 < Rows) out << '\n';
+		}
+		return out.str();
+	}
+
+
+	// the default matrix output is unchanged, at any precision
+	template <typename MatT>
+	float mat_format_unchanged() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			MatT m = random<MatT>();
+			if (i % 7 == 0) m[0][0] = -m[0][0] * 1e20f;
+			const std::streamsize precision = i % 19;
+			std::ostringstream out;
+			out.precision(precision);
+			out << m;
+			if (out.str() != reference_mat_format(m, precision)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// compact matrices are on one line and read back, and the flag can be reset
+	float mat_compact_roundtrip() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const basic_mat<double, 3, 2> a = random<basic_mat<double, 3, 2>>();
+			std::ostringstream out;
+			out.precision(std::numeric_limits<double>::max_digits10);
+			if (i % 2) out << std::showpos;
+			out << compact << a;
+			if (out.str().find('\n') != std::string::npos || out.str().front() != '[') fail_count++;
+			std::istringstream in(out.str());
+			basic_mat<double, 3, 2> b;
+			if (!(in >> b) || !bit_equal(a, b)) fail_count++;
+			out << nocompact << a;
+			if (out.str().find('\n') == std::string::npos) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// malformed input sets failbit and leaves the value alone
+	float stream_rejects_malformed() {
+		int fail_count = 0;
+		for (const char *str : {"(1, 2", "(1; 2, 3)", "1, 2, 3)", "(1 + 2i + 3j + 4)", "/ 1, 2 \\\n| 3, 4 |"}) {
+			std::istringstream in(str);
+			vec3 v(7);
+			quat q(7);
+			mat2 m(7);
+			if (str[0] == '/') {
+				if (in >> m || !bit_equal(m, mat2(7))) fail_count++;
+			} else if (std::strchr(str, 'i')) {
+				if (in >> q || !bit_equal(q, quat(7))) fail_count++;
+			} else {
+				if (in >> v || !bit_equal(v, vec3(7))) fail_count++;
+			}
+		}
+		return float(fail_count);
+	}
+
+#ifdef CGRA_HAVE_CHARCONV
+
+	// from_chars reads back exactly what to_chars writes, and to_chars matches the stream layout
+	template <typename ElemT>
+	float chars_roundtrip() {
+		int fail_count = 0;
+		char buf[1024];
+		for (int i = 0; i < max_iter; ++i) {
+			const ElemT a = random<ElemT>();
+			const auto w = cgra::to_chars(buf, buf + sizeof(buf), a);
+			if (w.ec != std::errc{}) {
+				fail_count++;
+				continue;
+			}
+			ElemT b;
+			const auto r = cgra::from_chars(buf, w.ptr, b);
+			if (r.ec != std::errc{} || r.ptr != w.ptr || !bit_equal(a, b)) fail_count++;
+			// the stream can read it too
+			std::istringstream in(std::string(buf, w.ptr));
+			ElemT c;
+			if (!(in >> c) || !bit_equal(a, c)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// to_chars reports a short buffer, from_chars reports bad input without writing
+	float chars_errors() {
+		int fail_count = 0;
+		char buf[8];
+		if (cgra::to_chars(buf, buf + sizeof(buf), vec3(1.5f, 2.5f, 3.5f)).ec != std::errc::value_too_large) fail_count++;
+		if (cgra::to_chars(buf, buf + sizeof(buf), vec2(1, 2)).ec != std::errc{}) fail_count++;
+		const std::string bad = "(1, x, 3)";
+		vec3 v(7);
+		const auto r = cgra::from_chars(bad.data(), bad.data() + bad.size(), v);
+		if (r.ec != std::errc::invalid_argument || r.ptr != bad.data() || !bit_equal(v, vec3(7))) fail_count++;
+		const std::string good = "(1,2 ,\n3) tail";
+		if (cgra::from_chars(good.data(), good.data() + good.size(), v).ptr != good.data() + 9 || !bit_equal(v, vec3(1, 2, 3))) fail_count++;
+		return float(fail_count);
+	}
+
+#endif
+}
+
+
+void test::run_io_tests() {
+	ouput_test("io stream_roundtrip<vec3>", stream_roundtrip<vec3>());
+	ouput_test("io stream_roundtrip<dvec4>", stream_roundtrip<dvec4>());
+	ouput_test("io stream_roundtrip<ivec2>", stream_roundtrip<ivec2>());
+	ouput_test("io stream_roundtrip<mat3>", stream_roundtrip<mat3>());
+	ouput_test("io stream_roundtrip<dmat2x4>", stream_roundtrip<basic_mat<double, 2, 4>>());
+	ouput_test("io stream_roundtrip<quat>", stream_roundtrip<quat>());
+	ouput_test("io stream_rejects_malformed", stream_rejects_malformed());
+	ouput_test("io mat_format_unchanged<mat4>", mat_format_unchanged<mat4>());
+	ouput_test("io mat_format_unchanged<dmat3x2>", mat_format_unchanged<basic_mat<double, 3, 2>>());
+	ouput_test("io mat_format_unchanged<mat1x4>", mat_format_unchanged<basic_mat<float, 1, 4>>());
+	ouput_test("io mat_format_unchanged<imat3>", mat_format_unchanged<basic_mat<int, 3, 3>>());
+	ouput_test("io mat_compact_roundtrip", mat_compact_roundtrip());
+#ifdef CGRA_HAVE_CHARCONV
+	ouput_test("io chars_roundtrip<vec3>", chars_roundtrip<vec3>());
+	ouput_test("io chars_roundtrip<dvec4>", chars_roundtrip<dvec4>());
+	ouput_test("io chars_roundtrip<ivec3>", chars_roundtrip<ivec3>());
+	ouput_test("io chars_roundtrip<mat4>", chars_roundtrip<mat4>());
+	ouput_test("io chars_roundtrip<dmat3x2>", chars_roundtrip<basic_mat<double, 3, 2>>());
+	ouput_test("io chars_roundtrip<mat1x3>", chars_roundtrip<basic_mat<float, 1, 3>>());
+	ouput_test("io chars_roundtrip<dquat>", chars_roundtrip<dquat>());
+	ouput_test("io chars_errors", chars_errors());
+#endif
+}
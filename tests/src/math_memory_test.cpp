@@ -0,0 +1,154 @@
+#include <cstdint>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_memory.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+	static_assert(sizeof(vec3a) == 16 && alignof(vec3a) == 16, "vec3a should be padded to 16 bytes");
+	static_assert(sizeof(vec4a) == sizeof(vec4) && alignof(vec4a) == 16, "vec4a should not be padded");
+	static_assert(alignof(mat4a) == CGRA_SIMD_ALIGNMENT && sizeof(mat4a) == sizeof(mat4), "mat4a should not be padded");
+	static_assert(!std::is_constructible<span<const vec3>, aligned_vec_vector<float, 3> &>::value, "padded elements are not viewable unpadded");
+	static_assert(std::is_constructible<span<const vec4>, aligned_vec_vector<float, 4> &>::value, "unpadded elements are viewable");
+
+
+	bool is_aligned(const void *p, size_t align) {
+		return reinterpret_cast<uintptr_t>(p) % align == 0;
+	}
+
+
+	template <typename T, size_t Align>
+	float allocator_alignment() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			std::vector<T, aligned_allocator<T, Align>> v(size_t(random<int>(1, 100)));
+			if (!is_aligned(v.data(), Align)) fail_count++;
+			v.resize(v.size() * 3);
+			if (!is_aligned(v.data(), Align)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// every element, not just the buffer, is aligned
+	template <typename T, size_t N>
+	float vec_aligned_elements() {
+		using veca_t = basic_vec_aligned<T, N>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			aligned_vec_vector<T, N> v(size_t(random<int>(1, 100)));
+			for (const auto &x : v) {
+				if (!is_aligned(&x, veca_t::alignment)) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// operators on aligned vectors give the same results as on plain ones
+	template <typename T, size_t N>
+	float vec_aligned_matches_unaligned() {
+		using vec_t = basic_vec<T, N>;
+		using veca_t = basic_vec_aligned<T, N>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec_t a = random<vec_t>(vec_t(-1), vec_t(1));
+			const vec_t b = random<vec_t>(vec_t(-1), vec_t(1));
+			const veca_t aa = a, ab(b);
+			const veca_t r = aa * T(2) + ab;
+			if (!(test_equal(r.as_unaligned(), a * T(2) + b))) fail_count++;
+			if (!(test_equal(dot(aa, ab), dot(a, b)))) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	float mat_aligned_matches_unaligned() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const mat4 a = random<mat4>(mat4(-1), mat4(1));
+			const vec4 v = random<vec4>(vec4(-1), vec4(1));
+			const mat4a aa = a;
+			const vec4a av = v;
+			const mat4a r = aa * aa;
+			if (!(test_equal(r.as_unaligned(), a * a))) fail_count++;
+			if (!(test_equal(aa * av, a * v))) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// spans are aligned, hold the requested values and don't overlap
+	float arena_alloc_aligned_disjoint() {
+		int fail_count = 0;
+		linear_arena arena(4096);
+		for (int i = 0; i < max_iter; ++i) {
+			const size_t n = size_t(random<int>(0, 300));
+			auto a = arena.alloc<mat4>(n, mat4(2));
+			auto b = arena.alloc<vec3>(n + 1);
+			auto c = arena.alloc<char>(size_t(random<int>(1, 7)));
+			if (!is_aligned(a.data(), CGRA_SIMD_ALIGNMENT) || !is_aligned(b.data(), CGRA_SIMD_ALIGNMENT)) fail_count++;
+			if (n && !(test_equal(a[n - 1], mat4(2)) && test_equal(b[n], vec3(0)))) fail_count++;
+			if (!(a.end() <= static_cast<void *>(b.begin()) || static_cast<void *>(b.end()) <= a.begin())) fail_count++;
+			if (!(static_cast<void *>(b.end()) <= c.begin() || static_cast<void *>(c.end()) <= b.begin())) fail_count++;
+			if (i % 10 == 9) arena.reset();
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// after the first frame, the same allocations reuse the same memory
+	float frame_arena_reset_reuses() {
+		int fail_count = 0;
+		frame_arena arena(4, 1 << 14);
+		const mat4 *first = nullptr;
+		size_t capacity = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			auto m = arena.alloc<mat4>(300);
+			detail::parallel_for(2000, arena.thread_count(), [&](size_t begin, size_t end, unsigned t) {
+				auto s = arena.local(t).alloc<vec4>(end - begin, vec4(float(t)));
+				for (auto &x : s) x += vec4(1);
+			});
+			arena_vector<vec3> scratch{arena_allocator<vec3>(arena.local(0))};
+			for (int j = 0; j < 500; ++j) scratch.push_back(vec3(float(j)));
+			if (i == 0) {
+				first = m.data();
+				capacity = arena.capacity();
+			} else if (m.data() != first || arena.capacity() != capacity) {
+				fail_count++;
+			}
+			arena.reset();
+			if (arena.bytes_used() != 0) fail_count++;
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+}
+
+
+void test::run_memory_tests() {
+	ouput_test("aligned_allocator alignment<float, 4>", allocator_alignment<float, 4>());
+	ouput_test("aligned_allocator alignment<float, 16>", allocator_alignment<float, 16>());
+	ouput_test("aligned_allocator alignment<vec3, 32>", allocator_alignment<vec3, 32>());
+	ouput_test("aligned_allocator alignment<mat4, 64>", allocator_alignment<mat4, 64>());
+	ouput_test("basic_vec_aligned elements<float, 3>", vec_aligned_elements<float, 3>());
+	ouput_test("basic_vec_aligned elements<double, 4>", vec_aligned_elements<double, 4>());
+	ouput_test("basic_vec_aligned matches_unaligned<float, 3>", vec_aligned_matches_unaligned<float, 3>());
+	ouput_test("basic_vec_aligned matches_unaligned<double, 4>", vec_aligned_matches_unaligned<double, 4>());
+	ouput_test("basic_mat_aligned matches_unaligned", mat_aligned_matches_unaligned());
+	ouput_test("linear_arena alloc_aligned_disjoint", arena_alloc_aligned_disjoint());
+	ouput_test("frame_arena reset_reuses", frame_arena_reset_reuses());
+}
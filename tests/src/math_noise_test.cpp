@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_noise.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+
+	// analytic gradients match central differences
+	template <size_t N, typename F>
+	float gradient_matches_difference(F noise) {
+		using vec_t = basic_vec<double, N>;
+		int fail_count = 0;
+		const double h = 1e-6;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec_t p = random<vec_t>(vec_t(-20), vec_t(20));
+			const auto s = noise(p);
+			for (size_t k = 0; k < N; ++k) {
+				vec_t dp(0);
+				dp[k] = h;
+				const double fd = (noise(p + dp).value - noise(p - dp).value) / (2 * h);
+				if (std::abs(fd - s.gradient[k]) > 1e-4 * std::max(1.0, std::abs(fd))) {
+					fail_count++;
+					break;
+				}
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// values stay in about [-1, 1], perlin is 0 on the lattice, and neither is constant
+	template <size_t N>
+	float noise_range() {
+		using vec_t = basic_vec<float, N>;
+		int fail_count = 0;
+		float lo = 0, hi = 0;
+		for (int i = 0; i < max_iter * 10; ++i) {
+			const vec_t p = random<vec_t>(vec_t(-100), vec_t(100));
+			for (float v : {perlin(p), simplex(p)}) {
+				if (!(std::abs(v) <= 1.1f)) fail_count++;
+				lo = std::min(lo, v);
+				hi = std::max(hi, v);
+			}
+			if (perlin(floor(p)) != 0) fail_count++;
+		}
+		if (lo > -0.5f || hi < 0.5f) fail_count += max_iter;
+		float fail_fract = float(fail_count) / (max_iter * 10);
+		return fail_fract;
+	}
+
+
+	// batch evaluation gives the scalar results
+	float batch_matches_scalar() {
+		int fail_count = 0;
+		const size_t n = 10007;
+		vector<float> x(n), y(n), z(n), w(n), out(n);
+		for (size_t i = 0; i < n; ++i) {
+			x[i] = random<float>(-50.f, 50.f);
+			y[i] = random<float>(-50.f, 50.f);
+			z[i] = random<float>(-50.f, 50.f);
+			w[i] = random<float>(-50.f, 50.f);
+		}
+		const noise_table tab(1234);
+		auto check = [&](auto f) {
+			for (size_t i = 0; i < n; ++i) {
+				if (std::abs(out[i] - f(i)) > 1e-5f) {
+					fail_count++;
+					return;
+				}
+			}
+		};
+		simplex_batch<float>(x, y, out, tab, 4);
+		check([&](size_t i) { return simplex(vec2(x[i], y[i]), tab); });
+		simplex_batch<float>(x, y, z, out, tab);
+		check([&](size_t i) { return simplex(vec3(x[i], y[i], z[i]), tab); });
+		simplex_batch<float>(x, y, z, w, out, tab, 3);
+		check([&](size_t i) { return simplex(vec4(x[i], y[i], z[i], w[i]), tab); });
+		perlin_batch<float>(x, y, out, tab);
+		check([&](size_t i) { return perlin(vec2(x[i], y[i]), tab); });
+		perlin_batch<float>(x, y, z, out, tab, 0);
+		check([&](size_t i) { return perlin(vec3(x[i], y[i], z[i]), tab); });
+		return float(fail_count);
+	}
+
+
+	// equal seeds give equal noise, different seeds different noise
+	float seeded_tables() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			const auto seed = random<std::uint32_t>();
+			const noise_table a(seed), b(seed), c(seed + 1);
+			int same = 0;
+			for (int j = 0; j < 100; ++j) {
+				const vec3 p = random<vec3>(vec3(-10), vec3(10));
+				if (simplex(p, a) != simplex(p, b) || worley(p, a) != worley(p, b)) fail_count++;
+				if (simplex(p, a) == simplex(p, c)) same++;
+			}
+			if (same > 10) fail_count++;
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+
+
+	// F1 <= F2, and F1 is bounded by the cell diagonal
+	template <size_t N>
+	float worley_bounds() {
+		using vec_t = basic_vec<double, N>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec_t p = random<vec_t>(vec_t(-100), vec_t(100));
+			const auto f = worley_f1f2(p);
+			if (!(f[0] <= f[1] && f[0] >= 0 && f[0] <= std::sqrt(double(N)))) fail_count++;
+			if (f[0] != worley(p)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+}
+
+
+void test::run_noise_tests() {
+	ouput_test("noise perlin_grad<2>", gradient_matches_difference<2>([](const auto &p) { return perlin_grad(p); }));
+	ouput_test("noise perlin_grad<3>", gradient_matches_difference<3>([](const auto &p) { return perlin_grad(p); }));
+	ouput_test("noise perlin_grad<4>", gradient_matches_difference<4>([](const auto &p) { return perlin_grad(p); }));
+	ouput_test("noise simplex_grad<2>", gradient_matches_difference<2>([](const auto &p) { return simplex_grad(p); }));
+	ouput_test("noise simplex_grad<3>", gradient_matches_difference<3>([](const auto &p) { return simplex_grad(p); }));
+	ouput_test("noise simplex_grad<4>", gradient_matches_difference<4>([](const auto &p) { return simplex_grad(p); }));
+	ouput_test("noise worley_grad<3>", gradient_matches_difference<3>([](const auto &p) { return worley_grad(p); }));
+	ouput_test("noise fbm simplex_grad<3>", gradient_matches_difference<3>([](const auto &p) {
+		return fbm([](const dvec3 &q) { return simplex_grad(q); }, p, 5);
+	}));
+	ouput_test("noise turbulence perlin_grad<2>", gradient_matches_difference<2>([](const auto &p) {
+		return turbulence([](const dvec2 &q) { return perlin_grad(q); }, p, 4, 2.0, 0.6);
+	}));
+	ouput_test("noise range<1>", noise_range<1>());
+	ouput_test("noise range<2>", noise_range<2>());
+	ouput_test("noise range<3>", noise_range<3>());
+	ouput_test("noise range<4>", noise_range<4>());
+	ouput_test("noise batch_matches_scalar", batch_matches_scalar());
+	ouput_test("noise seeded_tables", seeded_tables());
+	ouput_test("noise worley_bounds<2>", worley_bounds<2>());
+	ouput_test("noise worley_bounds<3>", worley_bounds<3>());
+}
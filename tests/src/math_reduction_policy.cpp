@@ -0,0 +1,38 @@
+// compiled once for each CGRA_DEFAULT_REDUCTION, to check that the default sum, dot and length
+// instantiate for every kind of element the library sums
+
+#include <cgra_math.hpp>
+#include <cgra_df64.hpp>
+#include <cgra_fixed.hpp>
+
+namespace {
+
+	using xfixed = cgra::fixed<16, 16>;
+
+	template <typename T>
+	void sum_everything() {
+		using namespace cgra;
+		const basic_vec<T, 3> v{T(1)};
+		volatile auto s = sum(v) + dot(v, v) + length(v);
+		(void) s;
+		const basic_mat<T, 3, 3> m{T(2)};
+		volatile auto d = (m * m * v).x;
+		(void) d;
+	}
+}
+
+void reduction_policy_instantiations() {
+	using namespace cgra;
+	sum_everything<float>();
+	sum_everything<double>();
+	volatile auto i = sum(uvec3(1, 2, 3)) + dot(ivec4(1), ivec4(2));
+	(void) i;
+	volatile auto m = (mat4(1.f) * inverse(mat4(2.f)))[0][0] + (dmat3(1.0) * dmat3(2.0))[1][1];
+	(void) m;
+	volatile auto x = (sum(xvec3(xfixed(1))) + dot(xvec3(xfixed(1)), xvec3(xfixed(2)))).raw;
+	(void) x;
+	volatile auto q = (basic_mat<xfixed, 3, 3>(xfixed(2)) * basic_mat<xfixed, 3, 3>(xfixed(1)))[0][0].raw;
+	(void) q;
+	volatile auto f = double(dot(dfvec3(df64(1.0)), dfvec3(df64(2.0))));
+	(void) f;
+}
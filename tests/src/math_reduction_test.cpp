@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include <cgra_math.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+	using vec64 = basic_vec<float, 64>;
+
+
+	// values spanning several orders of magnitude, so the summation order matters
+	vec64 random_vec64() {
+		vec64 v;
+		for (size_t i = 0; i < 64; ++i) v[i] = random<float>(-1.f, 1.f) * std::pow(10.f, random<float>(-3.f, 3.f));
+		return v;
+	}
+
+	double exact_sum(const vec64 &v) {
+		double s = 0;
+		for (size_t i = 0; i < 64; ++i) s += double(v[i]);
+		return s;
+	}
+
+	double abs_sum(const vec64 &v) {
+		double s = 0;
+		for (size_t i = 0; i < 64; ++i) s += std::abs(double(v[i]));
+		return s;
+	}
+
+
+	// small integers sum exactly, so every policy agrees with every other
+	float policies_agree_exactly() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec4 a = floor(random<vec4>(vec4(-100), vec4(100)));
+			const ivec3 b = random<ivec3>(ivec3(-100), ivec3(100));
+			const float s = sum(a);
+			if (sum(a, reduction::sequential()) != s || sum(a, reduction::pairwise()) != s || sum(a, reduction::kahan()) != s) fail_count++;
+			const int t = sum(b);
+			if (sum(b, reduction::pairwise()) != t || sum(b, reduction::kahan()) != t) fail_count++;
+			const uvec3 u(b + 100);
+			if (sum(u, reduction::kahan()) != sum(u) || sum(u, reduction::pairwise()) != sum(u)) fail_count++;
+			if (dot(a, a, reduction::pairwise()) != dot(a, a) || dot(a, a, reduction::kahan()) != dot(a, a)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// compensated sums are within a couple of float ulps of the exact sum, whatever the cancellation
+	float kahan_is_accurate() {
+		int fail_count = 0;
+		const double eps = std::numeric_limits<float>::epsilon();
+		for (int i = 0; i < max_iter; ++i) {
+			const vec64 v = random_vec64();
+			const double e = exact_sum(v);
+			if (std::abs(double(sum(v, reduction::kahan())) - e) > 2 * eps * std::abs(e) + 4 * eps * eps * abs_sum(v)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// on average, pairwise sums are no less accurate than sequential ones, and kahan beats both
+	float pairwise_error_grows_slower() {
+		double seq_err = 0, pair_err = 0, kahan_err = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec64 v = random_vec64();
+			const double e = exact_sum(v), a = abs_sum(v);
+			seq_err += std::abs(double(sum(v, reduction::sequential())) - e) / a;
+			pair_err += std::abs(double(sum(v, reduction::pairwise())) - e) / a;
+			kahan_err += std::abs(double(sum(v, reduction::kahan())) - e) / a;
+		}
+		return (pair_err <= seq_err && kahan_err <= pair_err) ? 0.f : 1.f;
+	}
+
+
+	// vectors of vectors are compensated per component, so summing columns matches summing each row
+	float kahan_per_component() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec64 a = random_vec64(), b = random_vec64();
+			basic_vec<vec2, 64> v;
+			for (size_t j = 0; j < 64; ++j) v[j] = vec2(a[j], b[j]);
+			const vec2 s = sum(v, reduction::kahan());
+			if (s.x != sum(a, reduction::kahan()) || s.y != sum(b, reduction::kahan())) fail_count++;
+			const mat3 m = random<mat3>();
+			const vec3 r = sum(m, reduction::kahan()), c = m[0] + m[1] + m[2];
+			if (length(r - c) > 1e-6f * (length(m[0]) + length(m[1]) + length(m[2]))) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// fold_tree gives fold's result for associative operations, and length follows the policy
+	float fold_tree_matches_fold() {
+		int fail_count = 0;
+		const auto fmin = [](float a, float b) { return std::min(a, b); };
+		for (int i = 0; i < max_iter; ++i) {
+			const vec64 v = random_vec64();
+			if (fold_tree(fmin, v) != fold(fmin, v[0], v)) fail_count++;
+			const basic_vec<int, 7> w = random<basic_vec<int, 7>>(basic_vec<int, 7>(-1000), basic_vec<int, 7>(1000));
+			if (fold_tree(std::plus<int>(), w) != sum(w)) fail_count++;
+			const double l = std::sqrt(double(dot(v, v, reduction::kahan())));
+			if (std::abs(double(length(v, reduction::kahan())) - l) > 1e-6 * l) fail_count++;
+			if (std::abs(double(length(v, reduction::pairwise())) - double(length(v))) > 1e-5 * l) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+}
+
+
+void test::run_reduction_tests() {
+	ouput_test("reduction policies_agree_exactly", policies_agree_exactly());
+	ouput_test("reduction kahan_is_accurate", kahan_is_accurate());
+	ouput_test("reduction pairwise_error_grows_slower", pairwise_error_grows_slower());
+	ouput_test("reduction kahan_per_component", kahan_per_component());
+	ouput_test("reduction fold_tree_matches_fold", fold_tree_matches_fold());
+}
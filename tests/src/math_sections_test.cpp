@@ -0,0 +1,49 @@
+
+// only the sub-headers are included before the tests, so any
+// name they fail to provide is a compile error here
+#include <cgra_math_core.hpp>
+#include <cgra_math_quat.hpp>
+#include <cgra_math_random.hpp>
+
+using namespace cgra;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+
+	// core: quat * vec3 spells out inverse(quat) rather than using the quat section
+	float core_quat_mul_vec_matches_inverse() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const basic_quat<double> q = random<basic_quat<double>>() * random<double>(0.5, 2.0);
+			const basic_vec<double, 3> v = random<basic_vec<double, 3>>(basic_vec<double, 3>(-1), basic_vec<double, 3>(1));
+			const basic_vec<double, 3> a = q * v;
+			const basic_quat<double> b = q * basic_quat<double>{0.0, v} * inverse(q);
+			if (!(length(a - basic_vec<double, 3>(b.x, b.y, b.z)) < 1e-9)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// mat (through the quat sub-header)
+	float mat_inverse_identity() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const basic_mat<double, 3, 3> m = basic_mat<double, 3, 3>(random<basic_quat<double>>()) * 2.0;
+			const basic_mat<double, 3, 3> r = inverse(m) * m - basic_mat<double, 3, 3>(1);
+			if (!(length(r[0]) + length(r[1]) + length(r[2]) < 1e-9)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+}
+
+
+#include "math_test.hpp"
+
+void test::run_sections_tests() {
+	ouput_test("sections core_quat_mul_vec_matches_inverse", core_quat_mul_vec_matches_inverse());
+	ouput_test("sections mat_inverse_identity", mat_inverse_identity());
+}
@@ -0,0 +1,100 @@
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_spatial_hash.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 100;
+	constexpr int num_points = 2000;
+
+
+	template <typename T, size_t N>
+	std::vector<basic_vec<T, N>> random_points(int count) {
+		using vec_t = basic_vec<T, N>;
+		std::vector<vec_t> points;
+		for (int i = 0; i < count; ++i) {
+			points.push_back(random<vec_t>(vec_t(-10), vec_t(10)));
+		}
+		return points;
+	}
+
+
+	template <typename T, size_t N>
+	float radius_query_brute_force(unsigned threads) {
+		using vec_t = basic_vec<T, N>;
+		using index_t = typename spatial_hash_grid<T, N>::index_t;
+		const auto points = random_points<T, N>(num_points);
+		spatial_hash_grid<T, N> grid(random<T>(T(0.5), T(3)));
+		grid.rebuild(points, threads);
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec_t c = random<vec_t>(vec_t(-12), vec_t(12));
+			const T r = random<T>(T(0), T(4));
+			std::vector<index_t> expected;
+			for (size_t j = 0; j < points.size(); ++j) {
+				const vec_t d = points[j] - c;
+				if (dot(d, d) <= r * r) expected.push_back(index_t(j));
+			}
+			auto result = grid.query_radius(c, r);
+			std::sort(result.begin(), result.end());
+			if (result != expected) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T, size_t N>
+	float parallel_rebuild_matches_serial() {
+		int fail_count = 0;
+		for (int i = 0; i < 10; ++i) {
+			const auto points = random_points<T, N>(50000);
+			spatial_hash_grid<T, N> a(T(1)), b(T(1));
+			a.rebuild(points, 1);
+			b.rebuild(points, 4);
+			if (a.indices() != b.indices() || a.cell_count() != b.cell_count()) fail_count++;
+		}
+		float fail_fract = float(fail_count) / 10;
+		return fail_fract;
+	}
+
+
+	// coordinates far beyond int cells clamp to the outermost cells and are still found
+	template <typename T>
+	float far_points_clamp() {
+		using vec_t = basic_vec<T, 3>;
+		const std::vector<vec_t> points{vec_t(1e7f), vec_t(-1e7f), vec_t(T(1e7), T(0), T(-1e7)), vec_t(0)};
+		spatial_hash_grid<T, 3> grid(T(1e-3));
+		grid.rebuild(points);
+		int fail_count = 0;
+		const auto hi = grid.cell_of(points[0]), lo = grid.cell_of(points[1]);
+		if (hi != basic_vec<int, 3>(std::numeric_limits<int>::max()) || lo != basic_vec<int, 3>(std::numeric_limits<int>::min())) fail_count++;
+		for (size_t j = 0; j < points.size(); ++j) {
+			const auto result = grid.query_radius(points[j], T(0));
+			if (result.size() != 1 || result[0] != j) fail_count++;
+		}
+		float fail_fract = float(fail_count) / points.size();
+		return fail_fract;
+	}
+}
+
+
+void test::run_spatial_hash_tests() {
+	ouput_test("spatial_hash_grid radius_query<float, 2>", radius_query_brute_force<float, 2>(1));
+	ouput_test("spatial_hash_grid radius_query<float, 3>", radius_query_brute_force<float, 3>(1));
+	ouput_test("spatial_hash_grid radius_query<double, 3>", radius_query_brute_force<double, 3>(1));
+	ouput_test("spatial_hash_grid radius_query<float, 4>", radius_query_brute_force<float, 4>(1));
+	ouput_test("spatial_hash_grid radius_query parallel<float, 3>", radius_query_brute_force<float, 3>(4));
+	ouput_test("spatial_hash_grid parallel_rebuild<float, 3>", parallel_rebuild_matches_serial<float, 3>());
+	ouput_test("spatial_hash_grid far_points_clamp<float>", far_points_clamp<float>());
+	ouput_test("spatial_hash_grid far_points_clamp<double>", far_points_clamp<double>());
+}
@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_spline.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+
+	bool near(const dvec3 &a, const dvec3 &b, double tol) {
+		return length(a - b) <= tol * std::max(1.0, length(b));
+	}
+
+	bool near(const dquat &a, const dquat &b, double tol) {
+		// also rejects -q, so sign flips are caught
+		return std::abs(dot(a, b) - 1) <= tol;
+	}
+
+	dvec3 random_point() {
+		return random<dvec3>(dvec3(-10), dvec3(10));
+	}
+
+	dquat random_rotation() {
+		return normalize(dquat(random<double>(-1, 1), random<double>(-1, 1), random<double>(-1, 1), random<double>(-1, 1)));
+	}
+
+
+	// each basis meets its defining end conditions
+	float basis_end_conditions() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const dvec3 p0 = random_point(), p1 = random_point(), p2 = random_point(), p3 = random_point();
+			const auto bz = dcubic3::bezier(p0, p1, p2, p3);
+			if (!near(bz(0), p0, 1e-12) || !near(bz(1), p3, 1e-12)) fail_count++;
+			if (!near(bz.derivative(0), (p1 - p0) * 3.0, 1e-12) || !near(bz.derivative(1), (p3 - p2) * 3.0, 1e-12)) fail_count++;
+			const auto cr = dcubic3::catmull_rom(p0, p1, p2, p3);
+			if (!near(cr(0), p1, 1e-12) || !near(cr(1), p2, 1e-12)) fail_count++;
+			if (!near(cr.derivative(0), (p2 - p0) * 0.5, 1e-12) || !near(cr.derivative(1), (p3 - p1) * 0.5, 1e-12)) fail_count++;
+			const auto hm = dcubic3::hermite(p0, p1, p2, p3);
+			if (!near(hm(0), p0, 1e-12) || !near(hm(1), p2, 1e-12)) fail_count++;
+			if (!near(hm.derivative(0), p1, 1e-12) || !near(hm.derivative(1), p3, 1e-12)) fail_count++;
+			// a B-spline segment is the Bezier with these control points
+			const auto bs = dcubic3::bspline(p0, p1, p2, p3);
+			const auto bb = dcubic3::bezier((p0 + p1 * 4.0 + p2) / 6.0, (p1 * 2.0 + p2) / 3.0, (p1 + p2 * 2.0) / 3.0, (p1 + p2 * 4.0 + p3) / 6.0);
+			const double t = random<double>(0, 1);
+			if (!near(bs(t), bb(t), 1e-12)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// derivatives match central differences
+	float derivatives_match_difference() {
+		int fail_count = 0;
+		const double h = 1e-5;
+		for (int i = 0; i < max_iter; ++i) {
+			const auto c = dcubic3::catmull_rom(random_point(), random_point(), random_point(), random_point());
+			const double t = random<double>(0.1, 0.9);
+			const dvec3 d1 = (c(t + h) - c(t - h)) / (2 * h);
+			const dvec3 d2 = (c.derivative(t + h) - c.derivative(t - h)) / (2 * h);
+			const dvec3 d3 = (c.second_derivative(t + h) - c.second_derivative(t - h)) / (2 * h);
+			if (!near(c.derivative(t), d1, 1e-6) || !near(c.second_derivative(t), d2, 1e-6) || !near(c.third_derivative(), d3, 1e-6)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// piecewise curves are continuous, and the interpolating ones pass through their points
+	float spline_continuity() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			std::vector<dvec3> pts(size_t(random<int>(4, 12)) * 3 + 1);
+			for (auto &p : pts) p = random_point();
+			std::vector<dvec3> tans(pts.size());
+			for (auto &m : tans) m = random_point();
+			const dspline3 splines[4] = {dspline3::bezier(pts), dspline3::catmull_rom(pts), dspline3::bspline(pts), dspline3::hermite(pts, tans)};
+			for (const auto &s : splines) {
+				for (size_t j = 1; j < s.size(); ++j) {
+					const auto &a = s.segments()[j - 1], &b = s.segments()[j];
+					if (!near(a(1), b(0), 1e-9)) fail_count++;
+					// Bezier is only C0 unless its control points are arranged to be
+					if (&s != &splines[0] && !near(a.derivative(1), b.derivative(0), 1e-9)) fail_count++;
+				}
+			}
+			for (size_t j = 0; j < pts.size(); ++j) {
+				if (!near(splines[1](double(j)), pts[j], 1e-9) || !near(splines[3](double(j)), pts[j], 1e-9)) fail_count++;
+			}
+			if (!near(splines[0](0), pts.front(), 1e-9) || !near(splines[0](double(splines[0].size())), pts.back(), 1e-9)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+
+
+	// forward differencing gives the same points as evaluating every parameter
+	template <typename T>
+	float sample_n_matches_eval(T tol) {
+		using vec_t = basic_vec<T, 3>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			std::vector<vec_t> pts(size_t(random<int>(2, 20)));
+			for (auto &p : pts) p = random<vec_t>(vec_t(-10), vec_t(10));
+			const auto s = basic_spline<T, 3>::catmull_rom(pts);
+			const size_t count = size_t(random<int>(1, 2000));
+			std::vector<vec_t> out(count);
+			sample_n(s, count, span<vec_t>(out));
+			const T h = count > 1 ? T(s.size()) / T(count - 1) : T(0);
+			for (size_t j = 0; j < count; ++j) {
+				if (length(out[j] - s(T(j) * h)) > tol) {
+					fail_count++;
+					break;
+				}
+			}
+			const auto &c = s.segments()[0];
+			sample_n(c, count, span<vec_t>(out));
+			for (size_t j = 0; j < count; ++j) {
+				if (length(out[j] - c(count > 1 ? T(j) / T(count - 1) : T(0))) > tol) {
+					fail_count++;
+					break;
+				}
+			}
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+
+
+	// lengths of a line and of a Bezier quarter circle, and param() inverts distance()
+	float arc_length_table_accuracy() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			// unevenly spaced points on a line, so the parameter is not proportional to distance
+			const dvec3 a = random_point(), dir = normalize(random_point());
+			std::vector<dvec3> pts{a};
+			for (int j = 0; j < 6; ++j) pts.push_back(pts.back() + dir * random<double>(1.0, 1.5));
+			const auto line = dspline3::catmull_rom(pts);
+			const darc_length_table3 table(line, 32);
+			const double len = length(pts.back() - pts.front());
+			if (std::abs(table.length() - len) > 1e-9 * len) fail_count++;
+			for (int j = 0; j < 10; ++j) {
+				const double s = random<double>(0.0, len);
+				const double t = table.param(s);
+				if (std::abs(length(line(t) - a) - s) > 1e-2 * len) fail_count++;
+				if (std::abs(table.distance(t) - s) > 1e-9 * len) fail_count++;
+			}
+			std::vector<dvec3> even(20);
+			sample_n(line, table, even.size(), span<dvec3>(even));
+			for (size_t j = 1; j < even.size(); ++j) {
+				if (std::abs(length(even[j] - even[j - 1]) - len / 19) > 1e-2 * len) fail_count++;
+			}
+		}
+		// a Bezier quarter circle is within 0.03% of the true radius
+		const double k = 0.5522847498;
+		const auto arc = dspline3::bezier(std::vector<dvec3>{{1, 0, 0}, {1, k, 0}, {k, 1, 0}, {0, 1, 0}});
+		if (std::abs(darc_length_table3(arc).length() - pi / 2) > 1e-3) fail_count += max_iter;
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+
+
+	// slerp runs from its first argument to its second
+	float slerp_endpoints() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const dquat a = random_rotation(), b = random_rotation();
+			// the end is b or -b, whichever is the shorter way round
+			if (!near(slerp(a, b, 0.0), a, 1e-9) || std::abs(std::abs(dot(slerp(a, b, 1.0), b)) - 1) > 1e-9) fail_count++;
+			const dquat m = slerp(a, b, 0.25);
+			if (std::abs(abs(m) - 1) > 1e-9) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// squad splines pass through their keys, stay unit length and have no jumps in angular velocity
+	float quat_spline_smooth() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			std::vector<dquat> keys(size_t(random<int>(3, 10)));
+			for (auto &q : keys) q = random_rotation();
+			const dquat_spline s(keys);
+			for (size_t j = 0; j < keys.size(); ++j) {
+				// keys may be negated to keep neighbours on one hemisphere
+				if (!near(s(double(j)), s.keys()[j], 1e-9) || std::abs(std::abs(dot(s.keys()[j], keys[j])) - 1) > 1e-12) fail_count++;
+			}
+			const double h = 1e-5;
+			for (size_t j = 1; j + 1 < keys.size(); ++j) {
+				const double t = double(j);
+				if (std::abs(abs(s(t + 0.5)) - 1) > 1e-9) fail_count++;
+				// one-sided derivatives either side of an interior key agree
+				const dquat left = (s(t) - s(t - h)) * (1 / h);
+				const dquat right = (s(t + h) - s(t)) * (1 / h);
+				const dquat diff = left - right;
+				if (abs(diff) > 1e-3 * std::max(1.0, abs(left))) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+}
+
+
+void test::run_spline_tests() {
+	ouput_test("spline basis_end_conditions", basis_end_conditions());
+	ouput_test("spline derivatives_match_difference", derivatives_match_difference());
+	ouput_test("spline continuity", spline_continuity());
+	ouput_test("spline sample_n_matches_eval<float>", sample_n_matches_eval<float>(1e-3f));
+	ouput_test("spline sample_n_matches_eval<double>", sample_n_matches_eval<double>(1e-9));
+	ouput_test("spline arc_length_table_accuracy", arc_length_table_accuracy());
+	ouput_test("quat slerp_endpoints", slerp_endpoints());
+	ouput_test("quat_spline smooth", quat_spline_smooth());
+}
@@ -4,6 +4,23 @@
 
 namespace test {
 	void run_basic_vec_tests();
+	void run_spatial_hash_tests();
+	void run_geometry_tests();
+	void run_bvh_tests();
+	void run_transform_tests();
+	void run_sections_tests();
+	void run_memory_tests();
+	void run_view_tests();
+	void run_binary_tests();
+	void run_io_tests();
+	void run_noise_tests();
+	void run_spline_tests();
+	void run_decompose_tests();
+	void run_transform_hierarchy_tests();
+	void run_camera_tests();
+	void run_df64_tests();
+	void run_reduction_tests();
+	void run_fixed_tests();
 	// void run_mat_tests();
 	// void run_quat_tests();
 
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include <cgra_transform_hierarchy.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+	using hierarchy_t = transform_hierarchy<double>;
+	using index_t = hierarchy_t::index_t;
+
+
+	// random forest with node ids shuffled, so parents do not always come first
+	std::vector<index_t> random_parents(size_t count) {
+		std::vector<index_t> order(count);
+		std::iota(order.begin(), order.end(), index_t(0));
+		for (size_t i = count; i > 1; --i) std::swap(order[i - 1], order[size_t(random<int>(0, int(i) - 1))]);
+		std::vector<index_t> parents(count, hierarchy_t::npos);
+		for (size_t i = 1; i < count; ++i) {
+			if (random<int>(0, 9) == 0) continue;
+			parents[order[i]] = order[size_t(random<int>(0, int(i) - 1))];
+		}
+		return parents;
+	}
+
+	void random_local(hierarchy_t &h, index_t node) {
+		const dquat q = normalize(random<dquat>());
+		h.local(node, random<dvec3>(dvec3(-2), dvec3(2)), q, random<dvec3>(dvec3(0.5), dvec3(1.5)));
+	}
+
+	// world transform by walking up the parents
+	dmat4 reference_world(const hierarchy_t &h, const std::vector<index_t> &parents, index_t node) {
+		dmat4 m = h.local(node);
+		for (index_t p = parents[node]; p != hierarchy_t::npos; p = parents[p]) m = h.local(p) * m;
+		return m;
+	}
+
+	double max_diff(const dmat4 &a, const dmat4 &b) {
+		double d = 0;
+		for (size_t j = 0; j < 4; ++j) {
+			for (size_t i = 0; i < 4; ++i) d = std::max(d, std::abs(a[j][i] - b[j][i]));
+		}
+		return d;
+	}
+
+	bool matches_reference(const hierarchy_t &h, const std::vector<index_t> &parents) {
+		for (index_t i = 0; i < index_t(parents.size()); ++i) {
+			const dmat4 r = reference_world(h, parents, i);
+			if (max_diff(h.world(i), r) > 1e-9 * std::max(1.0, max_diff(r, dmat4(0.0)))) return false;
+		}
+		return true;
+	}
+
+
+	// storage is breadth-first with parents before children, and slots map back to nodes
+	float breadth_first_order() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			const auto parents = random_parents(size_t(random<int>(1, 500)));
+			const hierarchy_t h(parents);
+			const auto ps = h.parent_slots();
+			for (size_t s = 0; s < h.size(); ++s) {
+				const index_t n = h.nodes()[s];
+				if (h.slot(n) != s) fail_count++;
+				if ((ps[s] == hierarchy_t::npos) != (parents[n] == hierarchy_t::npos)) fail_count++;
+				if (ps[s] != hierarchy_t::npos && (ps[s] >= s || h.nodes()[ps[s]] != parents[n])) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / (max_iter / 10);
+		return fail_fract;
+	}
+
+
+	// world transforms match the product of locals up the tree, after a full and a partial update
+	float update_matches_reference(unsigned threads) {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 100; ++i) {
+			const size_t count = size_t(random<int>(1, 20000));
+			const auto parents = random_parents(count);
+			hierarchy_t h(parents);
+			for (index_t n = 0; n < count; ++n) random_local(h, n);
+			if (h.update(threads) != count) fail_count++;
+			if (!matches_reference(h, parents)) fail_count++;
+			if (h.dirty() || h.update(threads) != 0) fail_count++;
+			// change a few nodes; everything below them is recomputed and nothing else
+			std::vector<std::uint8_t> changed(count, 0);
+			for (size_t k = 0; k < count / 20 + 1; ++k) {
+				const index_t n = index_t(random<int>(0, int(count) - 1));
+				random_local(h, n);
+				changed[n] = 1;
+			}
+			size_t expected = 0;
+			for (index_t n = 0; n < count; ++n) {
+				for (index_t p = n; p != hierarchy_t::npos; p = parents[p]) {
+					if (changed[p]) {
+						expected++;
+						break;
+					}
+				}
+			}
+			if (h.update(threads) != expected) fail_count++;
+			if (!matches_reference(h, parents)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / (max_iter / 100);
+		return fail_fract;
+	}
+}
+
+
+void test::run_transform_hierarchy_tests() {
+	ouput_test("transform_hierarchy breadth_first_order", breadth_first_order());
+	ouput_test("transform_hierarchy update_matches_reference", update_matches_reference(1));
+	ouput_test("transform_hierarchy update_matches_reference parallel", update_matches_reference(4));
+}
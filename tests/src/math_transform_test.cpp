@@ -0,0 +1,125 @@
+
+#include <cmath>
+
+#include <cgra_math.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+
+	template <typename T, size_t Cols, size_t Rows>
+	bool near_equal(const basic_mat<T, Cols, Rows> &a, const basic_mat<T, Cols, Rows> &b, T tol) {
+		for (size_t j = 0; j < Cols; ++j) {
+			for (size_t i = 0; i < Rows; ++i) {
+				if (!(std::abs(a[j][i] - b[j][i]) <= tol)) return false;
+			}
+		}
+		return true;
+	}
+
+	template <typename T>
+	T ndc_depth(const basic_mat<T, 4, 4> &p, T z) {
+		const auto c = p * basic_vec<T, 4>(0, 0, z, 1);
+		return c.z / c.w;
+	}
+
+	template <typename T>
+	basic_vec<T, 2> expected_depth(clip_depth depth) {
+		switch (depth) {
+		case clip_depth::zero_to_one: return {0, 1};
+		case clip_depth::reversed: return {1, 0};
+		default: return {-1, 1};
+		}
+	}
+
+
+	template <typename T>
+	float perspective_depth_range(clip_depth depth) {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const T n = random<T>(T(0.01), T(1));
+			const T f = random<T>(T(10), T(1000));
+			const auto p = perspective(random<T>(T(0.3), T(2)), random<T>(T(0.5), T(2)), n, f, depth);
+			const auto e = expected_depth<T>(depth);
+			if (std::abs(ndc_depth(p, -n) - e[0]) > T(1e-4) || std::abs(ndc_depth(p, -f) - e[1]) > T(1e-4)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T>
+	float perspective_infinite_depth_range(clip_depth depth) {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const T n = random<T>(T(0.01), T(1));
+			const auto p = perspective_infinite(random<T>(T(0.3), T(2)), random<T>(T(0.5), T(2)), n, depth);
+			const auto e = expected_depth<T>(depth);
+			// approaches the far value as z goes to infinity
+			if (std::abs(ndc_depth(p, -n) - e[0]) > T(1e-4) || std::abs(ndc_depth(p, -n * T(1e6)) - e[1]) > T(1e-4)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T>
+	float inverse_perspective_identity(clip_depth depth, bool infinite) {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const T fovy = random<T>(T(0.3), T(2));
+			const T aspect = random<T>(T(0.5), T(2));
+			const T n = random<T>(T(0.01), T(1));
+			const T f = random<T>(T(10), T(1000));
+			const auto p = infinite ? perspective_infinite(fovy, aspect, n, depth) : perspective(fovy, aspect, n, f, depth);
+			const auto ip = inverse_perspective(p);
+			if (!near_equal(ip * p, basic_mat<T, 4, 4>{1}, T(1e-4))) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	template <typename T>
+	float orthographic_corners(clip_depth depth) {
+		using vec4_t = basic_vec<T, 4>;
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const T l = random<T>(T(-10), T(0)), r = random<T>(T(1), T(10));
+			const T b = random<T>(T(-10), T(0)), t = random<T>(T(1), T(10));
+			const T n = random<T>(T(0.1), T(1)), f = random<T>(T(10), T(100));
+			const auto p = orthographic(l, r, b, t, n, f, depth);
+			const auto e = expected_depth<T>(depth);
+			const vec4_t lo = p * vec4_t(l, b, -n, 1);
+			const vec4_t hi = p * vec4_t(r, t, -f, 1);
+			if (!(std::abs(lo.x + 1) < T(1e-4) && std::abs(lo.y + 1) < T(1e-4) && std::abs(lo.z - e[0]) < T(1e-4))) fail_count++;
+			else if (!(std::abs(hi.x - 1) < T(1e-4) && std::abs(hi.y - 1) < T(1e-4) && std::abs(hi.z - e[1]) < T(1e-4))) fail_count++;
+			else if (!near_equal(inverse_orthographic(p) * p, basic_mat<T, 4, 4>{1}, T(1e-4))) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+}
+
+
+void test::run_transform_tests() {
+	ouput_test("perspective depth_range gl<float>", perspective_depth_range<float>(clip_depth::negative_one_to_one));
+	ouput_test("perspective depth_range zero_to_one<float>", perspective_depth_range<float>(clip_depth::zero_to_one));
+	ouput_test("perspective depth_range reversed<float>", perspective_depth_range<float>(clip_depth::reversed));
+	ouput_test("perspective_infinite depth_range gl<double>", perspective_infinite_depth_range<double>(clip_depth::negative_one_to_one));
+	ouput_test("perspective_infinite depth_range zero_to_one<double>", perspective_infinite_depth_range<double>(clip_depth::zero_to_one));
+	ouput_test("perspective_infinite depth_range reversed<double>", perspective_infinite_depth_range<double>(clip_depth::reversed));
+	ouput_test("inverse_perspective identity gl<float>", inverse_perspective_identity<float>(clip_depth::negative_one_to_one, false));
+	ouput_test("inverse_perspective identity reversed<float>", inverse_perspective_identity<float>(clip_depth::reversed, false));
+	ouput_test("inverse_perspective identity infinite reversed<float>", inverse_perspective_identity<float>(clip_depth::reversed, true));
+	ouput_test("inverse_perspective identity infinite zero_to_one<double>", inverse_perspective_identity<double>(clip_depth::zero_to_one, true));
+	ouput_test("orthographic corners gl<float>", orthographic_corners<float>(clip_depth::negative_one_to_one));
+	ouput_test("orthographic corners zero_to_one<float>", orthographic_corners<float>(clip_depth::zero_to_one));
+	ouput_test("orthographic corners reversed<double>", orthographic_corners<double>(clip_depth::reversed));
+}
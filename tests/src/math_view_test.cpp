@@ -0,0 +1,124 @@
+#include <array>
+#include <tuple>
+#include <vector>
+
+#include <cgra_math.hpp>
+#include "math_test.hpp"
+
+using namespace std;
+using namespace cgra;
+using namespace test;
+
+namespace {
+
+	constexpr int max_iter = 1000;
+
+	static_assert(std::is_same<decltype(std::declval<vec_view<const float, 3>>()[0]), const float &>::value, "const views should not be writable");
+	static_assert(std::is_convertible<vec_view<float, 3>, vec_view<const float, 3>>::value, "views should convert to const");
+	static_assert(!std::is_copy_assignable<vec_view<const float, 3>>::value, "const views should not be assignable");
+	static_assert(std::is_copy_assignable<vec_view<float, 3>>::value, "views should be assignable");
+	static_assert(!std::is_convertible<strided_span<const vec3>, strided_span<vec3>>::value, "spans should not drop const");
+	static_assert(!detail::array_traits<std::tuple<float, int>>::is_array, "heterogeneous tuples are not arrays");
+
+	struct vertex {
+		vec3 pos;
+		vec3 norm;
+		vec2 uv;
+		float pad;
+	};
+
+
+	// functions on strided views match the same functions on copies, and assignment writes through
+	float strided_matches_copy() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter / 10; ++i) {
+			vector<vertex> verts(size_t(random<int>(1, 50)));
+			for (auto &v : verts) {
+				v.pos = random<vec3>(vec3(-1), vec3(1));
+				v.norm = random<vec3>(vec3(-1), vec3(1));
+				v.uv = random<vec2>(vec2(0), vec2(1));
+			}
+			const vector<vertex> orig = verts;
+			strided_span<vec3> pos(&verts[0].pos, verts.size(), sizeof(vertex));
+			strided_span<vec3> norm(&verts[0].norm, verts.size(), sizeof(vertex));
+			strided_span<const vec3> cpos = pos;
+			for (size_t j = 0; j < verts.size(); j++) {
+				const vec3 p = orig[j].pos, n = orig[j].norm;
+				if (!test_equal(dot(cpos[j], norm[j]), dot(p, n))) fail_count++;
+				if (!test_equal(length(norm[j]), length(n))) fail_count++;
+				if (!test_equal(vec3(cross(pos[j], norm[j])), cross(p, n))) fail_count++;
+			}
+			for (auto n : norm) n = normalize(n);
+			for (size_t j = 0; j < verts.size(); j++) {
+				if (!test_equal(verts[j].norm, normalize(orig[j].norm))) fail_count++;
+				if (!(test_equal(verts[j].pos, orig[j].pos) && test_equal(verts[j].uv, orig[j].uv))) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// a strided span over plain vectors and its subspans see the right elements
+	float strided_contiguous_subspan() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			vector<vec4> vs(size_t(random<int>(1, 20)));
+			for (auto &v : vs) v = random<vec4>(vec4(-1), vec4(1));
+			strided_span<vec4> s(vs);
+			const size_t off = size_t(random<int>(0, int(vs.size()) - 1));
+			auto sub = s.subspan(off, vs.size() - off);
+			if (s.size() != vs.size() || s.stride() != sizeof(vec4)) fail_count++;
+			if (!test_equal(vec4(sub[0]), vs[off])) fail_count++;
+			sub[0] = sub[0] * 2.f;
+			if (!test_equal(vec4(s[off]), vs[off])) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// assigning one view to another copies the elements, even when the views overlap
+	float view_assign_overlapping() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			float a[5], orig[5];
+			for (size_t j = 0; j < 5; j++) orig[j] = a[j] = random<float>(-1.f, 1.f);
+			const size_t src = size_t(random<int>(0, 2)), dst = size_t(random<int>(0, 2));
+			vec_view<float, 3> d(a + dst);
+			const vec_view<float, 3> v(a + src);
+			d = v;
+			for (size_t j = 0; j < 3; j++) {
+				if (a[dst + j] != orig[src + j]) fail_count++;
+			}
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+
+
+	// std::array and homogeneous std::tuple work with the generic vector functions
+	float std_array_tuple_ops() {
+		int fail_count = 0;
+		for (int i = 0; i < max_iter; ++i) {
+			const vec3 a = random<vec3>(vec3(-1), vec3(1));
+			const vec3 b = random<vec3>(vec3(-1), vec3(1));
+			const std::array<float, 3> sa{{a.x, a.y, a.z}};
+			const std::tuple<float, float, float> tb{b.x, b.y, b.z};
+			if (!test_equal(dot(sa, tb), dot(a, b))) fail_count++;
+			if (!test_equal(cross(sa, tb), cross(a, b))) fail_count++;
+			if (!test_equal(sa + b, a + b)) fail_count++;
+			if (!test_equal(vec3(sa), a)) fail_count++;
+		}
+		float fail_fract = float(fail_count) / max_iter;
+		return fail_fract;
+	}
+}
+
+
+void test::run_view_tests() {
+	ouput_test("strided_span matches_copy", strided_matches_copy());
+	ouput_test("strided_span contiguous_subspan", strided_contiguous_subspan());
+	ouput_test("std::array/tuple ops", std_array_tuple_ops());
+	ouput_test("vec_view assign_overlapping", view_assign_overlapping());
+}